@@ -3,8 +3,12 @@
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 
 #if defined(__CUDA__) || defined(__NVCC__)
@@ -179,6 +183,12 @@ NDZIP_UNIVERSAL index_type linear_index(const Extent &space, const Extent &pos)
     return l;
 }
 
+// An axis-aligned region of an array, given as the position of its first element and its size.
+struct box {
+    extent offset;
+    extent size;
+};
+
 class compressor_requirements;
 
 }  // namespace ndzip
@@ -224,6 +234,24 @@ using compressed_type = detail::bits_type<T>;
 template<typename T>
 index_type compressed_length_bound(const extent &e);
 
+// Bound for streams with stream_options::hypercube_shape, which changes the number of hypercubes and the border
+template<typename T>
+index_type compressed_length_bound(const extent &e, const extent &hypercube_shape);
+
+struct compressed_length_estimate {
+    index_type length;       // in compressed_type words
+    index_type lower_bound;  // of a 95% confidence interval for length
+    index_type upper_bound;
+    bool exact;  // every hypercube was counted
+};
+
+// Estimates the length of the stream that compressing data with default stream options produces, by running the block
+// transform on a stratified random sample of about sample_fraction of the hypercubes and counting their encoded
+// length without writing it. A sample_fraction of 1 counts all hypercubes and yields the exact length.
+template<typename T>
+compressed_length_estimate
+estimate_compressed_length(const T *data, const extent &data_size, double sample_fraction = 0.05);
+
 template<typename T>
 class compressor {
   public:
@@ -233,6 +261,47 @@ class compressor {
     virtual ~compressor() = default;
 
     virtual index_type compress(const value_type *data, const extent &data_size, compressed_type *stream) = 0;
+
+    // Compresses the residual of `data` against `reference`, an array of the same size such as the previous time
+    // step or a decoded keyframe. The stream records a fingerprint of the reference and can only be decompressed
+    // together with it. If `reference` is null, this is equivalent to compress(data, data_size, stream).
+    virtual index_type compress(const value_type *data, const value_type *reference, const extent &data_size,
+            compressed_type *stream)
+            = 0;
+
+    // Re-compresses the regions `dirty` of `data` in-place in `stream`, which must hold the result of a previous
+    // compress() call without a reference on an array of the same size and have room for
+    // compressed_length_bound<T>(data_size) words. Only hypercubes intersecting a dirty region are encoded again.
+    // Returns the new stream length.
+    virtual index_type update(const value_type *data, const extent &data_size, const std::vector<box> &dirty,
+            compressed_type *stream)
+            = 0;
+
+    // Compresses num_fields arrays of the same size, such as the components of a velocity field, into a single
+    // stream that interleaves their hypercubes. Every hypercube of a field other than fields[0] is encoded as its
+    // difference to the co-located hypercube of fields[0] after the block transform where that is smaller. The
+    // stream must have room for num_fields * compressed_length_bound<T>(data_size) words. Stream options other than
+    // the compression level are not supported.
+    virtual index_type compress_fields(const value_type *const *fields, index_type num_fields,
+            const extent &data_size, compressed_type *stream)
+            = 0;
+};
+
+// Statistics of a decompressed array. NaNs are only counted and excluded from all other fields, which are NaN if the
+// array contains no other values.
+struct array_statistics {
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double l2_norm = 0;
+    index_type nan_count = 0;
+};
+
+// Outcome of decompressor::decompress_verified
+struct verification_result {
+    index_type stream_length = 0;                // as returned by decompress, 0 if the border is corrupt
+    std::vector<index_type> corrupt_hypercubes;  // in ascending order, see hypercube_region
+    bool corrupt_border = false;
 };
 
 template<typename T>
@@ -244,13 +313,302 @@ class decompressor {
     virtual ~decompressor() = default;
 
     virtual index_type decompress(const compressed_type *stream, value_type *data, const extent &data_size) = 0;
+
+    // Decompresses like the overload above and computes the statistics of the array while the decoded hypercubes are
+    // still in cache, avoiding a second pass over data.
+    virtual index_type decompress(const compressed_type *stream, value_type *data, const extent &data_size,
+            array_statistics &statistics)
+            = 0;
+
+    // Decompresses a stream that was compressed against `reference`. Throws if the stream does not depend on a
+    // reference or if `reference` differs from the array it was compressed against.
+    virtual index_type decompress(const compressed_type *stream, const value_type *reference, value_type *data,
+            const extent &data_size)
+            = 0;
+
+    // Decodes only the num_planes most significant bit planes of a progressive stream, leaving the remaining bits of
+    // every value outside the border zero. Only the first progressive_prefix_length<T>(stream, data_size, num_planes)
+    // words of the stream are read. Returns that length.
+    virtual index_type decompress_planes(const compressed_type *stream, unsigned num_planes, value_type *data,
+            const extent &data_size)
+            = 0;
+
+    // Decodes a preview of the array at 1/factor of its resolution along every axis into an array of size
+    // preview_extent(data_size, factor), without reconstructing the full-resolution array. Every preview value is the
+    // mean of the corresponding factor^dims block of the array. factor must be a power of two not larger than the
+    // hypercube side length. For factor equal to the side length, streams with hypercube means are previewed from
+    // the side table without decoding any hypercube. Not supported for progressive streams.
+    virtual index_type decompress_preview(const compressed_type *stream, unsigned factor, value_type *preview,
+            const extent &data_size)
+            = 0;
+
+    // Called with the minimum and maximum of a hypercube, excluding NaNs. Must return true if the hypercube may
+    // contain values of interest. May be called concurrently.
+    using bounds_predicate = std::function<bool(value_type min, value_type max)>;
+
+    // Decodes only the hypercubes of a stream with hypercube bounds for which may_match returns true, and the border.
+    // All other elements of data are left untouched. Returns the number of decoded hypercubes.
+    virtual index_type decompress_where(const compressed_type *stream, const bounds_predicate &may_match,
+            value_type *data, const extent &data_size)
+            = 0;
+
+    // Decodes only the elements inside region into data, an array of size region.size, reading only the hypercubes
+    // that intersect the region and the border. Progressive, cross-predicted, custom-shaped and folded streams are
+    // decompressed in full into a temporary array instead. Returns the stream length like decompress.
+    virtual index_type decompress_region(const compressed_type *stream, const box &region, value_type *data,
+            const extent &data_size)
+            = 0;
+
+    // Decompresses a stream produced by compressor::compress_fields into num_fields arrays in a single pass.
+    virtual index_type decompress_fields(const compressed_type *stream, value_type *const *fields,
+            index_type num_fields, const extent &data_size)
+            = 0;
+
+    // Decompresses a stream with hypercube checksums, verifying the encoding of every hypercube against its checksum
+    // right before decoding it. Corrupt hypercubes, and those that share the encoding of or are predicted from a
+    // corrupt one, are skipped and reported, leaving their elements in data untouched. A corrupt border is skipped
+    // likewise. Hypercubes of folded streams are numbered within the folded array.
+    virtual verification_result decompress_verified(const compressed_type *stream, value_type *data,
+            const extent &data_size)
+            = 0;
+};
+
+// Elements of the hc_index-th hypercube of an array of size data_size, counting hypercubes in row-major order of their
+// grid as decompressor::decompress_verified does for streams without a custom hypercube shape
+box hypercube_region(const extent &data_size, index_type hc_index);
+
+inline extent preview_extent(const extent &data_size, unsigned factor) {
+    auto size = data_size;
+    for (auto &component : size) {
+        component = (component + factor - 1) / factor;
+    }
+    return size;
+}
+
+// Number of leading words of a progressive stream required to decode its num_planes most significant bit planes.
+// Reads the stream header, which is itself progressive_prefix_length<T>(nullptr, data_size, 0) words long.
+template<typename T>
+index_type progressive_prefix_length(const compressed_type<T> *stream, const extent &data_size, unsigned num_planes);
+
+inline constexpr int max_compression_level = 2;
+
+// Optional stream format features. A stream must be decompressed with the options it was compressed with.
+struct stream_options {
+    // Choose a predictor (none, single-axis delta, Lorenzo, second-order or XOR delta) for each hypercube by
+    // estimating its encoded size instead of always applying the Lorenzo transform. Costs one byte per hypercube.
+    bool adaptive_prediction = false;
+
+    // Level 0 is the plain zero-bit encoding. Higher levels trade throughput for ratio by passing each encoded
+    // hypercube through a Huffman coder, using a single code (level 1) or one code per byte position (level 2).
+    int level = 0;
+
+    // If positive, compression is lossy and reconstructs every value to within this absolute error by quantizing it
+    // to a bin of width 2 * error_bound before prediction. Hypercubes containing values that cannot be quantized
+    // within the bound, such as infinities or NaNs, and the border are stored losslessly.
+    double error_bound = 0;
+
+    // If positive, compression is lossy and keeps only this many of the most significant mantissa bits of each value,
+    // rounding to nearest. The dropped bits never enter the residuals, so their bit planes cost nothing in the
+    // zero-bit encoding. The border is stored losslessly. Cannot be combined with error_bound.
+    int mantissa_bits = 0;
+
+    // If positive, every hypercube is compressed to exactly fixed_rate bits per value (at least 2), so that it can be
+    // located, decoded or re-written without consulting other hypercubes. Hypercubes that do not fit the budget
+    // losslessly drop as many low-order bits from each of their values as necessary. The border is stored
+    // losslessly. Cannot be combined with levels above 0, error_bound or mantissa_bits.
+    int fixed_rate = 0;
+
+    // Lays out the stream by bit plane, most significant first, instead of by hypercube, so that a prefix of the
+    // stream can be decoded into an approximation with decompressor::decompress_planes. Uses a bitwise Lorenzo
+    // transform that compresses somewhat worse. Cannot be combined with any other option.
+    bool progressive = false;
+
+    // Stores the mean of every hypercube in a side table for decompressor::decompress_preview, costing one value per
+    // hypercube. The encoding of the hypercubes is unaffected. Cannot be combined with progressive.
+    bool hypercube_means = false;
+
+    // Stores the minimum and maximum of every hypercube in a side table for decompressor::decompress_where, costing
+    // two values per hypercube. Bounds are taken from the input, so in lossy streams the decoded values may exceed
+    // them by the compression error. Cannot be combined with progressive.
+    bool hypercube_bounds = false;
+
+    // Encodes hypercubes whose values are bit-identical to those of an earlier hypercube as a one-word reference to
+    // that hypercube, as found in masked regions, periodic boundaries or replicated ensemble members. Finding the
+    // duplicates costs an additional hashing pass over the input. Limits streams to 2^31 words, compression throws
+    // std::length_error beyond. Cannot be combined with fixed_rate, progressive or a reference.
+    bool deduplicate = false;
+
+    // If at least 2, the leading face of a hypercube along the innermost dimension is predicted from the last face of
+    // the preceding hypercube instead of restarting the prediction at every hypercube boundary. Chains of up to this
+    // many hypercubes must then be decoded in order, which bounds the loss of decoding parallelism. Only for lossless
+    // streams, cannot be combined with adaptive_prediction, deduplicate, progressive or a reference and is not
+    // supported by decompressor::decompress_preview and decompressor::decompress_where.
+    int prediction_chain_length = 0;
+
+    // If set, the array is tiled into hypercubes of this shape, outermost axis first, instead of cubes. Anisotropic
+    // arrays can then avoid large uncompressed borders and keep more of every hypercube along their smooth axes.
+    // Supported shapes hold as many values as the default hypercube: 64x64, 32x128, 16x256, 128x32 and 256x16 in 2D,
+    // 16x16x16, 4x32x32, 32x4x32 and all permutations of 8x16x32 in 3D. Streams need room for
+    // compressed_length_bound<T>(data_size, *hypercube_shape) words. Cannot be combined with options other than level
+    // or a reference and is not supported by decompressor::decompress_preview.
+    std::optional<extent> hypercube_shape;
+
+    // Stores every hypercube whose encoding would not be smaller than its values as the values themselves, marked in
+    // the offset header. Encoding and decoding then skip the transform on incompressible data, and the stream never
+    // exceeds the raw size plus headers and side tables, see compressed_length_bound(const extent &, const
+    // stream_options &). Limits streams to 2^30 words, compression and updates throw std::length_error beyond. Only
+    // for lossless streams, cannot be combined with fixed_rate, progressive, hypercube_shape or a reference.
+    bool raw_fallback = false;
+
+    // Encodes the border, the elements outside the grid of whole hypercubes, as hypercubes padded by replicating the
+    // last element instead of storing it uncompressed. Pays off when the array extents are not multiples of the
+    // hypercube side length, above all in 3D. Small borders that do not compress are still stored raw. Cannot be
+    // combined with fixed_rate, progressive, hypercube_shape or a reference.
+    bool compressed_border = false;
+
+    // Compresses arrays that have an axis shorter than the hypercube side length, and would otherwise be stored
+    // uncompressed as border, as lower-dimensional arrays by merging that axis with its neighbour in memory order and
+    // squeezing out singleton axes, e.g. 8x4096x4096 as 32768x4096. The folding is recorded in the stream, whose
+    // remaining options are applied to the folded array. Other arrays are compressed as usual. Streams need room for
+    // compressed_length_bound(const extent &, const stream_options &) words per field. Cannot be combined with
+    // progressive or hypercube_shape, and decompressor::decompress_preview does not support folded streams.
+    bool fold_dimensions = false;
+
+    // Stores a CRC-32C of the encoding of every hypercube and of the border, costing four bytes per hypercube, so that
+    // decompressor::decompress_verified detects corruption while decoding and recovers all intact hypercubes. The
+    // checksums use the SSE 4.2 CRC instruction where available. Cannot be combined with fixed_rate, progressive or
+    // hypercube_shape.
+    bool hypercube_checksums = false;
 };
 
+// Bound for streams compressed with options, which is tighter than compressed_length_bound<T>(data_size) for
+// raw_fallback streams and accounts for fold_dimensions
+template<typename T>
+index_type compressed_length_bound(const extent &data_size, const stream_options &options);
+
 template<typename T>
-std::unique_ptr<compressor<T>> make_compressor(dim_type dims, unsigned num_threads = 0);
+std::unique_ptr<compressor<T>>
+make_compressor(dim_type dims, unsigned num_threads = 0, const stream_options &options = {});
+
+template<typename T>
+std::unique_ptr<decompressor<T>>
+make_decompressor(dim_type dims, unsigned num_threads = 0, const stream_options &options = {});
+
+enum class element_type : uint32_t {
+    float32 = 1,
+    float64 = 2,
+};
+
+template<typename T>
+inline constexpr element_type element_type_of
+        = std::is_same_v<T, double> ? element_type::float64 : element_type::float32;
+
+// An optional frame header that can precede a stream to make it self-describing. It records everything required to
+// decompress the stream and to allocate its output. Streams are written frame_header_size bytes past the header, which
+// keeps them aligned to their word size.
+struct frame_header {
+    element_type type = element_type::float32;
+    extent data_size;
+    stream_options options;
+    uint64_t stream_length = 0;  // in bytes, excluding the frame header
+};
+
+inline constexpr uint32_t frame_format_version = 1;
+inline constexpr size_t frame_header_size = 88;
+
+// Writes frame_header_size bytes, including the format version and a checksum of the header
+void write_frame_header(const frame_header &header, void *dest);
+
+// Returns true if the first `available` bytes at src hold a frame header with a valid checksum
+bool is_frame_header(const void *src, size_t available);
+
+// Throws std::runtime_error if src does not begin with a valid frame header of a supported format version
+frame_header read_frame_header(const void *src, size_t available);
+
+// Creates a decompressor for the stream following `header` with the options recorded in it. Throws
+// std::invalid_argument if T is not the element type of the stream.
+template<typename T>
+std::unique_ptr<decompressor<T>> make_decompressor(const frame_header &header, unsigned num_threads = 0);
+
+// A container holds a sequence of chunks, each a frame header followed by its stream, and ends in an index of the
+// chunks and a footer. Readers locate any chunk through the index without decoding the chunks before it.
+struct container_chunk {
+    uint64_t offset = 0;  // of the frame header, in bytes from the beginning of the container
+    uint64_t length = 0;  // of the frame header and the stream, in bytes
+};
+
+inline constexpr size_t container_footer_size = 24;
+
+// Length in bytes of the index and footer that follow num_chunks chunks
+inline size_t container_index_size(size_t num_chunks) {
+    return num_chunks * 2 * sizeof(uint64_t) + container_footer_size;
+}
+
+// Writes container_index_size(chunks.size()) bytes to be appended after the last chunk
+void write_container_index(const std::vector<container_chunk> &chunks, void *dest);
+
+// Returns true if the container_footer_size bytes at footer are the footer of a container
+bool is_container_footer(const void *footer);
+
+// Reads the chunk index from the end of a container of container_size bytes. Throws std::runtime_error if the container
+// is truncated or its index is corrupt.
+std::vector<container_chunk> read_container_index(const void *container, size_t container_size);
+
+// An archive holds named arrays of different element types and sizes, like a minimal netCDF file. Every variable is a
+// frame header followed by its stream, starting at a multiple of archive_alignment bytes for direct I/O and memory
+// mapping. A directory of all variables and a footer follow the last variable.
+struct archive_variable {
+    std::string name;
+    frame_header header;  // element type, size, stream options and stream length
+    uint64_t offset = 0;  // of the frame header in bytes, a multiple of archive_alignment
+};
+
+inline constexpr size_t archive_alignment = 4096;
+inline constexpr size_t archive_footer_size = 32;
+
+// Length in bytes of the directory and footer describing variables
+size_t archive_directory_size(const std::vector<archive_variable> &variables);
+
+// Writes archive_directory_size(variables) bytes, which must be placed at directory_offset after the last variable.
+// Throws std::invalid_argument if a name is empty or not unique.
+void write_archive_directory(const std::vector<archive_variable> &variables, uint64_t directory_offset, void *dest);
+
+// Returns true if the archive_footer_size bytes at footer are the footer of an archive
+bool is_archive_footer(const void *footer);
+
+// Reads the directory from the end of an archive of archive_size bytes. Throws std::runtime_error if the archive is
+// truncated or its directory is corrupt.
+std::vector<archive_variable> read_archive_directory(const void *archive, size_t archive_size);
+
+// Decompresses a variable of an archive in memory, such as a mapped file, into data, which must have room for all of
+// its values. Only the bytes of this variable are read. Throws std::invalid_argument if T is not its element type.
+template<typename T>
+void extract_variable(const void *archive, const archive_variable &variable, T *data, unsigned num_threads = 0);
+
+// Like extract_variable, but only stores the values inside region into data, an array of size region.size. Only the
+// hypercubes intersecting the region are decoded, see decompressor::decompress_region.
+template<typename T>
+void extract_region(
+        const void *archive, const archive_variable &variable, const box &region, T *data, unsigned num_threads = 0);
+
+enum class tuning_objective {
+    ratio,       // smallest stream
+    throughput,  // fastest compression
+    balanced,    // smallest stream among the configurations that compress at least half as fast as the fastest one
+};
+
+struct tuning_result {
+    stream_options options;
+    double estimated_ratio;       // compressed size relative to the uncompressed array
+    double estimated_throughput;  // uncompressed bytes per second and thread, infinite if no hypercube fits the array
+};
 
+// Chooses the hypercube shape, predictor and compression level for an array by compressing a stratified random sample
+// of about sample_fraction of its hypercubes under every candidate configuration. The chosen options are recorded in
+// the preamble of streams compressed with them, and make_decompressor must be passed the same options.
 template<typename T>
-std::unique_ptr<decompressor<T>> make_decompressor(dim_type dims, unsigned num_threads = 0);
+tuning_result tune(const T *data, const extent &data_size, tuning_objective objective = tuning_objective::ratio,
+        double sample_fraction = 0.05);
 
 class compressor_requirements {
   public:
@@ -44,7 +44,8 @@ enum class target {
 };
 
 template<typename T>
-std::unique_ptr<offloader<T>> make_cpu_offloader(dim_type dims, unsigned num_threads = 0);
+std::unique_ptr<offloader<T>>
+make_cpu_offloader(dim_type dims, unsigned num_threads = 0, const stream_options &options = {});
 
 #if NDZIP_HIPSYCL_SUPPORT
 template<typename T>
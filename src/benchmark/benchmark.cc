@@ -1,10 +1,12 @@
 #include <chrono>
+#include <cmath>
 #include <complex>  // we don't use <complex>, but not including it triggers a CUDA error
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <numeric>
 #include <string>
 #include <thread>
@@ -264,6 +266,18 @@ void assert_buffer_equality(const void *left, const void *right, size_t size) {
     if (memcmp(left, right, size) != 0) { throw buffer_mismatch(); }
 }
 
+// Checks the output of a lossy compressor that keeps mantissa_bits bits of precision per value
+template<typename T>
+void assert_mantissa_precision(const T *input, const T *output, size_t length, int mantissa_bits) {
+    for (size_t i = 0; i < length; ++i) {
+        if (std::isnan(input[i]) && std::isnan(output[i])) { continue; }
+        const auto magnitude = std::max(std::abs(input[i]), std::numeric_limits<T>::min());
+        if (!(output[i] == input[i] || std::abs(output[i] - input[i]) <= std::ldexp(magnitude, -mantissa_bits))) {
+            throw buffer_mismatch();
+        }
+    }
+}
+
 
 class not_implemented : public std::exception {};
 
@@ -297,9 +311,20 @@ static std::chrono::microseconds time_cuda_kernel(cudaEvent_t before, cudaEvent_
 #endif
 
 
+static std::string format_extent(const ndzip::extent &e) {
+    std::string str;
+    for (ndzip::dim_type d = 0; d < e.dimensions(); ++d) {
+        if (d > 0) { str += 'x'; }
+        str += std::to_string(e[d]);
+    }
+    return str;
+}
+
+// The tunable is the compression level, or the number of mantissa bits to keep if truncate_mantissa is set. With
+// auto-tuning, lossless CPU compression uses the stream options selected by ndzip::tune instead.
 template<typename T>
-static benchmark_result benchmark_ndzip_target(
-        ndzip::target target, const T *input_buffer, const metadata &meta, const benchmark_params &params) {
+static benchmark_result benchmark_ndzip_target(ndzip::target target, bool truncate_mantissa, const T *input_buffer,
+        const metadata &meta, const benchmark_params &params) {
     using compressed_type = ndzip::compressed_type<T>;
 
     const auto dims = static_cast<ndzip::dim_type>(meta.dimensions());
@@ -309,8 +334,24 @@ static benchmark_result benchmark_ndzip_target(
     }
 
     std::unique_ptr<ndzip::offloader<T>> offloader;
+    ndzip::stream_options options;
     switch (target) {
-        case ndzip::target::cpu: offloader = ndzip::make_cpu_offloader<T>(dims, params.num_threads); break;
+        case ndzip::target::cpu: {
+            if (truncate_mantissa) {
+                options.mantissa_bits = params.tunable;
+            } else if (params.auto_tune) {
+                const auto tuned = ndzip::tune(input_buffer, extent);
+                options = tuned.options;
+                fprintf(stderr, "ndzip selected level=%d, adaptive_prediction=%d, hypercube_shape=%s for %s\n",
+                        options.level, options.adaptive_prediction,
+                        options.hypercube_shape ? format_extent(*options.hypercube_shape).c_str() : "cubic",
+                        meta.path.filename().c_str());
+            } else {
+                options.level = params.tunable;
+            }
+            offloader = ndzip::make_cpu_offloader<T>(dims, params.num_threads, options);
+            break;
+        }
 
 #if NDZIP_HIPSYCL_SUPPORT
         case ndzip::target::sycl: offloader = ndzip::make_sycl_offloader<T>(dims, true); break;
@@ -326,7 +367,9 @@ static benchmark_result benchmark_ndzip_target(
     const auto uncompressed_length = ndzip::num_elements(extent);
     auto bench = benchmark{params};
 
-    auto compress_buffer = scratch_buffer<compressed_type>{ndzip::compressed_length_bound<T>(extent)};
+    auto compress_buffer = scratch_buffer<compressed_type>{options.hypercube_shape
+                    ? ndzip::compressed_length_bound<T>(extent, *options.hypercube_shape)
+                    : ndzip::compressed_length_bound<T>(extent)};
     size_t compressed_length;
     while (bench.compress_more()) {
         ndzip::kernel_duration duration;
@@ -343,16 +386,22 @@ static benchmark_result benchmark_ndzip_target(
 
     const auto compressed_size = compressed_length * sizeof(compressed_type);
     const auto uncompressed_size = uncompressed_length * sizeof(T);
-    assert_buffer_equality(input_buffer, decompress_buffer.data(), uncompressed_size);
+    if (truncate_mantissa) {
+        assert_mantissa_precision(input_buffer, decompress_buffer.data(), uncompressed_length, params.tunable);
+    } else {
+        assert_buffer_equality(input_buffer, decompress_buffer.data(), uncompressed_size);
+    }
     return std::move(bench).result(uncompressed_size, compressed_size);
 }
 
-static auto benchmark_ndzip(ndzip::target target) {
+static auto benchmark_ndzip(ndzip::target target, bool truncate_mantissa = false) {
     return [=](const void *input_buffer, const metadata &meta, const benchmark_params &params) -> benchmark_result {
         if (meta.data_type == data_type::t_float) {
-            return benchmark_ndzip_target<float>(target, static_cast<const float *>(input_buffer), meta, params);
+            return benchmark_ndzip_target<float>(
+                    target, truncate_mantissa, static_cast<const float *>(input_buffer), meta, params);
         } else {
-            return benchmark_ndzip_target<double>(target, static_cast<const double *>(input_buffer), meta, params);
+            return benchmark_ndzip_target<double>(
+                    target, truncate_mantissa, static_cast<const double *>(input_buffer), meta, params);
         }
     };
 }
@@ -1199,10 +1248,14 @@ const algorithm_map &available_algorithms() {
     // clang-format off
     static const algorithm_map algorithms {
         {"memcpy", {benchmark_memcpy}},
-        {"ndzip", {benchmark_ndzip(ndzip::target::cpu)}},
+        {"ndzip", {benchmark_ndzip(ndzip::target::cpu), 0, 0, ndzip::max_compression_level}},
+        {"ndzip-trunc", {benchmark_ndzip(ndzip::target::cpu, true /* truncate_mantissa */), 4, 12, 20}},
 #if NDZIP_OPENMP_SUPPORT
         {"memcpy-mt", {benchmark_memcpy_mt, 1, 1, 1, true /* multithreaded */}},
-        {"ndzip-mt", {benchmark_ndzip(ndzip::target::cpu), 1, 1, 1, true /* multithreaded */}},
+        {"ndzip-mt",
+                {benchmark_ndzip(ndzip::target::cpu), 0, 0, ndzip::max_compression_level, true /* multithreaded */}},
+        {"ndzip-mt-trunc", {benchmark_ndzip(ndzip::target::cpu, true /* truncate_mantissa */), 4, 12, 20,
+                true /* multithreaded */}},
 #endif
 #if NDZIP_HIPSYCL_SUPPORT
         {"ndzip-sycl", {benchmark_ndzip(ndzip::target::sycl)}},
@@ -1413,7 +1466,7 @@ int main(int argc, char **argv) {
             ("no-mmap", opts::bool_switch(&no_mmap), "do not use memory-mapped I/O")
             ("no-warmup", opts::bool_switch(&no_warmup), "do not perform an additional warm-up step per benchmark")
             ("auto-tune", opts::bool_switch(&auto_tune),
-                    "auto-select optimal configuration per dataset (nvCOMP Cascaded)");
+                    "auto-select optimal configuration per dataset (nvCOMP Cascaded, lossless ndzip CPU)");
     // clang-format on
 
     opts::positional_options_description pos;
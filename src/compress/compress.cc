@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <optional>
+#include <sstream>
 
 #include <boost/program_options.hpp>
+#include <boost/thread.hpp>
 #include <io/io.hh>
 #include <ndzip/offload.hh>
 
@@ -14,15 +24,18 @@ namespace ndzip::detail {
 
 enum class data_type { t_float, t_double };
 
+enum class stream_format { raw, framed, container };
+
 template<typename T>
 void compress_stream(const std::string &in, const std::string &out, const ndzip::extent &size,
-        ndzip::offloader<T> &offloader, const ndzip::detail::io_factory &io) {
+        index_type max_compressed_chunk_length, ndzip::offloader<T> &offloader, const ndzip::detail::io_factory &io,
+        const std::optional<frame_header> &frame) {
     using compressed_type = ndzip::compressed_type<T>;
 
     const auto array_chunk_length = static_cast<size_t>(num_elements(size));
     const auto array_chunk_size = array_chunk_length * sizeof(T);
-    const auto max_compressed_chunk_length = ndzip::compressed_length_bound<T>(size);
-    const auto max_compressed_chunk_size = max_compressed_chunk_length * sizeof(compressed_type);
+    const auto frame_size = frame ? frame_header_size : 0;
+    const auto max_compressed_chunk_size = frame_size + max_compressed_chunk_length * sizeof(compressed_type);
 
     size_t compressed_length = 0;
     size_t n_chunks = 0;
@@ -33,12 +46,18 @@ void compress_stream(const std::string &in, const std::string &out, const ndzip:
 
         while (auto *chunk = in_stream->read_exact()) {
             const auto input_buffer = static_cast<const T *>(chunk);
-            const auto write_buffer = static_cast<compressed_type *>(out_stream->get_write_buffer());
+            const auto write_buffer = static_cast<std::byte *>(out_stream->get_write_buffer());
             kernel_duration chunk_duration;
-            const auto compressed_chunk_length = offloader.compress(input_buffer, size, write_buffer, &chunk_duration);
+            const auto compressed_chunk_length = offloader.compress(input_buffer, size,
+                    reinterpret_cast<compressed_type *>(write_buffer + frame_size), &chunk_duration);
             const auto compressed_chunk_size = compressed_chunk_length * sizeof(compressed_type);
             assert(compressed_chunk_length <= max_compressed_chunk_length);
-            out_stream->commit_chunk(compressed_chunk_size);
+            if (frame) {
+                auto chunk_frame = *frame;
+                chunk_frame.stream_length = compressed_chunk_size;
+                write_frame_header(chunk_frame, write_buffer);
+            }
+            out_stream->commit_chunk(frame_size + compressed_chunk_size);
             compressed_length += compressed_chunk_length;
             total_duration += chunk_duration;
             ++n_chunks;
@@ -47,7 +66,7 @@ void compress_stream(const std::string &in, const std::string &out, const ndzip:
 
     const auto in_file_size = n_chunks * array_chunk_size;
     const auto compressed_size = compressed_length * sizeof(compressed_type);
-    std::cerr << "raw = " << n_chunks * in_file_size << " bytes";
+    std::cerr << "raw = " << in_file_size << " bytes";
     if (n_chunks > 1) { std::cerr << " (" << n_chunks << " chunks à " << array_chunk_size << " bytes)"; }
     std::cerr << ", compressed = " << compressed_size << " bytes";
     std::cerr << ", ratio = " << std::fixed << std::setprecision(4)
@@ -56,15 +75,15 @@ void compress_stream(const std::string &in, const std::string &out, const ndzip:
               << std::chrono::duration_cast<std::chrono::duration<double>>(total_duration).count() << "s\n";
 }
 
-template<typename T>
+// decode(stream, length, data) decompresses one array and returns its stream length
+template<typename T, typename Decode>
 void decompress_stream(const std::string &in, const std::string &out, const ndzip::extent &size,
-        ndzip::offloader<T> &offloader, const ndzip::detail::io_factory &io) {
+        index_type max_compressed_chunk_length, const Decode &decode, const ndzip::detail::io_factory &io) {
     using compressed_type = ndzip::compressed_type<T>;
 
     const auto array_chunk_length = static_cast<size_t>(num_elements(size));
     const auto array_chunk_size = array_chunk_length * sizeof(T);
-    const auto max_compressed_chunk_length = ndzip::compressed_length_bound<T>(size);
-    const auto max_compressed_chunk_size = max_compressed_chunk_length * sizeof(compressed_type);
+    const auto max_compressed_chunk_size = frame_header_size + max_compressed_chunk_length * sizeof(compressed_type);
 
     const auto in_stream = io.create_input_stream(in, max_compressed_chunk_size);
     const auto out_stream = io.create_output_stream(out, array_chunk_size);
@@ -74,65 +93,567 @@ void decompress_stream(const std::string &in, const std::string &out, const ndzi
         const auto [chunk, bytes_in_chunk] = in_stream->read_some(compressed_bytes_left);
         if (bytes_in_chunk == 0) { break; }
 
-        const auto chunk_buffer = static_cast<const compressed_type *>(chunk);
-        const auto chunk_buffer_length = bytes_in_chunk / sizeof(compressed_type);  // floor division!
+        // Framed streams are recognized by their header, which must describe the array being decompressed
+        std::optional<frame_header> frame;
+        if (is_frame_header(chunk, bytes_in_chunk)) {
+            frame = read_frame_header(chunk, bytes_in_chunk);
+            if (frame->type != element_type_of<T> || frame->data_size != size) {
+                throw std::runtime_error{"Frame header describes an array of a different type or size"};
+            }
+        }
+        const auto frame_size = frame ? frame_header_size : 0;
+
+        const auto chunk_buffer = reinterpret_cast<const compressed_type *>(static_cast<const std::byte *>(chunk)
+                + frame_size);
+        const auto chunk_buffer_length = (bytes_in_chunk - frame_size) / sizeof(compressed_type);  // floor division!
         const auto output_buffer = static_cast<T *>(out_stream->get_write_buffer());
-        const auto compressed_length = offloader.decompress(chunk_buffer, chunk_buffer_length, output_buffer, size);
+        const auto compressed_length = decode(chunk_buffer, chunk_buffer_length, output_buffer);
         const auto compressed_size = compressed_length * sizeof(compressed_type);
         assert(compressed_length <= chunk_buffer_length);
+        if (frame && frame->stream_length != compressed_size) {
+            throw std::runtime_error{"Stream length does not match its frame header"};
+        }
         out_stream->commit_chunk(array_chunk_size);
-        compressed_bytes_left = bytes_in_chunk - compressed_size;
+        compressed_bytes_left = bytes_in_chunk - frame_size - compressed_size;
+    }
+}
+
+bool is_container_file(const std::string &file_name) {
+    if (file_name == "-") { return false; }
+    std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+    if (!file || file.tellg() < static_cast<std::streamoff>(container_footer_size)) { return false; }
+    char footer[container_footer_size];
+    file.seekg(-static_cast<std::streamoff>(container_footer_size), std::ios::end);
+    file.read(footer, sizeof footer);
+    return file && is_container_footer(footer);
+}
+
+// Reads a whole file at once, which maps it without copying when using memory-mapped I/O
+std::pair<std::unique_ptr<input_stream>, const std::byte *> read_file(const std::string &file_name,
+        const ndzip::detail::io_factory &io) {
+    const auto file_size = static_cast<size_t>(std::filesystem::file_size(file_name));
+    auto in_stream = io.create_input_stream(file_name, file_size);
+    const auto [data, bytes_read] = in_stream->read_some();
+    if (bytes_read != file_size) { throw io_error{"File " + file_name + " was truncated while reading"}; }
+    return {std::move(in_stream), static_cast<const std::byte *>(data)};
+}
+
+// Writes data through an output stream whose buffer may be smaller
+void write_in_chunks(output_stream &out_stream, size_t buffer_size, const void *data, size_t size) {
+    for (size_t offset = 0; offset < size; offset += buffer_size) {
+        const auto length = std::min(buffer_size, size - offset);
+        memcpy(out_stream.get_write_buffer(), static_cast<const std::byte *>(data) + offset, length);
+        out_stream.commit_chunk(length);
+    }
+}
+
+// Calls f(i, worker) for all i < n on num_workers threads, where worker identifies the calling thread
+template<typename F>
+void parallel_for(size_t n, size_t num_workers, const F &f) {
+    std::atomic<size_t> next{0};
+    std::exception_ptr exception;
+    std::mutex exception_mutex;
+    const auto work = [&](size_t worker) {
+        for (size_t i; (i = next++) < n;) {
+            try {
+                f(i, worker);
+            } catch (...) {
+                std::lock_guard lock{exception_mutex};
+                if (!exception) { exception = std::current_exception(); }
+            }
+        }
+    };
+    std::vector<boost::thread> threads;
+    for (size_t worker = 1; worker < std::min(n, num_workers); ++worker) {
+        threads.emplace_back(work, worker);
+    }
+    work(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (exception) { std::rethrow_exception(exception); }
+}
+
+// Processes the items 0, 1, ... on num_workers threads that live until the last item is done. The calling thread reads
+// items with read(item, slot), which returns false past the last one, and hands them to write(item, slot) in order as
+// soon as process(item, slot, worker) has finished with them, so that I/O overlaps with processing. An item occupies
+// one of 2 * num_workers slots from being read until being written.
+template<typename Read, typename Process, typename Write>
+void ordered_pipeline(size_t num_workers, const Read &read, const Process &process, const Write &write) {
+    const auto num_slots = 2 * num_workers;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::pair<size_t, size_t>> queue;  // items and their slots that are ready to be processed
+    std::vector<bool> processed(num_slots);
+    bool end_of_input = false;
+    std::exception_ptr exception;
+
+    const auto work = [&](size_t worker) {
+        for (;;) {
+            std::unique_lock lock{mutex};
+            cv.wait(lock, [&] { return !queue.empty() || end_of_input; });
+            if (queue.empty()) { return; }
+            const auto [item, slot] = queue.front();
+            queue.pop_front();
+            lock.unlock();
+            std::exception_ptr item_exception;
+            try {
+                process(item, slot, worker);
+            } catch (...) {
+                item_exception = std::current_exception();
+            }
+            lock.lock();
+            if (item_exception && !exception) { exception = item_exception; }
+            processed[slot] = true;
+            cv.notify_all();
+        }
+    };
+    std::vector<boost::thread> threads;
+    for (size_t worker = 0; worker < num_workers; ++worker) {
+        threads.emplace_back(work, worker);
+    }
+
+    try {
+        size_t num_read = 0;
+        size_t num_written = 0;
+        for (bool input_left = true;;) {
+            if (input_left && num_read - num_written < num_slots) {
+                const auto slot = num_read % num_slots;
+                if (read(num_read, slot)) {
+                    std::lock_guard lock{mutex};
+                    processed[slot] = false;
+                    queue.emplace_back(num_read++, slot);
+                    cv.notify_all();
+                } else {
+                    input_left = false;
+                }
+                // Completed items are written between reads without waiting for them
+                std::unique_lock lock{mutex};
+                if (exception) { break; }
+                if (num_written == num_read || !processed[num_written % num_slots]) { continue; }
+            } else {
+                if (num_written == num_read) { break; }
+                std::unique_lock lock{mutex};
+                cv.wait(lock, [&] { return processed[num_written % num_slots]; });
+                if (exception) { break; }
+            }
+            write(num_written, num_written % num_slots);
+            ++num_written;
+        }
+    } catch (...) {
+        std::lock_guard lock{mutex};
+        if (!exception) { exception = std::current_exception(); }
+    }
+
+    {
+        std::lock_guard lock{mutex};
+        end_of_input = true;
+        queue.clear();
+        cv.notify_all();
     }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (exception) { std::rethrow_exception(exception); }
 }
 
+// Compresses chunks concurrently while reading ahead, then appends them in order and records them in the index
 template<typename T>
-void process_stream(bool decompress, const std::string &in, const std::string &out, const ndzip::extent &size,
-        ndzip::offloader<T> &offloader, const ndzip::detail::io_factory &io) {
-    if (decompress) {
-        decompress_stream(in, out, size, offloader, io);
-    } else {
-        compress_stream(in, out, size, offloader, io);
+void compress_container(const std::string &in, const std::string &out, const ndzip::extent &size,
+        index_type max_compressed_chunk_length, std::vector<std::unique_ptr<ndzip::offloader<T>>> &offloaders,
+        const ndzip::detail::io_factory &io, const frame_header &frame) {
+    using compressed_type = ndzip::compressed_type<T>;
+
+    const auto num_workers = offloaders.size();
+    const auto array_chunk_size = static_cast<size_t>(num_elements(size)) * sizeof(T);
+    const auto max_compressed_chunk_size = frame_header_size + max_compressed_chunk_length * sizeof(compressed_type);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<container_chunk> chunks;
+    uint64_t container_size = 0;
+    {
+        auto in_stream = io.create_input_stream(in, array_chunk_size);
+        auto out_stream = io.create_output_stream(out, max_compressed_chunk_size);
+
+        // Input buffers are only filled by streams that cannot hand out chunks which stay valid, see read_exact_into
+        const auto num_slots = 2 * num_workers;
+        std::vector<std::vector<T>> input_buffers(num_slots, std::vector<T>(num_elements(size)));
+        std::vector<const T *> inputs(num_slots);
+        std::vector<std::vector<compressed_type>> outputs(
+                num_slots, std::vector<compressed_type>(max_compressed_chunk_size / sizeof(compressed_type)));
+        std::vector<size_t> output_sizes(num_slots);
+        ordered_pipeline(
+                num_workers,
+                [&](size_t, size_t slot) {
+                    inputs[slot] = static_cast<const T *>(in_stream->read_exact_into(input_buffers[slot].data()));
+                    return inputs[slot] != nullptr;
+                },
+                [&](size_t, size_t slot, size_t worker) {
+                    const auto buffer = reinterpret_cast<std::byte *>(outputs[slot].data());
+                    const auto stream_length = offloaders[worker]->compress(
+                            inputs[slot], size, reinterpret_cast<compressed_type *>(buffer + frame_header_size));
+                    auto chunk_frame = frame;
+                    chunk_frame.stream_length = stream_length * sizeof(compressed_type);
+                    write_frame_header(chunk_frame, buffer);
+                    output_sizes[slot] = frame_header_size + chunk_frame.stream_length;
+                },
+                [&](size_t, size_t slot) {
+                    memcpy(out_stream->get_write_buffer(), outputs[slot].data(), output_sizes[slot]);
+                    out_stream->commit_chunk(output_sizes[slot]);
+                    chunks.push_back(container_chunk{container_size, output_sizes[slot]});
+                    container_size += output_sizes[slot];
+                });
+
+        // The index can be larger than the output buffer
+        std::vector<std::byte> index(container_index_size(chunks.size()));
+        write_container_index(chunks, index.data());
+        write_in_chunks(*out_stream, max_compressed_chunk_size, index.data(), index.size());
+        container_size += index.size();
     }
+
+    const auto in_file_size = chunks.size() * array_chunk_size;
+    std::cerr << "raw = " << in_file_size << " bytes";
+    if (chunks.size() > 1) { std::cerr << " (" << chunks.size() << " chunks à " << array_chunk_size << " bytes)"; }
+    std::cerr << ", compressed = " << container_size << " bytes";
+    std::cerr << ", ratio = " << std::fixed << std::setprecision(4)
+              << (static_cast<double>(container_size) / in_file_size);
+    std::cerr << ", time = " << std::setprecision(3) << std::fixed
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s\n";
 }
 
+// Locates all chunks through the index, decompresses them concurrently and writes them in order
 template<typename T>
-void process_stream(bool decompress, const ndzip::extent &size, ndzip::target target,
-        std::optional<size_t> num_cpu_threads, const std::string &in, const std::string &out,
-        const ndzip::detail::io_factory &io) {
+void decompress_container(const std::string &in, const std::string &out, const ndzip::extent &size,
+        std::vector<std::unique_ptr<ndzip::offloader<T>>> &offloaders, const ndzip::detail::io_factory &io) {
+    using compressed_type = ndzip::compressed_type<T>;
+
+    const auto num_workers = offloaders.size();
+    const auto array_chunk_size = static_cast<size_t>(num_elements(size)) * sizeof(T);
+    const auto container_size = static_cast<size_t>(std::filesystem::file_size(in));
+    const auto [in_stream, container] = read_file(in, io);
+    const auto chunks = read_container_index(container, container_size);
+    const auto out_stream = io.create_output_stream(out, array_chunk_size);
+
+    std::vector<std::vector<T>> outputs(2 * num_workers, std::vector<T>(num_elements(size)));
+    ordered_pipeline(
+            num_workers, [&](size_t i, size_t) { return i < chunks.size(); },
+            [&](size_t i, size_t slot, size_t worker) {
+                const auto &chunk = chunks[i];
+                const auto chunk_data = static_cast<const std::byte *>(container) + chunk.offset;
+                const auto frame = read_frame_header(chunk_data, chunk.length);
+                if (frame.type != element_type_of<T> || frame.data_size != size) {
+                    throw std::runtime_error{"Frame header describes an array of a different type or size"};
+                }
+                if (frame_header_size + frame.stream_length != chunk.length) {
+                    throw std::runtime_error{"Container chunk length does not match its frame header"};
+                }
+                const auto stream_length = frame.stream_length / sizeof(compressed_type);
+                const auto stream = reinterpret_cast<const compressed_type *>(chunk_data + frame_header_size);
+                if (offloaders[worker]->decompress(stream, stream_length, outputs[slot].data(), size)
+                        != stream_length) {
+                    throw std::runtime_error{"Stream length does not match its frame header"};
+                }
+            },
+            [&](size_t, size_t slot) {
+                memcpy(out_stream->get_write_buffer(), outputs[slot].data(), array_chunk_size);
+                out_stream->commit_chunk(array_chunk_size);
+            });
+}
+
+// Decompresses a stream with hypercube checksums, reporting corrupt hypercubes and writing zeros in their place
+template<typename T>
+void decompress_stream_verified(const std::string &in, const std::string &out, const ndzip::extent &size,
+        index_type max_compressed_chunk_length, ndzip::decompressor<T> &decompressor,
+        const ndzip::stream_options &options, const ndzip::detail::io_factory &io) {
+    size_t array_index = 0;
+    size_t num_corrupt = 0;
+    const auto decode = [&](const ndzip::compressed_type<T> *stream, size_t, T *data) {
+        std::fill_n(data, num_elements(size), T{});
+        const auto result = decompressor.decompress_verified(stream, data, size);
+        for (const auto hc_index : result.corrupt_hypercubes) {
+            std::cerr << "Array " << array_index << ": hypercube " << hc_index;
+            if (!options.fold_dimensions) {
+                const auto region = hypercube_region(size, hc_index);
+                for (dim_type d = 0; d < size.dimensions(); ++d) {
+                    std::cerr << (d == 0 ? " at " : "x") << region.offset[d];
+                }
+            }
+            std::cerr << " is corrupt\n";
+        }
+        if (result.corrupt_border) {
+            throw std::runtime_error{"Border of array " + std::to_string(array_index)
+                    + " is corrupt, the arrays following it cannot be located"};
+        }
+        num_corrupt += result.corrupt_hypercubes.size();
+        ++array_index;
+        return result.stream_length;
+    };
+    decompress_stream<T>(in, out, size, max_compressed_chunk_length, decode, io);
+    if (num_corrupt > 0) {
+        throw std::runtime_error{std::to_string(num_corrupt) + " corrupt hypercubes were replaced by zeros"};
+    }
+}
+
+template<typename T>
+void process_stream(bool decompress, bool verify, stream_format format, const ndzip::extent &size,
+        ndzip::target target, std::optional<size_t> num_cpu_threads, const ndzip::stream_options &options,
+        const std::string &in, const std::string &out, const ndzip::detail::io_factory &io) {
+    const auto max_compressed_chunk_length = ndzip::compressed_length_bound<T>(size, options);
+    const frame_header frame{element_type_of<T>, size, options};
+
+    if (format == stream_format::container) {
+        // Containers are processed by independent single-threaded CPU codecs, one per worker
+        std::vector<std::unique_ptr<ndzip::offloader<T>>> offloaders;
+        if (target == ndzip::target::cpu) {
+            const auto num_workers = num_cpu_threads.value_or(boost::thread::physical_concurrency());
+            for (size_t worker = 0; worker < std::max<size_t>(num_workers, 1); ++worker) {
+                offloaders.push_back(ndzip::make_cpu_offloader<T>(size.dimensions(), 1, options));
+            }
+        } else {
+            offloaders.push_back(ndzip::make_offloader<T>(target, size.dimensions(), true /* enable_profiling */));
+        }
+        if (decompress) {
+            decompress_container(in, out, size, offloaders, io);
+        } else {
+            compress_container(in, out, size, max_compressed_chunk_length, offloaders, io, frame);
+        }
+        return;
+    }
+
+    if (verify) {
+        const auto decompressor = ndzip::make_decompressor<T>(size.dimensions(), num_cpu_threads.value_or(0), options);
+        decompress_stream_verified(in, out, size, max_compressed_chunk_length, *decompressor, options, io);
+        return;
+    }
+
     std::unique_ptr<ndzip::offloader<T>> offloader;
-    if (target == ndzip::target::cpu && num_cpu_threads.has_value()) {
-        offloader = ndzip::make_cpu_offloader<T>(size.dimensions(), *num_cpu_threads);
+    if (target == ndzip::target::cpu) {
+        offloader = ndzip::make_cpu_offloader<T>(size.dimensions(), num_cpu_threads.value_or(0), options);
     } else {
         offloader = ndzip::make_offloader<T>(target, size.dimensions(), true /* enable_profiling */);
     }
-    process_stream(decompress, in, out, size, *offloader, io);
+    if (decompress) {
+        const auto decode = [&](const ndzip::compressed_type<T> *stream, size_t length, T *data) {
+            return offloader->decompress(stream, static_cast<index_type>(length), data, size);
+        };
+        decompress_stream<T>(in, out, size, max_compressed_chunk_length, decode, io);
+    } else {
+        compress_stream(in, out, size, max_compressed_chunk_length, *offloader, io,
+                format == stream_format::framed ? std::optional{frame} : std::nullopt);
+    }
 }
 
-void process_stream(bool decompress, const ndzip::extent &size, ndzip::target target,
-        std::optional<size_t> num_cpu_threads, const data_type &data_type, const std::string &in,
-        const std::string &out, const ndzip::detail::io_factory &io) {
+void process_stream(bool decompress, bool verify, stream_format format, const ndzip::extent &size,
+        ndzip::target target, std::optional<size_t> num_cpu_threads, const ndzip::stream_options &options,
+        const data_type &data_type, const std::string &in, const std::string &out,
+        const ndzip::detail::io_factory &io) {
     switch (data_type) {
         case detail::data_type::t_float:
-            return process_stream<float>(decompress, size, target, num_cpu_threads, in, out, io);
+            return process_stream<float>(
+                    decompress, verify, format, size, target, num_cpu_threads, options, in, out, io);
         case detail::data_type::t_double:
-            return process_stream<double>(decompress, size, target, num_cpu_threads, in, out, io);
+            return process_stream<double>(
+                    decompress, verify, format, size, target, num_cpu_threads, options, in, out, io);
         default: std::terminate();
     }
 }
 
+
+// A variable to be added to an archive, given as NAME:TYPE:SIZE:FILE on the command line
+struct archive_input {
+    std::string name;
+    element_type type = element_type::float32;
+    extent size;
+    std::string file_name;
+};
+
+archive_input parse_archive_input(const std::string &spec) {
+    const auto invalid = opts::error{"Invalid variable " + spec + ", expected NAME:TYPE:SIZE:FILE"};
+    std::vector<std::string> fields;
+    size_t begin = 0;
+    for (int f = 0; f < 3; ++f) {
+        const auto end = spec.find(':', begin);
+        if (end == std::string::npos) { throw invalid; }
+        fields.push_back(spec.substr(begin, end - begin));
+        begin = end + 1;
+    }
+
+    archive_input input;
+    input.name = fields[0];
+    input.file_name = spec.substr(begin);
+    if (input.name.empty() || input.file_name.empty()) { throw invalid; }
+    if (fields[1] == "float") {
+        input.type = element_type::float32;
+    } else if (fields[1] == "double") {
+        input.type = element_type::float64;
+    } else {
+        throw invalid;
+    }
+
+    std::vector<index_type> components;
+    std::istringstream size_stream{fields[2]};
+    for (std::string component; std::getline(size_stream, component, 'x');) {
+        try {
+            components.push_back(static_cast<index_type>(std::stoul(component)));
+        } catch (std::exception &) { throw invalid; }
+    }
+    if (components.empty() || components.size() > max_dimensionality) { throw invalid; }
+    input.size = extent(static_cast<dim_type>(components.size()));
+    std::copy(components.begin(), components.end(), input.size.begin());
+    return input;
+}
+
+const char *element_type_name(element_type type) {
+    return type == element_type::float64 ? "double" : "float";
+}
+
+template<typename F>
+decltype(auto) visit_element_type(element_type type, const F &f) {
+    if (type == element_type::float64) {
+        return f(double{});
+    } else {
+        return f(float{});
+    }
+}
+
+// Compresses a batch of one variable per worker concurrently and appends them at aligned offsets, then writes the
+// directory
+void create_archive(const std::vector<archive_input> &inputs, const std::string &out, size_t num_workers,
+        const ndzip::stream_options &options, const ndzip::detail::io_factory &io) {
+    constexpr size_t buffer_size = size_t{1} << 20;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<archive_variable> variables;
+    uint64_t archive_size = 0;
+    uint64_t raw_size = 0;
+    {
+        const auto out_stream = io.create_output_stream(out, buffer_size);
+        const std::vector<std::byte> padding(archive_alignment);
+        std::vector<std::vector<std::byte>> frames(num_workers);
+        for (size_t first = 0; first < inputs.size(); first += num_workers) {
+            const auto batch_size = std::min(num_workers, inputs.size() - first);
+            parallel_for(batch_size, num_workers, [&](size_t i, size_t) {
+                const auto &input = inputs[first + i];
+                visit_element_type(input.type, [&](auto value) {
+                    using T = decltype(value);
+                    using compressed_type = ndzip::compressed_type<T>;
+                    const auto array_size = num_elements(input.size) * sizeof(T);
+                    if (std::filesystem::file_size(input.file_name) != array_size) {
+                        throw io_error{"Size of " + input.file_name + " does not match the size of " + input.name};
+                    }
+                    const auto in_stream = io.create_input_stream(input.file_name, array_size);
+                    const auto data = static_cast<const T *>(in_stream->read_exact());
+
+                    auto &frame = frames[i];
+                    frame.resize(frame_header_size
+                            + ndzip::compressed_length_bound<T>(input.size, options) * sizeof(compressed_type));
+                    const auto stream_length = make_compressor<T>(input.size.dimensions(), 1, options)
+                                                       ->compress(data, input.size,
+                                                               reinterpret_cast<compressed_type *>(
+                                                                       frame.data() + frame_header_size));
+                    const frame_header header{
+                            input.type, input.size, options, stream_length * sizeof(compressed_type)};
+                    write_frame_header(header, frame.data());
+                    frame.resize(frame_header_size + header.stream_length);
+                });
+            });
+
+            for (size_t i = 0; i < batch_size; ++i) {
+                const auto &input = inputs[first + i];
+                const auto aligned_size
+                        = (archive_size + archive_alignment - 1) / archive_alignment * archive_alignment;
+                write_in_chunks(*out_stream, buffer_size, padding.data(), aligned_size - archive_size);
+                write_in_chunks(*out_stream, buffer_size, frames[i].data(), frames[i].size());
+                variables.push_back(archive_variable{input.name, read_frame_header(frames[i].data(), frames[i].size()),
+                        aligned_size});
+                archive_size = aligned_size + frames[i].size();
+                raw_size += num_elements(input.size)
+                        * (input.type == element_type::float64 ? sizeof(double) : sizeof(float));
+            }
+        }
+
+        std::vector<std::byte> directory(archive_directory_size(variables));
+        write_archive_directory(variables, archive_size, directory.data());
+        write_in_chunks(*out_stream, buffer_size, directory.data(), directory.size());
+        archive_size += directory.size();
+    }
+
+    std::cerr << "raw = " << raw_size << " bytes (" << variables.size() << " variables)";
+    std::cerr << ", compressed = " << archive_size << " bytes";
+    std::cerr << ", ratio = " << std::fixed << std::setprecision(4)
+              << (static_cast<double>(archive_size) / static_cast<double>(raw_size));
+    std::cerr << ", time = " << std::setprecision(3) << std::fixed
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s\n";
+}
+
+void list_archive(const std::string &in, const ndzip::detail::io_factory &io) {
+    const auto [in_stream, archive] = read_file(in, io);
+    for (auto &variable : read_archive_directory(archive, std::filesystem::file_size(in))) {
+        std::cout << variable.name << '\t' << element_type_name(variable.header.type) << '\t';
+        for (dim_type d = 0; d < variable.header.data_size.dimensions(); ++d) {
+            std::cout << (d > 0 ? "x" : "") << variable.header.data_size[d];
+        }
+        std::cout << '\t' << variable.header.stream_length << " bytes\n";
+    }
+}
+
+// Extracts one variable or a region of it to `out`, or several variables concurrently into the directory `out`
+void extract_from_archive(const std::string &in, const std::vector<std::string> &names,
+        const std::optional<box> &region, const std::string &out, size_t num_workers,
+        const ndzip::detail::io_factory &io) {
+    const auto [in_stream, archive] = read_file(in, io);
+    const auto variables = read_archive_directory(archive, std::filesystem::file_size(in));
+
+    std::vector<const archive_variable *> selected;
+    for (auto &name : names) {
+        const auto it = std::find_if(variables.begin(), variables.end(), [&](auto &v) { return v.name == name; });
+        if (it == variables.end()) { throw std::runtime_error{"Archive has no variable " + name}; }
+        selected.push_back(&*it);
+    }
+
+    // A single variable is decoded by all workers, several by one worker each
+    if (selected.size() > 1) { std::filesystem::create_directories(out); }
+    const auto threads_per_variable = selected.size() == 1 ? static_cast<unsigned>(num_workers) : 1u;
+    parallel_for(selected.size(), num_workers, [&](size_t i, size_t) {
+        const auto &variable = *selected[i];
+        const auto file_name = selected.size() == 1 ? out : (std::filesystem::path{out} / variable.name).string();
+        visit_element_type(variable.header.type, [&](auto value) {
+            using T = decltype(value);
+            const auto size = region ? region->size : variable.header.data_size;
+            const auto array_size = num_elements(size) * sizeof(T);
+            const auto out_stream = io.create_output_stream(file_name, array_size);
+            const auto data = static_cast<T *>(out_stream->get_write_buffer());
+            if (region) {
+                extract_region(archive, variable, *region, data, threads_per_variable);
+            } else {
+                extract_variable(archive, variable, data, threads_per_variable);
+            }
+            out_stream->commit_chunk(array_size);
+        });
+    });
+}
+
 }  // namespace ndzip::detail
 
 int main(int argc, char **argv) {
     using namespace std::string_literals;
 
     bool decompress = false;
+    bool verify = false;
+    bool framed = false;
+    bool container = false;
     bool no_mmap = false;
     std::vector<ndzip::index_type> size_components;
+    std::vector<ndzip::index_type> hypercube_shape_components;
+    std::vector<std::string> add_specs;
+    bool list = false;
+    std::vector<std::string> extract_names;
+    std::vector<ndzip::index_type> region_components;
     std::string input = "-";
     std::string output = "-";
     std::string data_type_str = "float";
     std::string target_str = "cpu";
     size_t num_threads_or_0 = 0;
+    ndzip::stream_options options;
 
     auto usage = "Usage: "s + argv[0] + " [options]\n\n";
 
@@ -141,8 +662,9 @@ int main(int argc, char **argv) {
     desc.add_options()
         ("help", "show this help")
         ("decompress,d", opts::bool_switch(&decompress), "decompress (default compress)")
-        ("array-size,n", opts::value(&size_components)->required()->multitoken(),
-                "array size (one value per dimension, first-major)")
+        ("array-size,n", opts::value(&size_components)->multitoken(),
+                "array size (one value per dimension, first-major), read from the frame header when decompressing "
+                "framed streams")
         ("data-type,t", opts::value(&data_type_str), "float|double (default float)")
         ("target_str,e", opts::value(&target_str), "cpu"
 #if NDZIP_HIPSYCL_SUPPORT
@@ -153,6 +675,49 @@ int main(int argc, char **argv) {
 #endif
                                              " (default cpu)")
         ("threads,T", opts::value(&num_threads_or_0), "number of CPU threads")
+        ("level,l", opts::value(&options.level), "compression level 0-2, cpu target only (default 0)")
+        ("error-bound", opts::value(&options.error_bound),
+                "compress lossily with this absolute error bound, cpu target only (default 0 = lossless)")
+        ("mantissa-bits", opts::value(&options.mantissa_bits),
+                "compress lossily keeping this many mantissa bits, cpu target only (default 0 = lossless)")
+        ("fixed-rate", opts::value(&options.fixed_rate),
+                "compress lossily to exactly this many bits per value, cpu target only (default 0 = lossless)")
+        ("progressive", opts::bool_switch(&options.progressive),
+                "order the stream by bit plane for partial decoding, cpu target only")
+        ("deduplicate", opts::bool_switch(&options.deduplicate),
+                "encode repeated hypercubes as references to their first occurrence, cpu target only")
+        ("prediction-chain", opts::value(&options.prediction_chain_length),
+                "predict hypercubes from their predecessor along the innermost dimension in chains of this length, "
+                "cpu target only (default 0 = off)")
+        ("hypercube-shape", opts::value(&hypercube_shape_components)->multitoken(),
+                "tile the array with hypercubes of this shape (one value per dimension, first-major), "
+                "cpu target only (default cubic)")
+        ("raw-fallback", opts::bool_switch(&options.raw_fallback),
+                "store hypercubes that do not compress as raw values, cpu target only")
+        ("compressed-border", opts::bool_switch(&options.compressed_border),
+                "encode the border as padded hypercubes instead of storing it raw, cpu target only")
+        ("fold-dimensions", opts::bool_switch(&options.fold_dimensions),
+                "compress arrays with axes shorter than a hypercube as lower-dimensional arrays, cpu target only")
+        ("hypercube-checksums", opts::bool_switch(&options.hypercube_checksums),
+                "store a checksum of every hypercube for verified decompression, cpu target only")
+        ("verify", opts::bool_switch(&verify),
+                "when decompressing a stream with hypercube checksums, report corrupt hypercubes and write zeros in "
+                "their place")
+        ("framed", opts::bool_switch(&framed),
+                "precede every stream by a frame header recording the array size, data type and stream options")
+        ("container", opts::bool_switch(&container),
+                "write framed streams followed by a chunk index, so that chunks are compressed and decompressed in "
+                "parallel by -T threads")
+        ("add", opts::value(&add_specs)->composing(),
+                "add a variable given as NAME:TYPE:SIZE:FILE, e.g. temperature:float:64x256x256:t.bin, to the "
+                "archive written to -o; repeatable, variables are compressed in parallel by -T threads")
+        ("list", opts::bool_switch(&list), "list the variables of the archive read from -i")
+        ("extract", opts::value(&extract_names)->composing(),
+                "extract this variable from the archive read from -i; repeatable, several variables are extracted "
+                "in parallel into the directory -o (default '.')")
+        ("region", opts::value(&region_components)->multitoken(),
+                "with a single --extract, only extract this region (one offset per dimension followed by one size "
+                "per dimension)")
         ("input,i", opts::value(&input), "input file (default '-' is stdin)")
         ("output,o", opts::value(&output), "output file (default '-' is stdout)")
         ("no-mmap", opts::bool_switch(&no_mmap), "do not use memory-mapped I/O");
@@ -162,7 +727,10 @@ int main(int argc, char **argv) {
     ndzip::target target;
     ndzip::extent size;
     ndzip::detail::data_type data_type;
+    ndzip::detail::stream_format format = ndzip::detail::stream_format::raw;
     std::optional<size_t> opt_num_threads;
+    std::vector<ndzip::detail::archive_input> archive_inputs;
+    std::optional<ndzip::box> region;
     try {
         auto parsed = opts::command_line_parser(argc, argv).options(desc).run();
         opts::store(parsed, vars);
@@ -188,12 +756,84 @@ int main(int argc, char **argv) {
             throw opts::error{"Unimplemented target " + target_str};
         }
 
-        if (size_components.empty() || size_components.size() > 3) {
-            throw opts::error{"Expected between 1 and 3 dimensions, got " + std::to_string(size_components.size())};
+        const bool archive_mode = !add_specs.empty() || list || !extract_names.empty();
+        if (archive_mode) {
+            if ((!add_specs.empty()) + list + (!extract_names.empty()) != 1 || decompress || framed || container) {
+                throw opts::error{"--add, --list and --extract cannot be combined with each other or other modes"};
+            }
+            if (target != ndzip::target::cpu) { throw opts::error{"Archives are only supported by the cpu target"}; }
+            if (!size_components.empty() || !hypercube_shape_components.empty()) {
+                throw opts::error{"Archive variables carry their own array size"};
+            }
+            if (!add_specs.empty() && output == "-") { throw opts::error{"Archives cannot be written to stdout"}; }
+            if ((list || !extract_names.empty()) && input == "-") {
+                throw opts::error{"Archives cannot be read from stdin"};
+            }
+            for (auto &spec : add_specs) {
+                archive_inputs.push_back(ndzip::detail::parse_archive_input(spec));
+            }
+            if (extract_names.size() > 1 && output == "-") { output = "."; }
+            if (!region_components.empty()) {
+                const auto dims = region_components.size() / 2;
+                if (extract_names.size() != 1 || region_components.size() % 2 != 0 || dims < 1 || dims > 3) {
+                    throw opts::error{"--region requires a single --extract and one offset and size per dimension"};
+                }
+                region = ndzip::box{ndzip::extent(static_cast<ndzip::dim_type>(dims)),
+                        ndzip::extent(static_cast<ndzip::dim_type>(dims))};
+                for (size_t d = 0; d < dims; ++d) {
+                    region->offset[d] = region_components[d];
+                    region->size[d] = region_components[dims + d];
+                }
+            }
+        } else if (!region_components.empty()) {
+            throw opts::error{"--region requires --extract"};
+        } else if (decompress) {
+            // Framed streams are recognized while decompressing, containers by their footer
+            format = ndzip::detail::is_container_file(input) ? ndzip::detail::stream_format::container
+                                                             : ndzip::detail::stream_format::raw;
+        } else {
+            format = container ? ndzip::detail::stream_format::container
+                    : framed   ? ndzip::detail::stream_format::framed
+                               : ndzip::detail::stream_format::raw;
+        }
+
+        if (decompress && size_components.empty()) {
+            // Array size, data type and stream options are recorded in the frame header of the first stream
+            if (input == "-") { throw opts::error{"Array size is required when decompressing from stdin"}; }
+            std::ifstream file(input, std::ios::binary);
+            char header_bytes[ndzip::frame_header_size];
+            file.read(header_bytes, sizeof header_bytes);
+            if (!ndzip::is_frame_header(header_bytes, static_cast<size_t>(file.gcount()))) {
+                throw opts::error{"Input does not begin with a frame header, array size is required"};
+            }
+            const auto frame = ndzip::read_frame_header(header_bytes, sizeof header_bytes);
+            size_components.assign(frame.data_size.begin(), frame.data_size.end());
+            const auto frame_type_str = frame.type == ndzip::element_type::float64 ? "double" : "float";
+            if (vars.count("data-type") && data_type_str != frame_type_str) {
+                throw opts::error{"Data type does not match the frame header"};
+            }
+            data_type_str = frame_type_str;
+            options = frame.options;
         }
-        size = ndzip::extent(static_cast<ndzip::dim_type>(size_components.size()));
-        for (ndzip::dim_type d = 0; d < size.dimensions(); ++d) {
-            size[d] = size_components[d];
+
+        if (!archive_mode) {
+            if (size_components.empty() || size_components.size() > 3) {
+                throw opts::error{
+                        "Expected between 1 and 3 dimensions, got " + std::to_string(size_components.size())};
+            }
+            size = ndzip::extent(static_cast<ndzip::dim_type>(size_components.size()));
+            for (ndzip::dim_type d = 0; d < size.dimensions(); ++d) {
+                size[d] = size_components[d];
+            }
+            if (!hypercube_shape_components.empty()) {
+                if (hypercube_shape_components.size() != size_components.size()) {
+                    throw opts::error{"Hypercube shape must have one value per dimension"};
+                }
+                options.hypercube_shape = ndzip::extent(size.dimensions());
+                for (ndzip::dim_type d = 0; d < size.dimensions(); ++d) {
+                    (*options.hypercube_shape)[d] = hypercube_shape_components[d];
+                }
+            }
         }
 
         if (data_type_str == "float") {
@@ -206,6 +846,22 @@ int main(int argc, char **argv) {
 
         if (num_threads_or_0 != 0) { opt_num_threads = num_threads_or_0; }
 
+        if ((options.level != 0 || options.progressive || options.deduplicate || options.prediction_chain_length != 0
+                    || options.hypercube_shape || options.raw_fallback || options.compressed_border
+                    || options.fold_dimensions || options.hypercube_checksums)
+                && target != ndzip::target::cpu) {
+            throw opts::error{"Compression levels and optional stream layouts are only supported by the cpu target"};
+        }
+        if ((options.error_bound != 0 || options.mantissa_bits != 0 || options.fixed_rate != 0)
+                && target != ndzip::target::cpu) {
+            throw opts::error{"Lossy compression is only supported by the cpu target"};
+        }
+        if (verify
+                && (!decompress || !options.hypercube_checksums || archive_mode
+                        || format == ndzip::detail::stream_format::container)) {
+            throw opts::error{"--verify requires decompressing a stream with hypercube checksums"};
+        }
+
     } catch (opts::error &e) {
         std::cerr << e.what() << "\n\n" << usage << desc;
         return EXIT_FAILURE;
@@ -218,7 +874,21 @@ int main(int argc, char **argv) {
     if (!io_factory) { io_factory = std::make_unique<ndzip::detail::stdio_io_factory>(); }
 
     try {
-        ndzip::detail::process_stream(decompress, size, target, opt_num_threads, data_type, input, output, *io_factory);
+        const auto num_workers = std::max<size_t>(opt_num_threads.value_or(boost::thread::physical_concurrency()), 1);
+        if (!archive_inputs.empty()) {
+            ndzip::detail::create_archive(archive_inputs, output, num_workers, options, *io_factory);
+            return EXIT_SUCCESS;
+        }
+        if (list) {
+            ndzip::detail::list_archive(input, *io_factory);
+            return EXIT_SUCCESS;
+        }
+        if (!extract_names.empty()) {
+            ndzip::detail::extract_from_archive(input, extract_names, region, output, num_workers, *io_factory);
+            return EXIT_SUCCESS;
+        }
+        ndzip::detail::process_stream(decompress, verify, format, size, target, opt_num_threads, options, data_type,
+                input, output, *io_factory);
         return EXIT_SUCCESS;
     } catch (opts::error &e) {
         std::cerr << e.what() << "\n\n" << usage << desc;
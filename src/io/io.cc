@@ -63,6 +63,19 @@ class stdio_input_stream final : public input_stream {
         }
     }
 
+    const void *read_exact_into(void *buffer) override {
+        auto bytes_read = fread(buffer, 1, _chunk_size, _file);
+        if (bytes_read < _chunk_size && ferror(_file)) { throw io_error("fread: "s + strerror(errno)); }
+        if (bytes_read == _chunk_size) {
+            ++_n_chunks;
+            return buffer;
+        } else if (bytes_read == 0) {
+            return nullptr;
+        } else {
+            throw io_error("Input file size is not a multiple of the chunk size");
+        }
+    }
+
   private:
     FILE *_file;
     size_t _chunk_size;
@@ -166,6 +179,9 @@ class mmap_input_stream final : public input_stream {
         }
     }
 
+    // The whole file is mapped, so chunks stay valid without a copy
+    const void *read_exact_into(void *) override { return read_exact(); }
+
   private:
     int _fd = STDIN_FILENO;
     size_t _max_chunk_size;
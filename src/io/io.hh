@@ -28,6 +28,10 @@ class input_stream {
     std::pair<const void *, size_t> read_some() { return read_some(0); }
 
     virtual const void *read_exact() = 0;
+
+    // Like read_exact, but the returned chunk stays valid until the stream is destroyed. Streams that reuse a single
+    // buffer read the chunk into `buffer` instead, which must hold chunk_length bytes.
+    virtual const void *read_exact_into(void *buffer) = 0;
 };
 
 class output_stream {
@@ -29,16 +29,29 @@ compressor_requirements::compressor_requirements(std::initializer_list<extent> d
 
 
 template<typename T, ndzip::dim_type Dims>
-static index_type compressed_length_bound(const detail::static_extent<Dims> &size) {
+static index_type
+compressed_length_bound(const detail::static_extent<Dims> &size, const detail::static_extent<Dims> &hc_shape) {
     using profile = detail::profile<T, Dims>;
     using bits_type = typename profile::bits_type;
 
-    const auto num_hypercubes = detail::num_hypercubes(size);
+    // All hypercube shapes hold the same number of values, so only the number of hypercubes and the border change
+    const auto num_hypercubes = detail::num_hypercubes(size, hc_shape);
     const auto header_length
             = detail::div_ceil(num_hypercubes, detail::bits_of<bits_type> / detail::bits_of<index_type>);
-    const auto compressed_length_bound = num_hypercubes * profile::compressed_block_length_bound;
-    const auto border_length = detail::border_element_count(size, profile::hypercube_side_length);
-    return header_length + compressed_length_bound + border_length;
+    const auto compressed_length_bound = num_hypercubes * profile::entropy_coded_block_length_bound;
+    const auto border_length = detail::border_element_count(size, hc_shape);
+    const auto prefix_length
+            = detail::stream_prefix_length<bits_type>(detail::preamble{detail::preamble::known_flags}, num_hypercubes);
+    const auto plane_table_length = detail::bits_of<bits_type>;  // progressive streams only
+    const auto border_encoding_length = 1;                         // stream_options::compressed_border only
+    return prefix_length + header_length + compressed_length_bound + border_length + plane_table_length
+            + border_encoding_length;
+}
+
+template<typename T, ndzip::dim_type Dims>
+static index_type compressed_length_bound(const detail::static_extent<Dims> &size) {
+    const auto hc_shape = detail::static_extent<Dims>::broadcast(detail::hypercube_side_length<Dims>);
+    return compressed_length_bound<T>(size, hc_shape);
 }
 
 template<typename T>
@@ -51,7 +64,432 @@ index_type compressed_length_bound(const extent &size) {
     }
 }
 
+template<typename T>
+index_type compressed_length_bound(const extent &size, const extent &hypercube_shape) {
+    if (hypercube_shape.dimensions() != size.dimensions()) {
+        throw std::invalid_argument{"hypercube shape dimensionality does not match data dimensionality"};
+    }
+    switch (size.dimensions()) {
+        case 1:
+            return compressed_length_bound<T, 1>(
+                    detail::static_extent<1>{size}, detail::static_extent<1>{hypercube_shape});
+        case 2:
+            return compressed_length_bound<T, 2>(
+                    detail::static_extent<2>{size}, detail::static_extent<2>{hypercube_shape});
+        case 3:
+            return compressed_length_bound<T, 3>(
+                    detail::static_extent<3>{size}, detail::static_extent<3>{hypercube_shape});
+        default: abort();
+    }
+}
+
+template<typename T, ndzip::dim_type Dims>
+static index_type raw_fallback_length_bound(const detail::static_extent<Dims> &size, const stream_options &options) {
+    using profile = detail::profile<T, Dims>;
+    using bits_type = typename profile::bits_type;
+
+    // Every hypercube is either smaller than its values or stored raw
+    const auto hc_size = detail::ipow(profile::hypercube_side_length, Dims);
+    const auto num_hypercubes = detail::num_hypercubes(size);
+    const auto header_length
+            = detail::div_ceil(num_hypercubes, detail::bits_of<bits_type> / detail::bits_of<index_type>);
+    const auto border_length = detail::border_element_count(size, profile::hypercube_side_length)
+            + (options.compressed_border ? 1 : 0);
+    const auto prefix_length
+            = detail::stream_prefix_length<bits_type>(detail::make_preamble(options, false), num_hypercubes);
+    return prefix_length + header_length + num_hypercubes * hc_size + border_length;
+}
+
+template<typename T>
+index_type compressed_length_bound(const extent &size, const stream_options &options) {
+    if (options.fold_dimensions) {
+        if (const auto folding = detail::fold_dimensions(size)) {
+            auto folded_options = options;
+            folded_options.fold_dimensions = false;
+            return detail::preamble_length<detail::bits_type<T>>(detail::make_folded_preamble(folding->folded_size))
+                    + compressed_length_bound<T>(folding->folded_size, folded_options);
+        }
+    }
+    if (options.hypercube_shape) { return compressed_length_bound<T>(size, *options.hypercube_shape); }
+    if (!options.raw_fallback) { return compressed_length_bound<T>(size); }
+    switch (size.dimensions()) {
+        case 1: return raw_fallback_length_bound<T, 1>(detail::static_extent<1>{size}, options);
+        case 2: return raw_fallback_length_bound<T, 2>(detail::static_extent<2>{size}, options);
+        case 3: return raw_fallback_length_bound<T, 3>(detail::static_extent<3>{size}, options);
+        default: abort();
+    }
+}
+
 template index_type compressed_length_bound<float>(const extent &);
 template index_type compressed_length_bound<double>(const extent &);
+template index_type compressed_length_bound<float>(const extent &, const extent &);
+template index_type compressed_length_bound<double>(const extent &, const extent &);
+template index_type compressed_length_bound<float>(const extent &, const stream_options &);
+template index_type compressed_length_bound<double>(const extent &, const stream_options &);
+
+template<typename T, dim_type Dims>
+static index_type progressive_prefix_length(
+        const compressed_type<T> *stream, const detail::static_extent<Dims> &size, unsigned num_planes) {
+    using profile = detail::profile<T, Dims>;
+    using bits_type = typename profile::bits_type;
+
+    if (num_planes > detail::bits_of<bits_type>) {
+        throw std::invalid_argument{"number of bit planes exceeds the width of the value type"};
+    }
+    const auto layout
+            = detail::progressive_stream_layout<profile>(detail::preamble{detail::preamble::progressive}, size);
+    if (num_planes == 0) { return layout.planes; }
+
+    if (detail::read_preamble(stream).flags != detail::preamble::progressive) {
+        throw std::runtime_error{"stream is not progressive"};
+    }
+    detail::validate_plane_table(stream, layout);
+    return static_cast<index_type>(stream[layout.plane_table + num_planes - 1]);
+}
+
+template<typename T>
+index_type progressive_prefix_length(const compressed_type<T> *stream, const extent &data_size, unsigned num_planes) {
+    switch (data_size.dimensions()) {
+        case 1: return progressive_prefix_length<T, 1>(stream, detail::static_extent<1>{data_size}, num_planes);
+        case 2: return progressive_prefix_length<T, 2>(stream, detail::static_extent<2>{data_size}, num_planes);
+        case 3: return progressive_prefix_length<T, 3>(stream, detail::static_extent<3>{data_size}, num_planes);
+        default: abort();
+    }
+}
+
+template index_type progressive_prefix_length<float>(const compressed_type<float> *, const extent &, unsigned);
+template index_type progressive_prefix_length<double>(const compressed_type<double> *, const extent &, unsigned);
+
+box hypercube_region(const extent &data_size, index_type hc_index) {
+    const auto dims = data_size.dimensions();
+    const auto side_length = dims == 1 ? detail::hypercube_side_length<1>
+            : dims == 2                ? detail::hypercube_side_length<2>
+                                       : detail::hypercube_side_length<3>;
+    box region{extent(dims), extent(dims)};
+    index_type grid_size = 1;
+    for (dim_type d = dims; d-- > 0;) {
+        const auto hcs_along_d = data_size[d] / side_length;
+        region.offset[d] = (hcs_along_d == 0 ? 0 : hc_index / grid_size % hcs_along_d) * side_length;
+        region.size[d] = side_length;
+        grid_size *= hcs_along_d;
+    }
+    if (hc_index >= grid_size) { throw std::invalid_argument{"hypercube index out of range"}; }
+    return region;
+}
+
+namespace frame {
+
+constexpr uint32_t magic = 0x465a444e;  // "NDZF" in little endian
+constexpr size_t checksum_offset = frame_header_size - sizeof(uint64_t);
+
+enum option_flag : uint32_t {
+    adaptive_prediction = 1u << 0,
+    progressive = 1u << 1,
+    hypercube_means = 1u << 2,
+    hypercube_bounds = 1u << 3,
+    deduplicate = 1u << 4,
+    raw_fallback = 1u << 5,
+    compressed_border = 1u << 6,
+    fold_dimensions = 1u << 7,
+    hypercube_shape = 1u << 8,
+    hypercube_checksums = 1u << 9,
+};
+constexpr uint32_t known_option_flags = adaptive_prediction | progressive | hypercube_means | hypercube_bounds
+        | deduplicate | raw_fallback | compressed_border | fold_dimensions | hypercube_shape | hypercube_checksums;
+
+uint64_t checksum(const void *header) {
+    return detail::xxhash64(header, checksum_offset, magic);
+}
+
+}  // namespace frame
+
+void write_frame_header(const frame_header &header, void *dest) {
+    const auto dims = header.data_size.dimensions();
+    if (dims < 1 || dims > max_dimensionality) { throw std::invalid_argument{"frame header has no data size"}; }
+    const auto &options = header.options;
+    if (options.hypercube_shape && options.hypercube_shape->dimensions() != dims) {
+        throw std::invalid_argument{"hypercube shape dimensionality does not match data dimensionality"};
+    }
+
+    auto out = static_cast<std::byte *>(dest);
+    memset(out, 0, frame_header_size);
+    const auto put = [&](auto value) {
+        detail::store_unaligned(out, value);
+        out += sizeof value;
+    };
+    uint32_t flags = 0;
+    if (options.adaptive_prediction) { flags |= frame::adaptive_prediction; }
+    if (options.progressive) { flags |= frame::progressive; }
+    if (options.hypercube_means) { flags |= frame::hypercube_means; }
+    if (options.hypercube_bounds) { flags |= frame::hypercube_bounds; }
+    if (options.deduplicate) { flags |= frame::deduplicate; }
+    if (options.raw_fallback) { flags |= frame::raw_fallback; }
+    if (options.compressed_border) { flags |= frame::compressed_border; }
+    if (options.fold_dimensions) { flags |= frame::fold_dimensions; }
+    if (options.hypercube_shape) { flags |= frame::hypercube_shape; }
+    if (options.hypercube_checksums) { flags |= frame::hypercube_checksums; }
+
+    put(frame::magic);
+    put(frame_format_version);
+    put(static_cast<uint32_t>(header.type));
+    put(static_cast<uint32_t>(dims));
+    for (dim_type d = 0; d < max_dimensionality; ++d) {
+        put(d < dims ? header.data_size[d] : index_type{0});
+    }
+    put(flags);
+    put(static_cast<uint32_t>(options.level));
+    put(static_cast<uint32_t>(options.mantissa_bits));
+    put(static_cast<uint32_t>(options.fixed_rate));
+    put(static_cast<uint32_t>(options.prediction_chain_length));
+    for (dim_type d = 0; d < max_dimensionality; ++d) {
+        put(options.hypercube_shape && d < dims ? (*options.hypercube_shape)[d] : index_type{0});
+    }
+    put(uint32_t{0});  // padding
+    put(options.error_bound);
+    put(header.stream_length);
+    assert(out == static_cast<std::byte *>(dest) + frame::checksum_offset);
+    put(frame::checksum(dest));
+}
+
+bool is_frame_header(const void *src, size_t available) {
+    return available >= frame_header_size && detail::load_unaligned<uint32_t>(src) == frame::magic
+            && detail::load_unaligned<uint64_t>(static_cast<const std::byte *>(src) + frame::checksum_offset)
+            == frame::checksum(src);
+}
+
+frame_header read_frame_header(const void *src, size_t available) {
+    if (!is_frame_header(src, available)) { throw std::runtime_error{"stream does not begin with a frame header"}; }
+
+    auto in = static_cast<const std::byte *>(src) + sizeof frame::magic;
+    const auto get = [&](auto &value) {
+        value = detail::load_unaligned<std::remove_reference_t<decltype(value)>>(in);
+        in += sizeof value;
+    };
+    uint32_t version, type, dims, flags, level, mantissa_bits, fixed_rate, chain_length, padding;
+    get(version);
+    if (version == 0 || version > frame_format_version) {
+        throw std::runtime_error{"frame header has unsupported format version " + std::to_string(version)};
+    }
+    get(type);
+    if (type != static_cast<uint32_t>(element_type::float32) && type != static_cast<uint32_t>(element_type::float64)) {
+        throw std::runtime_error{"frame header has an invalid element type"};
+    }
+    get(dims);
+    if (dims < 1 || dims > max_dimensionality) { throw std::runtime_error{"frame header has invalid dimensionality"}; }
+
+    frame_header header;
+    header.type = static_cast<element_type>(type);
+    header.data_size = extent(static_cast<dim_type>(dims));
+    std::array<index_type, max_dimensionality> components;
+    get(components);
+    std::copy(components.begin(), components.begin() + dims, header.data_size.begin());
+    get(flags);
+    if ((flags & ~frame::known_option_flags) != 0) {
+        throw std::runtime_error{"frame header has unsupported stream options"};
+    }
+    get(level);
+    get(mantissa_bits);
+    get(fixed_rate);
+    get(chain_length);
+    get(components);
+    get(padding);
+
+    auto &options = header.options;
+    options.adaptive_prediction = flags & frame::adaptive_prediction;
+    options.progressive = flags & frame::progressive;
+    options.hypercube_means = flags & frame::hypercube_means;
+    options.hypercube_bounds = flags & frame::hypercube_bounds;
+    options.deduplicate = flags & frame::deduplicate;
+    options.raw_fallback = flags & frame::raw_fallback;
+    options.compressed_border = flags & frame::compressed_border;
+    options.fold_dimensions = flags & frame::fold_dimensions;
+    options.hypercube_checksums = flags & frame::hypercube_checksums;
+    options.level = static_cast<int>(level);
+    options.mantissa_bits = static_cast<int>(mantissa_bits);
+    options.fixed_rate = static_cast<int>(fixed_rate);
+    options.prediction_chain_length = static_cast<int>(chain_length);
+    if (flags & frame::hypercube_shape) {
+        options.hypercube_shape = extent(static_cast<dim_type>(dims));
+        std::copy(components.begin(), components.begin() + dims, options.hypercube_shape->begin());
+    }
+    get(options.error_bound);
+    get(header.stream_length);
+    return header;
+}
+
+namespace container {
+
+constexpr uint32_t magic = 0x585a444e;  // "NDZX" in little endian
+constexpr uint32_t version = 1;
+constexpr size_t entry_size = 2 * sizeof(uint64_t);
+
+// Covers the index entries and the chunk count
+uint64_t checksum(const std::byte *index, uint64_t num_chunks) {
+    return detail::xxhash64(index, num_chunks * entry_size + sizeof num_chunks, magic);
+}
+
+}  // namespace container
+
+void write_container_index(const std::vector<container_chunk> &chunks, void *dest) {
+    const auto index = static_cast<std::byte *>(dest);
+    auto out = index;
+    const auto put = [&](auto value) {
+        detail::store_unaligned(out, value);
+        out += sizeof value;
+    };
+    for (auto &chunk : chunks) {
+        put(chunk.offset);
+        put(chunk.length);
+    }
+    const auto num_chunks = static_cast<uint64_t>(chunks.size());
+    put(num_chunks);
+    put(container::checksum(index, num_chunks));
+    put(container::magic);
+    put(container::version);
+}
+
+bool is_container_footer(const void *footer) {
+    return detail::load_unaligned<uint32_t>(static_cast<const std::byte *>(footer) + 2 * sizeof(uint64_t))
+            == container::magic;
+}
+
+std::vector<container_chunk> read_container_index(const void *container, size_t container_size) {
+    if (container_size < container_footer_size) { throw std::runtime_error{"container is truncated"}; }
+    const auto footer = static_cast<const std::byte *>(container) + container_size - container_footer_size;
+    if (!is_container_footer(footer)) { throw std::runtime_error{"container does not end in a chunk index"}; }
+    const auto version = detail::load_unaligned<uint32_t>(footer + 2 * sizeof(uint64_t) + sizeof(uint32_t));
+    if (version == 0 || version > container::version) {
+        throw std::runtime_error{"container has unsupported format version " + std::to_string(version)};
+    }
+
+    const auto num_chunks = detail::load_unaligned<uint64_t>(footer);
+    if (num_chunks > (container_size - container_footer_size) / container::entry_size) {
+        throw std::runtime_error{"container is truncated"};
+    }
+    const auto index_offset = container_size - container_index_size(num_chunks);
+    const auto index = static_cast<const std::byte *>(container) + index_offset;
+    if (detail::load_unaligned<uint64_t>(footer + sizeof(uint64_t)) != container::checksum(index, num_chunks)) {
+        throw std::runtime_error{"container index is corrupt"};
+    }
+
+    std::vector<container_chunk> chunks(num_chunks);
+    uint64_t end_of_previous = 0;
+    for (uint64_t i = 0; i < num_chunks; ++i) {
+        auto &chunk = chunks[i];
+        chunk.offset = detail::load_unaligned<uint64_t>(index + i * container::entry_size);
+        chunk.length = detail::load_unaligned<uint64_t>(index + i * container::entry_size + sizeof(uint64_t));
+        if (chunk.offset < end_of_previous || chunk.length < frame_header_size || chunk.offset > index_offset
+                || chunk.length > index_offset - chunk.offset) {
+            throw std::runtime_error{"container index has an invalid chunk"};
+        }
+        end_of_previous = chunk.offset + chunk.length;
+    }
+    return chunks;
+}
+
+namespace archive {
+
+constexpr uint32_t magic = 0x415a444e;  // "NDZA" in little endian
+constexpr uint32_t version = 1;
+
+// Every entry holds the length of the name, the name, the variable offset and a copy of its frame header
+size_t entry_size(const archive_variable &variable) {
+    return sizeof(uint32_t) + variable.name.size() + sizeof(uint64_t) + frame_header_size;
+}
+
+}  // namespace archive
+
+size_t archive_directory_size(const std::vector<archive_variable> &variables) {
+    size_t size = archive_footer_size;
+    for (auto &variable : variables) {
+        size += archive::entry_size(variable);
+    }
+    return size;
+}
+
+void write_archive_directory(const std::vector<archive_variable> &variables, uint64_t directory_offset, void *dest) {
+    for (size_t i = 0; i < variables.size(); ++i) {
+        if (variables[i].name.empty()) { throw std::invalid_argument{"archive variables must have a name"}; }
+        for (size_t j = 0; j < i; ++j) {
+            if (variables[j].name == variables[i].name) {
+                throw std::invalid_argument{"archive variable name " + variables[i].name + " is not unique"};
+            }
+        }
+    }
+
+    const auto directory = static_cast<std::byte *>(dest);
+    auto out = directory;
+    const auto put = [&](auto value) {
+        detail::store_unaligned(out, value);
+        out += sizeof value;
+    };
+    for (auto &variable : variables) {
+        put(static_cast<uint32_t>(variable.name.size()));
+        memcpy(out, variable.name.data(), variable.name.size());
+        out += variable.name.size();
+        put(variable.offset);
+        write_frame_header(variable.header, out);
+        out += frame_header_size;
+    }
+    const auto directory_length = static_cast<size_t>(out - directory);
+    put(directory_offset);
+    put(static_cast<uint64_t>(variables.size()));
+    put(detail::xxhash64(directory, directory_length, archive::magic));
+    put(archive::magic);
+    put(archive::version);
+}
+
+bool is_archive_footer(const void *footer) {
+    return detail::load_unaligned<uint32_t>(static_cast<const std::byte *>(footer) + 3 * sizeof(uint64_t))
+            == archive::magic;
+}
+
+std::vector<archive_variable> read_archive_directory(const void *archive, size_t archive_size) {
+    if (archive_size < archive_footer_size) { throw std::runtime_error{"archive is truncated"}; }
+    const auto bytes = static_cast<const std::byte *>(archive);
+    const auto footer = bytes + archive_size - archive_footer_size;
+    if (!is_archive_footer(footer)) { throw std::runtime_error{"archive does not end in a directory"}; }
+    const auto version = detail::load_unaligned<uint32_t>(footer + 3 * sizeof(uint64_t) + sizeof(uint32_t));
+    if (version == 0 || version > archive::version) {
+        throw std::runtime_error{"archive has unsupported format version " + std::to_string(version)};
+    }
+
+    const auto directory_offset = detail::load_unaligned<uint64_t>(footer);
+    const auto num_variables = detail::load_unaligned<uint64_t>(footer + sizeof(uint64_t));
+    if (directory_offset > archive_size - archive_footer_size) { throw std::runtime_error{"archive is truncated"}; }
+    const auto directory_length = archive_size - archive_footer_size - directory_offset;
+    if (detail::load_unaligned<uint64_t>(footer + 2 * sizeof(uint64_t))
+            != detail::xxhash64(bytes + directory_offset, directory_length, archive::magic)) {
+        throw std::runtime_error{"archive directory is corrupt"};
+    }
+
+    std::vector<archive_variable> variables;
+    auto in = bytes + directory_offset;
+    const auto end = footer;
+    for (uint64_t i = 0; i < num_variables; ++i) {
+        archive_variable variable;
+        if (end - in < static_cast<ptrdiff_t>(sizeof(uint32_t))) { throw std::runtime_error{"archive is truncated"}; }
+        const auto name_length = detail::load_unaligned<uint32_t>(in);
+        in += sizeof(uint32_t);
+        if (static_cast<size_t>(end - in) < name_length + sizeof(uint64_t) + frame_header_size) {
+            throw std::runtime_error{"archive is truncated"};
+        }
+        variable.name.assign(reinterpret_cast<const char *>(in), name_length);
+        in += name_length;
+        variable.offset = detail::load_unaligned<uint64_t>(in);
+        in += sizeof(uint64_t);
+        variable.header = read_frame_header(in, frame_header_size);
+        in += frame_header_size;
+
+        if (variable.offset % archive_alignment != 0 || variable.offset > directory_offset
+                || directory_offset - variable.offset < frame_header_size
+                || directory_offset - variable.offset - frame_header_size < variable.header.stream_length) {
+            throw std::runtime_error{"archive directory has an invalid entry for " + variable.name};
+        }
+        variables.push_back(std::move(variable));
+    }
+    if (in != end) { throw std::runtime_error{"archive directory is corrupt"}; }
+    return variables;
+}
 
 }  // namespace ndzip
@@ -3,13 +3,16 @@
 #include "cuda_workaround.hh"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <climits>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <limits>
 #include <optional>
 #include <stdexcept>
+#include <vector>
 
 #include <ndzip/ndzip.hh>
 
@@ -242,80 +245,220 @@ template<typename POD, typename Memory>
     }
 }
 
-template<dim_type Dims, typename Fn>
-void for_each_border_slice_recursive(const static_extent<Dims> &size, static_extent<Dims> pos, index_type side_length,
-        dim_type d, dim_type smallest_dim_with_border, const Fn &fn) {
-    auto border_begin = size[d] / side_length * side_length;
-    auto border_end = size[d];
+// xxHash64 by Yann Collet (https://github.com/Cyan4973/xxHash), used for content fingerprints. The state consumes its
+// input in stripes of 32 bytes, so that data which is not contiguous in memory, like the rows of a hypercube, can be
+// hashed in one pass: add_stripes() for every piece followed by finish() equals xxhash64() of their concatenation.
+class xxhash64_state {
+  public:
+    static constexpr size_t stripe_size = 32;
+
+    explicit xxhash64_state(uint64_t seed)
+        : _seed(seed), _v{seed + prime1 + prime2, seed + prime2, seed, seed - prime1} {}
 
-    if (d < smallest_dim_with_border) {
-        for (pos[d] = 0; pos[d] < border_begin; ++pos[d]) {
-            for_each_border_slice_recursive(size, pos, side_length, d + 1, smallest_dim_with_border, fn);
+    // size must be a multiple of stripe_size
+    void add_stripes(const void *data, size_t size) {
+        const auto p = static_cast<const std::byte *>(data);
+        for (size_t offset = 0; offset < size; offset += stripe_size) {
+            for (int i = 0; i < 4; ++i) {
+                _v[i] = round(_v[i], load_unaligned<uint64_t>(p + offset + 8 * i));
+            }
+        }
+        _size += size;
+    }
+
+    // Hashes the remaining tail of fewer than stripe_size bytes
+    uint64_t finish(const void *tail = nullptr, size_t tail_size = 0) const {
+        uint64_t h;
+        if (_size > 0) {
+            h = rotl(_v[0], 1) + rotl(_v[1], 7) + rotl(_v[2], 12) + rotl(_v[3], 18);
+            for (auto vi : _v) {
+                h = (h ^ round(0, vi)) * prime1 + prime4;
+            }
+        } else {
+            h = _seed + prime5;
+        }
+        h += _size + tail_size;
+
+        auto p = static_cast<const std::byte *>(tail);
+        const auto end = p + tail_size;
+        for (; p + 8 <= end; p += 8) {
+            h = rotl(h ^ round(0, load_unaligned<uint64_t>(p)), 27) * prime1 + prime4;
+        }
+        if (p + 4 <= end) {
+            h = rotl(h ^ (load_unaligned<uint32_t>(p) * prime1), 23) * prime2 + prime3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h = rotl(h ^ (static_cast<uint64_t>(*p) * prime5), 11) * prime1;
+        }
+
+        h ^= h >> 33;
+        h *= prime2;
+        h ^= h >> 29;
+        h *= prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+  private:
+    static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+    static constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+    static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+    static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+    uint64_t _seed;
+    uint64_t _v[4];
+    uint64_t _size = 0;
+
+    static uint64_t rotl(uint64_t x, unsigned r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t round(uint64_t acc, uint64_t input) { return rotl(acc + input * prime2, 31) * prime1; }
+};
+
+inline uint64_t xxhash64(const void *data, size_t size, uint64_t seed) {
+    const auto stripes_size = size / xxhash64_state::stripe_size * xxhash64_state::stripe_size;
+    xxhash64_state state{seed};
+    state.add_stripes(data, stripes_size);
+    return state.finish(static_cast<const std::byte *>(data) + stripes_size, size - stripes_size);
+}
+
+// The fingerprint of a reference array is the XOR of the hashes of all its hypercubes and border slices. This way it
+// can be computed in any order while the reference is being loaded. Border slices are seeded with their element
+// offset, shifted past the range of hypercube indices.
+template<typename Bits>
+uint64_t hypercube_fingerprint(const Bits *cube, index_type hc_size, index_type hc_index) {
+    return xxhash64(cube, hc_size * sizeof(Bits), hc_index);
+}
+
+template<typename DataType>
+uint64_t border_fingerprint(const DataType *slice, index_type count, index_type offset) {
+    return xxhash64(slice, count * sizeof(DataType), (uint64_t{1} << 32u) | offset);
+}
+
+// The dimension is a template parameter so that the recursion provably ends at Dims
+template<dim_type D, dim_type Dims, typename Fn>
+void for_each_border_slice_recursive(const static_extent<Dims> &size, static_extent<Dims> pos,
+        const static_extent<Dims> &hc_shape, dim_type smallest_dim_with_border, const Fn &fn) {
+    auto border_begin = size[D] / hc_shape[D] * hc_shape[D];
+    auto border_end = size[D];
+
+    if constexpr (D + 1 < Dims) {
+        if (D < smallest_dim_with_border) {
+            for (pos[D] = 0; pos[D] < border_begin; ++pos[D]) {
+                for_each_border_slice_recursive<D + 1>(size, pos, hc_shape, smallest_dim_with_border, fn);
+            }
         }
     }
 
     if (border_begin < border_end) {
         auto begin_pos = pos;
-        begin_pos[d] = border_begin;
+        begin_pos[D] = border_begin;
         auto end_pos = pos;
-        end_pos[d] = border_end;
+        end_pos[D] = border_end;
         auto offset = linear_index(size, begin_pos);
         auto count = linear_index(size, end_pos) - offset;
         fn(offset, count);
     }
 }
 
+// Visits the elements not covered by hypercubes of shape hc_shape as contiguous slices
 template<dim_type Dims, typename Fn>
-void for_each_border_slice(const static_extent<Dims> &size, index_type side_length, const Fn &fn) {
+void for_each_border_slice(const static_extent<Dims> &size, const static_extent<Dims> &hc_shape, const Fn &fn) {
     std::optional<dim_type> smallest_dim_with_border;
     for (dim_type d = 0; d < Dims; ++d) {
-        if (size[d] / side_length == 0) {
+        if (size[d] / hc_shape[d] == 0) {
             // special case: the whole array is a border
             fn(0, num_elements(size));
             return;
         }
-        if (size[d] % side_length != 0) { smallest_dim_with_border = static_cast<int>(d); }
+        if (size[d] % hc_shape[d] != 0) { smallest_dim_with_border = static_cast<int>(d); }
     }
     if (smallest_dim_with_border) {
-        for_each_border_slice_recursive(size, static_extent<Dims>{}, side_length, 0, *smallest_dim_with_border, fn);
+        for_each_border_slice_recursive<0>(size, static_extent<Dims>{}, hc_shape, *smallest_dim_with_border, fn);
     }
 }
 
-template<typename DataType, dim_type Dims>
+template<dim_type Dims, typename Fn>
+void for_each_border_slice(const static_extent<Dims> &size, index_type side_length, const Fn &fn) {
+    for_each_border_slice(size, static_extent<Dims>::broadcast(side_length), fn);
+}
+
+// HcShape is either the side length of cubic hypercubes or the static_extent of their shape
+template<typename DataType, dim_type Dims, typename HcShape>
 [[gnu::noinline]] index_type pack_border(
-        compressed_type<DataType> *dest, DataType *src, const static_extent<Dims> &src_size, index_type side_length) {
+        compressed_type<DataType> *dest, DataType *src, const static_extent<Dims> &src_size, const HcShape &hc_shape) {
     static_assert(std::is_trivially_copyable_v<DataType>);
     index_type dest_offset = 0;
-    for_each_border_slice(src_size, side_length, [&](index_type src_offset, index_type count) {
+    for_each_border_slice(src_size, hc_shape, [&](index_type src_offset, index_type count) {
         memcpy(dest + dest_offset, src + src_offset, count * sizeof(DataType));
         dest_offset += count;
     });
     return dest_offset;
 }
 
-template<typename DataType, dim_type Dims>
+template<typename DataType, dim_type Dims, typename HcShape>
 [[gnu::noinline]] index_type unpack_border(DataType *dest, const static_extent<Dims> &dest_size,
-        const compressed_type<DataType> *src, index_type side_length) {
+        const compressed_type<DataType> *src, const HcShape &hc_shape) {
     static_assert(std::is_trivially_copyable_v<DataType>);
     index_type src_offset = 0;
-    for_each_border_slice(dest_size, side_length, [&](index_type dest_offset, index_type count) {
+    for_each_border_slice(dest_size, hc_shape, [&](index_type dest_offset, index_type count) {
         memcpy(dest + dest_offset, src + src_offset, count * sizeof(DataType));
         src_offset += count;
     });
     return src_offset;
 }
 
+// Variant of pack_border for streams compressed against a reference: Stores the integer residual of every border
+// element and folds the reference border into `fingerprint`.
+template<typename DataType, dim_type Dims>
+[[gnu::noinline]] index_type pack_border_residual(bits_type<DataType> *dest, const DataType *src,
+        const DataType *reference, const static_extent<Dims> &src_size, index_type side_length, uint64_t &fingerprint) {
+    using bits = bits_type<DataType>;
+    index_type dest_offset = 0;
+    for_each_border_slice(src_size, side_length, [&](index_type src_offset, index_type count) {
+        for (index_type i = 0; i < count; ++i) {
+            dest[dest_offset + i] = load_unaligned<bits>(src + src_offset + i)
+                    - load_unaligned<bits>(reference + src_offset + i);
+        }
+        fingerprint ^= border_fingerprint(reference + src_offset, count, src_offset);
+        dest_offset += count;
+    });
+    return dest_offset;
+}
+
+template<typename DataType, dim_type Dims>
+[[gnu::noinline]] index_type unpack_border_residual(DataType *dest, const DataType *reference,
+        const static_extent<Dims> &dest_size, const bits_type<DataType> *src, index_type side_length,
+        uint64_t &fingerprint) {
+    using bits = bits_type<DataType>;
+    index_type src_offset = 0;
+    for_each_border_slice(dest_size, side_length, [&](index_type dest_offset, index_type count) {
+        for (index_type i = 0; i < count; ++i) {
+            const bits value = src[src_offset + i] + load_unaligned<bits>(reference + dest_offset + i);
+            store_unaligned(dest + dest_offset + i, value);
+        }
+        fingerprint ^= border_fingerprint(reference + dest_offset, count, dest_offset);
+        src_offset += count;
+    });
+    return src_offset;
+}
+
 template<dim_type Dims>
-index_type border_element_count(const static_extent<Dims> &e, dim_type side_length) {
+index_type border_element_count(const static_extent<Dims> &e, const static_extent<Dims> &hc_shape) {
     index_type n_cube_elems = 1;
     index_type n_all_elems = 1;
     for (dim_type d = 0; d < Dims; ++d) {
-        n_cube_elems *= e[d] / side_length * side_length;
+        n_cube_elems *= e[d] / hc_shape[d] * hc_shape[d];
         n_all_elems *= e[d];
     }
     return n_all_elems - n_cube_elems;
 }
 
+template<dim_type Dims>
+index_type border_element_count(const static_extent<Dims> &e, dim_type side_length) {
+    return border_element_count(e, static_extent<Dims>::broadcast(side_length));
+}
+
 inline dim_type get_dimensionality(const compressor_requirements &req) {
     if (req._dims == -1) { throw std::runtime_error{"Cannot construct a compressor with empty requirements"}; }
     return req._dims;
@@ -325,6 +468,475 @@ inline index_type get_num_hypercubes(const compressor_requirements &req) {
     return req._max_num_hypercubes;
 }
 
+// Streams making use of optional features are prefixed with a preamble that records them. It is padded to a whole
+// number of stream words. Streams without optional features have no preamble and are identical between all backends.
+struct preamble {
+    constexpr static uint32_t magic = 0x505a444e;  // "NDZP" in little endian
+
+    enum flag : uint32_t {
+        reference_residual = 1u << 0,
+        adaptive_prediction = 1u << 1,
+        entropy_coded = 1u << 2,
+        error_bounded = 1u << 3,
+        truncated_mantissa = 1u << 4,
+        fixed_rate = 1u << 5,
+        progressive = 1u << 6,
+        hypercube_means = 1u << 7,
+        hypercube_bounds = 1u << 8,
+        deduplicated = 1u << 9,
+        cross_prediction = 1u << 10,
+        joint_fields = 1u << 11,
+        shaped_hypercubes = 1u << 12,
+        raw_fallback = 1u << 13,
+        padded_border = 1u << 14,
+        folded = 1u << 15,
+        hypercube_checksums = 1u << 16,
+    };
+    constexpr static uint32_t known_flags = reference_residual | adaptive_prediction | entropy_coded | error_bounded
+            | truncated_mantissa | fixed_rate | progressive | hypercube_means | hypercube_bounds | deduplicated
+            | cross_prediction | joint_fields | shaped_hypercubes | raw_fallback | padded_border | folded
+            | hypercube_checksums;
+
+    uint32_t flags = 0;
+    uint64_t reference_fingerprint = 0;
+    double error_bound = 0;
+    uint32_t mantissa_bits = 0;
+    uint32_t rate = 0;
+    uint32_t chain_length = 0;
+    uint32_t num_fields = 0;
+    std::array<uint32_t, max_dimensionality> hypercube_shape{};  // zero beyond the dimensionality of the stream
+    std::array<uint32_t, max_dimensionality> folded_extent{};    // zero beyond the folded dimensionality
+};
+
+inline size_t preamble_size_bytes(const preamble &p) {
+    if (p.flags == 0) { return 0; }
+    size_t size = 2 * sizeof(uint32_t);
+    if (p.flags & preamble::reference_residual) { size += sizeof(uint64_t); }
+    if (p.flags & preamble::error_bounded) { size += sizeof(double); }
+    if (p.flags & preamble::truncated_mantissa) { size += sizeof(uint32_t); }
+    if (p.flags & preamble::fixed_rate) { size += sizeof(uint32_t); }
+    if (p.flags & preamble::cross_prediction) { size += sizeof(uint32_t); }
+    if (p.flags & preamble::joint_fields) { size += sizeof(uint32_t); }
+    if (p.flags & preamble::shaped_hypercubes) { size += sizeof p.hypercube_shape; }
+    if (p.flags & preamble::folded) { size += sizeof p.folded_extent; }
+    return size;
+}
+
+template<typename Bits>
+index_type preamble_length(const preamble &p) {
+    return static_cast<index_type>(div_ceil(preamble_size_bytes(p), sizeof(Bits)));
+}
+
+// Upper bound for preamble_length() over all combinations of flags
+template<typename Bits>
+index_type max_preamble_length() {
+    return preamble_length<Bits>(preamble{preamble::known_flags});
+}
+
+template<typename Bits>
+index_type write_preamble(const preamble &p, Bits *stream) {
+    const auto length = preamble_length<Bits>(p);
+    if (length == 0) { return 0; }
+
+    auto out = reinterpret_cast<std::byte *>(stream);
+    memset(out, 0, length * sizeof(Bits));
+    const auto put = [&](auto value) {
+        store_unaligned(out, value);
+        out += sizeof value;
+    };
+    put(preamble::magic);
+    put(p.flags);
+    if (p.flags & preamble::reference_residual) { put(p.reference_fingerprint); }
+    if (p.flags & preamble::error_bounded) { put(p.error_bound); }
+    if (p.flags & preamble::truncated_mantissa) { put(p.mantissa_bits); }
+    if (p.flags & preamble::fixed_rate) { put(p.rate); }
+    if (p.flags & preamble::cross_prediction) { put(p.chain_length); }
+    if (p.flags & preamble::joint_fields) { put(p.num_fields); }
+    if (p.flags & preamble::shaped_hypercubes) { put(p.hypercube_shape); }
+    if (p.flags & preamble::folded) { put(p.folded_extent); }
+    return length;
+}
+
+template<typename Bits>
+preamble read_preamble(const Bits *stream) {
+    auto in = reinterpret_cast<const std::byte *>(stream);
+    const auto get = [&](auto &value) {
+        value = load_unaligned<std::remove_reference_t<decltype(value)>>(in);
+        in += sizeof value;
+    };
+
+    uint32_t magic;
+    get(magic);
+    if (magic != preamble::magic) { throw std::runtime_error{"stream does not begin with a preamble"}; }
+
+    preamble p;
+    get(p.flags);
+    if (p.flags == 0 || (p.flags & ~preamble::known_flags) != 0) {
+        throw std::runtime_error{"stream preamble has invalid flags"};
+    }
+    if (p.flags & preamble::reference_residual) { get(p.reference_fingerprint); }
+    if (p.flags & preamble::error_bounded) {
+        get(p.error_bound);
+        if (!(p.error_bound > 0 && std::isfinite(p.error_bound))) {
+            throw std::runtime_error{"stream preamble has an invalid error bound"};
+        }
+    }
+    if (p.flags & preamble::truncated_mantissa) {
+        get(p.mantissa_bits);
+        if (p.mantissa_bits == 0 || p.mantissa_bits >= bits_of<Bits>) {
+            throw std::runtime_error{"stream preamble has invalid mantissa bits"};
+        }
+    }
+    if (p.flags & preamble::fixed_rate) {
+        get(p.rate);
+        if (p.rate < 2 || p.rate > bits_of<Bits> + 1) {
+            throw std::runtime_error{"stream preamble has an invalid rate"};
+        }
+    }
+    if (p.flags & preamble::cross_prediction) {
+        get(p.chain_length);
+        if (p.chain_length < 2) { throw std::runtime_error{"stream preamble has an invalid prediction chain length"}; }
+    }
+    if (p.flags & preamble::joint_fields) {
+        get(p.num_fields);
+        if (p.num_fields == 0) { throw std::runtime_error{"stream preamble has an invalid number of fields"}; }
+    }
+    if (p.flags & preamble::shaped_hypercubes) {
+        get(p.hypercube_shape);
+        if (p.hypercube_shape[0] == 0) { throw std::runtime_error{"stream preamble has an invalid hypercube shape"}; }
+    }
+    if (p.flags & preamble::folded) {
+        get(p.folded_extent);
+        if (p.flags != preamble::folded || p.folded_extent[0] == 0) {
+            throw std::runtime_error{"stream preamble has an invalid folded extent"};
+        }
+    }
+    return p;
+}
+
+// Hypercubes in entropy-coded streams begin with the length of their zero-bit encoding in bytes and the number of
+// Huffman contexts, 0 meaning that the encoding is stored uncoded
+constexpr inline size_t entropy_frame_header_size = 2 * sizeof(uint32_t);
+
+inline uint32_t preamble_flags(const stream_options &options, bool has_reference) {
+    if (has_reference && (options.error_bound > 0 || options.mantissa_bits > 0 || options.fixed_rate > 0)) {
+        throw std::invalid_argument{"lossy streams cannot be compressed against a reference"};
+    }
+    if (has_reference && options.progressive) {
+        throw std::invalid_argument{"progressive streams cannot be compressed against a reference"};
+    }
+    if (has_reference && options.deduplicate) {
+        throw std::invalid_argument{"deduplicated streams cannot be compressed against a reference"};
+    }
+    if (has_reference && options.prediction_chain_length > 0) {
+        throw std::invalid_argument{"cross-predicted streams cannot be compressed against a reference"};
+    }
+    if (has_reference && options.hypercube_shape) {
+        throw std::invalid_argument{"streams with custom hypercube shapes cannot be compressed against a reference"};
+    }
+    if (has_reference && options.raw_fallback) {
+        throw std::invalid_argument{"streams with raw fallback cannot be compressed against a reference"};
+    }
+    if (has_reference && options.compressed_border) {
+        throw std::invalid_argument{"streams with a compressed border cannot be compressed against a reference"};
+    }
+    uint32_t flags = 0;
+    if (has_reference) { flags |= preamble::reference_residual; }
+    if (options.adaptive_prediction) { flags |= preamble::adaptive_prediction; }
+    if (options.level > 0) { flags |= preamble::entropy_coded; }
+    if (options.error_bound > 0) { flags |= preamble::error_bounded; }
+    if (options.mantissa_bits > 0) { flags |= preamble::truncated_mantissa; }
+    if (options.fixed_rate > 0) { flags |= preamble::fixed_rate; }
+    if (options.progressive) { flags |= preamble::progressive; }
+    if (options.hypercube_means) { flags |= preamble::hypercube_means; }
+    if (options.hypercube_bounds) { flags |= preamble::hypercube_bounds; }
+    if (options.deduplicate) { flags |= preamble::deduplicated; }
+    if (options.prediction_chain_length > 0) { flags |= preamble::cross_prediction; }
+    if (options.hypercube_shape) { flags |= preamble::shaped_hypercubes; }
+    if (options.raw_fallback) { flags |= preamble::raw_fallback; }
+    if (options.compressed_border) { flags |= preamble::padded_border; }
+    if (options.hypercube_checksums) { flags |= preamble::hypercube_checksums; }
+    return flags;
+}
+
+// Preamble of a new stream, the reference fingerprint is filled in after compression
+inline preamble make_preamble(const stream_options &options, bool has_reference) {
+    preamble p;
+    p.flags = preamble_flags(options, has_reference);
+    if (p.flags & preamble::error_bounded) { p.error_bound = options.error_bound; }
+    if (p.flags & preamble::truncated_mantissa) { p.mantissa_bits = static_cast<uint32_t>(options.mantissa_bits); }
+    if (p.flags & preamble::fixed_rate) { p.rate = static_cast<uint32_t>(options.fixed_rate); }
+    if (p.flags & preamble::cross_prediction) {
+        p.chain_length = static_cast<uint32_t>(options.prediction_chain_length);
+    }
+    if (p.flags & preamble::shaped_hypercubes) {
+        std::copy(options.hypercube_shape->begin(), options.hypercube_shape->end(), p.hypercube_shape.begin());
+    }
+    return p;
+}
+
+inline extent stream_hypercube_shape(const preamble &p, dim_type dims) {
+    extent shape(dims);
+    std::copy(p.hypercube_shape.begin(), p.hypercube_shape.begin() + dims, shape.begin());
+    return shape;
+}
+
+// Preamble of a stream holding several arrays compressed together, which supports no options other than the level
+inline preamble make_joint_preamble(const stream_options &options, index_type num_fields) {
+    if (num_fields == 0) { throw std::invalid_argument{"joint compression requires at least one field"}; }
+    if (options.adaptive_prediction || options.error_bound > 0 || options.mantissa_bits > 0 || options.fixed_rate > 0
+            || options.progressive || options.hypercube_means || options.hypercube_bounds || options.deduplicate
+            || options.prediction_chain_length > 0 || options.hypercube_shape || options.raw_fallback
+            || options.compressed_border || options.hypercube_checksums) {
+        throw std::invalid_argument{"joint compression of multiple fields only supports compression levels"};
+    }
+    preamble p;
+    p.flags = preamble::joint_fields;
+    if (options.level > 0) { p.flags |= preamble::entropy_coded; }
+    p.num_fields = num_fields;
+    return p;
+}
+
+// A folded stream consists of only this preamble, followed by the stream of the array reinterpreted with the folded
+// extent
+inline preamble make_folded_preamble(const extent &folded_size) {
+    preamble p;
+    p.flags = preamble::folded;
+    std::copy(folded_size.begin(), folded_size.end(), p.folded_extent.begin());
+    return p;
+}
+
+inline extent stream_folded_extent(const preamble &p) {
+    dim_type dims = 0;
+    while (dims < max_dimensionality && p.folded_extent[dims] != 0) {
+        ++dims;
+    }
+    extent size(dims);
+    std::copy(p.folded_extent.begin(), p.folded_extent.begin() + dims, size.begin());
+    return size;
+}
+
+// With adaptive prediction, the preamble is followed by one predictor selector byte per hypercube
+template<typename Bits>
+index_type predictor_table_length(const preamble &p, index_type num_hypercubes) {
+    return p.flags & preamble::adaptive_prediction ? div_ceil(num_hypercubes, bytes_of<Bits>) : 0;
+}
+
+template<typename Bits>
+auto predictor_table(const preamble &p, Bits *raw_stream) {
+    using byte_type = std::conditional_t<std::is_const_v<Bits>, const uint8_t, uint8_t>;
+    return p.flags & preamble::adaptive_prediction
+            ? reinterpret_cast<byte_type *>(raw_stream + preamble_length<std::remove_const_t<Bits>>(p))
+            : nullptr;
+}
+
+// Error-bounded streams continue with one byte per hypercube that is set if the hypercube holds its values verbatim
+// because they could not all be quantized within the bound
+template<typename Bits>
+index_type verbatim_table_length(const preamble &p, index_type num_hypercubes) {
+    return p.flags & preamble::error_bounded ? div_ceil(num_hypercubes, bytes_of<Bits>) : 0;
+}
+
+template<typename Bits>
+auto verbatim_table(const preamble &p, Bits *raw_stream, index_type num_hypercubes) {
+    using byte_type = std::conditional_t<std::is_const_v<Bits>, const uint8_t, uint8_t>;
+    using bits = std::remove_const_t<Bits>;
+    if (!(p.flags & preamble::error_bounded)) { return static_cast<byte_type *>(nullptr); }
+    const auto offset = preamble_length<bits>(p) + predictor_table_length<bits>(p, num_hypercubes);
+    return reinterpret_cast<byte_type *>(raw_stream + offset);
+}
+
+// With hypercube means, the tables are followed by the mean of every hypercube as a value of the stream's data type
+template<typename Bits>
+index_type means_table_length(const preamble &p, index_type num_hypercubes) {
+    return p.flags & preamble::hypercube_means ? num_hypercubes : 0;
+}
+
+template<typename Bits>
+Bits *means_table(const preamble &p, Bits *raw_stream, index_type num_hypercubes) {
+    using bits = std::remove_const_t<Bits>;
+    if (!(p.flags & preamble::hypercube_means)) { return nullptr; }
+    return raw_stream + preamble_length<bits>(p) + predictor_table_length<bits>(p, num_hypercubes)
+            + verbatim_table_length<bits>(p, num_hypercubes);
+}
+
+// With hypercube bounds, the next table holds the minimum and maximum of every hypercube as two values
+template<typename Bits>
+index_type bounds_table_length(const preamble &p, index_type num_hypercubes) {
+    return p.flags & preamble::hypercube_bounds ? 2 * num_hypercubes : 0;
+}
+
+template<typename Bits>
+Bits *bounds_table(const preamble &p, Bits *raw_stream, index_type num_hypercubes) {
+    using bits = std::remove_const_t<Bits>;
+    if (!(p.flags & preamble::hypercube_bounds)) { return nullptr; }
+    return raw_stream + preamble_length<bits>(p) + predictor_table_length<bits>(p, num_hypercubes)
+            + verbatim_table_length<bits>(p, num_hypercubes) + means_table_length<bits>(p, num_hypercubes);
+}
+
+// Joint multi-field streams end the tables with one byte per hypercube of every field that is set if the hypercube is
+// encoded as its difference to the co-located hypercube of the first field
+template<typename Bits>
+index_type field_prediction_table_length(const preamble &p, index_type num_hypercubes) {
+    return p.flags & preamble::joint_fields ? div_ceil(num_hypercubes, bytes_of<Bits>) : 0;
+}
+
+template<typename Bits>
+auto field_prediction_table(const preamble &p, Bits *raw_stream, index_type num_hypercubes) {
+    using byte_type = std::conditional_t<std::is_const_v<Bits>, const uint8_t, uint8_t>;
+    using bits = std::remove_const_t<Bits>;
+    if (!(p.flags & preamble::joint_fields)) { return static_cast<byte_type *>(nullptr); }
+    const auto offset = preamble_length<bits>(p) + predictor_table_length<bits>(p, num_hypercubes)
+            + verbatim_table_length<bits>(p, num_hypercubes) + means_table_length<bits>(p, num_hypercubes)
+            + bounds_table_length<bits>(p, num_hypercubes);
+    return reinterpret_cast<byte_type *>(raw_stream + offset);
+}
+
+// Streams with hypercube checksums end the tables with the CRC-32C of the encoding of every hypercube, followed by
+// that of the border
+template<typename Bits>
+index_type checksum_table_length(const preamble &p, index_type num_hypercubes) {
+    return p.flags & preamble::hypercube_checksums
+            ? div_ceil((num_hypercubes + 1) * index_type{sizeof(uint32_t)}, index_type{sizeof(Bits)})
+            : 0;
+}
+
+template<typename Bits>
+auto checksum_table(const preamble &p, Bits *raw_stream, index_type num_hypercubes) {
+    using checksum_type = std::conditional_t<std::is_const_v<Bits>, const uint32_t, uint32_t>;
+    using bits = std::remove_const_t<Bits>;
+    if (!(p.flags & preamble::hypercube_checksums)) { return static_cast<checksum_type *>(nullptr); }
+    const auto offset = preamble_length<bits>(p) + predictor_table_length<bits>(p, num_hypercubes)
+            + verbatim_table_length<bits>(p, num_hypercubes) + means_table_length<bits>(p, num_hypercubes)
+            + bounds_table_length<bits>(p, num_hypercubes) + field_prediction_table_length<bits>(p, num_hypercubes);
+    return reinterpret_cast<checksum_type *>(raw_stream + offset);
+}
+
+// Fixed-rate streams have no offset header. Instead, every hypercube occupies a slot of `rate` words per zero-bit
+// chunk directly after the stream prefix, so hypercube i begins at word i * fixed_rate_slot_length().
+template<typename Profile>
+index_type fixed_rate_slot_length(const preamble &p) {
+    return p.rate * ipow(Profile::hypercube_side_length, Profile::dimensions) / bits_of<typename Profile::bits_type>;
+}
+
+// Progressive streams order the zero-bit encoding by significance instead of by hypercube. The preamble is followed by
+// a table holding the end position of each bit plane section, the border, the chunk heads of all hypercubes and one
+// section per bit plane, most significant first, with the non-zero plane words of all chunks in hypercube order.
+struct progressive_layout {
+    index_type plane_table;
+    index_type border;
+    index_type heads;
+    index_type planes;
+};
+
+template<typename Profile>
+progressive_layout progressive_stream_layout(const preamble &p, const static_extent<Profile::dimensions> &size) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto chunks_per_hc
+            = static_cast<index_type>(ipow(Profile::hypercube_side_length, Profile::dimensions) / bits_of<bits_type>);
+
+    progressive_layout layout;
+    layout.plane_table = preamble_length<bits_type>(p);
+    layout.border = layout.plane_table + bits_of<bits_type>;
+    layout.heads = layout.border + border_element_count(size, Profile::hypercube_side_length);
+    layout.planes = layout.heads + num_hypercubes(size) * chunks_per_hc;
+    return layout;
+}
+
+template<typename Bits>
+void validate_plane_table(const Bits *raw_stream, const progressive_layout &layout) {
+    auto plane_end = static_cast<Bits>(layout.planes);
+    for (index_type plane = 0; plane < bits_of<Bits>; ++plane) {
+        if (raw_stream[layout.plane_table + plane] < plane_end) {
+            throw std::runtime_error{"stream contains an invalid bit plane table"};
+        }
+        plane_end = raw_stream[layout.plane_table + plane];
+    }
+}
+
+// Number of words preceding the hypercube offset header
+template<typename Bits>
+index_type stream_prefix_length(const preamble &p, index_type num_hypercubes) {
+    return preamble_length<Bits>(p) + predictor_table_length<Bits>(p, num_hypercubes)
+            + verbatim_table_length<Bits>(p, num_hypercubes) + means_table_length<Bits>(p, num_hypercubes)
+            + bounds_table_length<Bits>(p, num_hypercubes) + field_prediction_table_length<Bits>(p, num_hypercubes)
+            + checksum_table_length<Bits>(p, num_hypercubes);
+}
+
+// Maps values to integer bins of width 2 * error_bound. Bin indices are stored as two's complement bits, so that the
+// block transform sees small differences between neighboring bins.
+template<typename T>
+class quantizer {
+  public:
+    using bits_type = detail::bits_type<T>;
+
+    explicit quantizer(double error_bound)
+        : _error_bound{error_bound}, _bin_width{2 * error_bound}, _inverse_bin_width{1 / (2 * error_bound)} {}
+
+    // Returns false if value cannot be reconstructed within the error bound, e.g. because it is not finite
+    bool quantize(T value, bits_type &bits) const {
+        // Bins are kept well inside the signed range so that the rotation in the block transform cannot overflow
+        constexpr auto max_bin = static_cast<double>(bits_type{1} << (bits_of<bits_type> - 3));
+        const auto scaled = static_cast<double>(value) * _inverse_bin_width;
+        const bool in_range = std::abs(scaled) < max_bin;
+        const auto bin = static_cast<signed_type>(std::rint(in_range ? scaled : 0.0));
+        bits = static_cast<bits_type>(bin);
+        const auto error = std::abs(static_cast<double>(dequantize(bits)) - static_cast<double>(value));
+        return in_range & (error <= _error_bound);
+    }
+
+    T dequantize(bits_type bits) const {
+        return static_cast<T>(static_cast<double>(static_cast<signed_type>(bits)) * _bin_width);
+    }
+
+  private:
+    using signed_type = std::make_signed_t<bits_type>;
+
+    double _error_bound;
+    double _bin_width;
+    double _inverse_bin_width;
+};
+
+template<typename T>
+std::optional<quantizer<T>> stream_quantizer(const preamble &p) {
+    if (!(p.flags & preamble::error_bounded)) { return std::nullopt; }
+    return quantizer<T>{p.error_bound};
+}
+
+template<typename T>
+constexpr inline unsigned mantissa_bits = std::numeric_limits<T>::digits - 1;
+
+template<typename T>
+constexpr inline bits_type<T> exponent_mask
+        = static_cast<bits_type<T>>(~bits_type<T>{0} >> 1 & ~((bits_type<T>{1} << mantissa_bits<T>) - 1));
+
+// Number of low mantissa bits that are rounded away when loading hypercubes of a stream with truncated mantissas.
+// The remaining bits are shifted down by this amount so that the dropped bits do not enter the residuals.
+template<typename T>
+unsigned dropped_mantissa_bits(const preamble &p) {
+    if (!(p.flags & preamble::truncated_mantissa)) { return 0; }
+    if (p.mantissa_bits > mantissa_bits<T>) { throw std::runtime_error{"stream preamble has invalid mantissa bits"}; }
+    return mantissa_bits<T> - p.mantissa_bits;
+}
+
+// Rounds away the low 0 < `drop` < mantissa_bits<T> mantissa bits of an IEEE value, to nearest with ties to even.
+// Values that would round up to infinity are truncated instead, and NaNs remain (quiet) NaNs.
+template<typename T>
+bits_type<T> round_mantissa(bits_type<T> bits, unsigned drop) {
+    using bits_t = bits_type<T>;
+    constexpr auto quiet_bit = bits_t{1} << (mantissa_bits<T> - 1);
+    constexpr auto mantissa_mask = (bits_t{1} << mantissa_bits<T>) - 1;
+    const auto keep_mask = static_cast<bits_t>(~bits_t{0} << drop);
+    const auto bias = static_cast<bits_t>((bits_t{1} << (drop - 1)) - 1 + ((bits >> drop) & 1u));
+    const auto rounded = static_cast<bits_t>((bits + bias) & keep_mask);
+    const auto truncated = static_cast<bits_t>(bits & keep_mask);
+    if ((bits & exponent_mask<T>) == exponent_mask<T>) {
+        return (bits & mantissa_mask) != 0 ? truncated | quiet_bit : truncated;
+    }
+    if ((rounded & exponent_mask<T>) == exponent_mask<T>) { return truncated; }
+    return rounded;
+}
+
 template<typename Profile>
 struct stream {
     using bits_type = std::conditional_t<std::is_const_v<Profile>, const typename Profile::bits_type,
@@ -334,12 +946,35 @@ struct stream {
 
     static_assert(sizeof(bits_type) >= sizeof(offset_type) && alignof(bits_type) >= alignof(offset_type));
 
+    // Set in the header entry of a hypercube in a deduplicated stream that is encoded as the index of an identical
+    // earlier hypercube
+    constexpr static index_type back_reference_bit = index_type{1} << (bits_of<index_type> - 1);
+
+    // Set in the header entry of a hypercube in a stream with raw fallback that is stored as its uncompressed values
+    constexpr static index_type raw_bit = index_type{1} << (bits_of<index_type> - 2);
+
     index_type num_hypercubes;
     bits_type *buffer;
+    index_type marker_bits = 0;  // header bits that are not part of the offset, see header_marker_bits
 
     NDZIP_UNIVERSAL offset_type *header() { return reinterpret_cast<offset_type *>(buffer); }
 
-    NDZIP_UNIVERSAL index_type offset_after(index_type hc_index) { return header()[hc_index]; }
+    NDZIP_UNIVERSAL index_type offset_after(index_type hc_index) { return header()[hc_index] & ~marker_bits; }
+
+    NDZIP_UNIVERSAL bool is_back_reference(index_type hc_index) {
+        return (header()[hc_index] & marker_bits & back_reference_bit) != 0;
+    }
+
+    NDZIP_UNIVERSAL void set_back_reference(index_type hc_index) { header()[hc_index] |= back_reference_bit; }
+
+    NDZIP_UNIVERSAL bool is_raw(index_type hc_index) { return (header()[hc_index] & marker_bits & raw_bit) != 0; }
+
+    NDZIP_UNIVERSAL void set_raw(index_type hc_index) { header()[hc_index] |= raw_bit; }
+
+    // Largest offset that does not collide with the marker bits
+    NDZIP_UNIVERSAL index_type max_offset() const {
+        return marker_bits == 0 ? ~index_type{0} : (marker_bits & (~marker_bits + 1)) - 1;
+    }
 
     NDZIP_UNIVERSAL void set_offset_after(index_type hc_index, index_type position) {
         // TODO memcpy this, else potential aliasing UB!
@@ -365,6 +1000,17 @@ struct stream {
     NDZIP_UNIVERSAL bits_type *border() { return hypercube(num_hypercubes); }
 };
 
+// Deduplication takes the highest bit of every offset header entry, limiting such streams to 2^31 words, and raw
+// fallback the second-highest, limiting them to 2^30 words. Other streams can address the full index range.
+inline index_type header_marker_bits(const preamble &p) {
+    constexpr auto back_reference_bit = index_type{1} << (bits_of<index_type> - 1);
+    constexpr auto raw_bit = index_type{1} << (bits_of<index_type> - 2);
+    index_type bits = 0;
+    if (p.flags & preamble::deduplicated) { bits |= back_reference_bit; }
+    if (p.flags & preamble::raw_fallback) { bits |= raw_bit; }
+    return bits;
+}
+
 template<dim_type Dims>
 struct hypercube_side_length_s;
 
@@ -390,6 +1036,9 @@ class profile {
     constexpr static index_type hypercube_side_length = detail::hypercube_side_length<dimensions>;
     constexpr static size_t compressed_block_length_bound
             = detail::ipow(hypercube_side_length, Dims) / bits_of<bits_type> * (bits_of<bits_type> + 1);
+    // Entropy-coded hypercubes are framed by a header and stored verbatim if coding does not pay off
+    constexpr static size_t entropy_coded_block_length_bound
+            = compressed_block_length_bound + div_ceil(entropy_frame_header_size, sizeof(bits_type));
 };
 
 template<dim_type Dims>
@@ -401,6 +1050,15 @@ index_type num_hypercubes(const static_extent<Dims> &array_size) {
     return num;
 }
 
+template<dim_type Dims>
+index_type num_hypercubes(const static_extent<Dims> &array_size, const static_extent<Dims> &hc_shape) {
+    index_type num = 1;
+    for (dim_type d = 0; d < Dims; ++d) {
+        num *= array_size[d] / hc_shape[d];
+    }
+    return num;
+}
+
 inline index_type num_hypercubes(const extent &size) {
     switch (size.dimensions()) {
         // This is actually independent of data type
@@ -411,6 +1069,85 @@ inline index_type num_hypercubes(const extent &size) {
     }
 }
 
+// An array with an axis shorter than the hypercube side length consists only of border. Folding merges every such axis
+// with its inner neighbour (the outer one for the innermost axis) until all remaining axes can hold a hypercube, which
+// reinterprets the array in memory order as a lower-dimensional one. Singleton axes are squeezed out the same way.
+struct dimension_folding {
+    extent folded_size;
+    std::array<dim_type, max_dimensionality> axis_groups{};  // folded axis that each axis of the array is merged into
+};
+
+inline std::optional<dimension_folding> fold_dimensions(const extent &size) {
+    const auto dims = size.dimensions();
+    dimension_folding folding;
+    std::array<index_type, max_dimensionality> group_sizes{};
+    for (dim_type d = 0; d < dims; ++d) {
+        group_sizes[d] = size[d];
+        folding.axis_groups[d] = d;
+    }
+
+    auto num_groups = dims;
+    while (num_groups > 1) {
+        const auto side_length = num_groups == 2 ? hypercube_side_length<2> : hypercube_side_length<3>;
+        dim_type thin = 0;
+        while (thin < num_groups && group_sizes[thin] >= side_length) {
+            ++thin;
+        }
+        if (thin == num_groups) { break; }
+
+        const auto outer = static_cast<dim_type>(thin + 1 < num_groups ? thin : thin - 1);
+        group_sizes[outer] *= group_sizes[outer + 1];
+        for (auto g = outer + 1; g + 1 < num_groups; ++g) {
+            group_sizes[g] = group_sizes[g + 1];
+        }
+        for (dim_type d = 0; d < dims; ++d) {
+            if (folding.axis_groups[d] > outer) { --folding.axis_groups[d]; }
+        }
+        --num_groups;
+    }
+    if (num_groups == dims) { return std::nullopt; }
+
+    folding.folded_size = extent(num_groups);
+    std::copy(group_sizes.begin(), group_sizes.begin() + num_groups, folding.folded_size.begin());
+    return folding;
+}
+
+// Maps dirty regions of an array to the folded array. Merged axes are contiguous in memory, so each region maps to the
+// range between its first and last element along every folded axis, which may cover additional elements.
+inline std::vector<box>
+fold_dirty_boxes(const dimension_folding &folding, const extent &array_size, const std::vector<box> &dirty) {
+    const auto dims = array_size.dimensions();
+    const auto folded_dims = folding.folded_size.dimensions();
+    std::vector<box> folded;
+    for (auto &b : dirty) {
+        if (b.offset.dimensions() != dims || b.size.dimensions() != dims) {
+            throw std::runtime_error{"dirty box dimensionality does not match data dimensionality"};
+        }
+        bool empty = false;
+        for (dim_type d = 0; d < dims; ++d) {
+            if (b.offset[d] > array_size[d] || b.size[d] > array_size[d] - b.offset[d]) {
+                throw std::runtime_error{"dirty box exceeds data bounds"};
+            }
+            empty |= b.size[d] == 0;
+        }
+        if (empty) { continue; }
+
+        extent first = extent::broadcast(folded_dims, 0);
+        extent last = extent::broadcast(folded_dims, 0);
+        for (dim_type d = 0; d < dims; ++d) {
+            const auto g = folding.axis_groups[d];
+            first[g] = first[g] * array_size[d] + b.offset[d];
+            last[g] = last[g] * array_size[d] + b.offset[d] + b.size[d] - 1;
+        }
+        box folded_box{first, extent(folded_dims)};
+        for (dim_type g = 0; g < folded_dims; ++g) {
+            folded_box.size[g] = last[g] - first[g] + 1;
+        }
+        folded.push_back(folded_box);
+    }
+    return folded;
+}
+
 template<dim_type Dims, dim_type ThisDim, typename F>
 [[gnu::always_inline]] void
 iter_hypercubes(const static_extent<Dims> &size, static_extent<Dims> &off, index_type &i, F &f) {
@@ -433,6 +1170,60 @@ void for_each_hypercube(const static_extent<Dims> &array_size, Fn &&f) {
 }
 
 
+struct dirty_set {
+    std::vector<index_type> hypercubes;  // sorted and unique
+    bool border = false;
+};
+
+// Determines which hypercubes and whether the border are touched by any of the dirty boxes.
+template<dim_type Dims>
+dirty_set find_dirty_hypercubes(const static_extent<Dims> &array_size, const std::vector<box> &dirty) {
+    constexpr auto side_length = hypercube_side_length<Dims>;
+    const auto hc_grid = array_size / side_length;
+
+    dirty_set set;
+    for (auto &b : dirty) {
+        if (b.offset.dimensions() != Dims || b.size.dimensions() != Dims) {
+            throw std::runtime_error{"dirty box dimensionality does not match data dimensionality"};
+        }
+
+        bool empty = false;
+        for (dim_type d = 0; d < Dims; ++d) {
+            if (b.offset[d] > array_size[d] || b.size[d] > array_size[d] - b.offset[d]) {
+                throw std::runtime_error{"dirty box exceeds data bounds"};
+            }
+            empty |= b.size[d] == 0;
+        }
+        if (empty) { continue; }
+
+        static_extent<Dims> first_hc, end_hc;
+        bool has_hypercubes = true;
+        for (dim_type d = 0; d < Dims; ++d) {
+            const auto end = b.offset[d] + b.size[d];
+            set.border |= end > hc_grid[d] * side_length;
+            first_hc[d] = b.offset[d] / side_length;
+            end_hc[d] = std::min(div_ceil(end, side_length), hc_grid[d]);
+            has_hypercubes &= first_hc[d] < end_hc[d];
+        }
+        if (!has_hypercubes) { continue; }
+
+        for (auto pos = first_hc;;) {
+            set.hypercubes.push_back(linear_index(hc_grid, pos));
+            dim_type d = Dims - 1;
+            while (d >= 0 && ++pos[d] == end_hc[d]) {
+                pos[d] = first_hc[d];
+                --d;
+            }
+            if (d < 0) { break; }
+        }
+    }
+
+    std::sort(set.hypercubes.begin(), set.hypercubes.end());
+    set.hypercubes.erase(std::unique(set.hypercubes.begin(), set.hypercubes.end()), set.hypercubes.end());
+    return set;
+}
+
+
 template<typename T>
 NDZIP_UNIVERSAL T rotate_left_1(T v) {
     return (v << 1u) | (v >> (bits_of<T> - 1u));
@@ -534,6 +1325,130 @@ inline void inverse_block_transform(T *x, dim_type dims, index_type n) {
     }
 }
 
+// Per-hypercube prediction schemes selectable with stream_options::adaptive_prediction. Values are stored in the
+// stream. Single-axis deltas are numbered by axis, axis dims - 1 being the innermost one.
+enum class predictor : uint8_t {
+    none = 0,
+    lorenzo = 1,
+    delta_axis_0 = 2,
+    delta_axis_1 = 3,
+    delta_axis_2 = 4,
+    second_order = 5,
+    xor_delta = 6,
+};
+
+inline bool is_valid_predictor(uint8_t selector, dim_type dims) {
+    const auto p = static_cast<predictor>(selector);
+    if (p >= predictor::delta_axis_0 && p <= predictor::delta_axis_2) {
+        return selector - static_cast<uint8_t>(predictor::delta_axis_0) < dims;
+    }
+    return p <= predictor::xor_delta;
+}
+
+inline dim_type predictor_axis(predictor p) {
+    return static_cast<uint8_t>(p) - static_cast<uint8_t>(predictor::delta_axis_0);
+}
+
+template<typename T>
+inline void xor_delta_step(T *x, index_type n, index_type s) {
+    T a, b;
+    b = x[0 * s];
+    for (index_type i = 1; i < n; ++i) {
+        a = b;
+        b = x[i * s];
+        x[i * s] = b ^ a;
+    }
+}
+
+template<typename T>
+inline void inverse_xor_delta_step(T *x, index_type n, index_type s) {
+    for (index_type i = 1; i < n; ++i) {
+        x[i * s] ^= x[(i - 1) * s];
+    }
+}
+
+// Applies step to every line of the hypercube that runs along axis
+template<typename T, typename Step>
+inline void for_each_axis_line(T *x, dim_type dims, index_type n, dim_type axis, Step &&step) {
+    const auto stride = ipow(n, dims - 1 - axis);
+    for (index_type i = 0; i < ipow(n, dims); ++i) {
+        if (i / stride % n == 0) { step(x + i, n, stride); }
+    }
+}
+
+// Bitwise Lorenzo transform of progressive streams, applying XOR deltas along every axis. Each bit of a residual only
+// depends on the bits of equal significance in the input, so the leading bit planes of the residuals reproduce the
+// leading bits of the values.
+template<typename T>
+inline void xor_lorenzo_transform(T *x, dim_type dims, index_type n) {
+    for (dim_type axis = 0; axis < dims; ++axis) {
+        for_each_axis_line(x, dims, n, axis, xor_delta_step<T>);
+    }
+}
+
+template<typename T>
+inline void inverse_xor_lorenzo_transform(T *x, dim_type dims, index_type n) {
+    for (dim_type axis = 0; axis < dims; ++axis) {
+        for_each_axis_line(x, dims, n, axis, inverse_xor_delta_step<T>);
+    }
+}
+
+// Generic implementation of the predictors. predictor::lorenzo is equivalent to block_transform, second_order
+// applies the Lorenzo differences twice and xor_delta operates on the raw bits along the innermost axis.
+template<typename T>
+inline void predict(T *x, dim_type dims, index_type n, predictor p) {
+    if (p == predictor::none) { return; }
+    if (p == predictor::xor_delta) {
+        for_each_axis_line(x, dims, n, dims - 1, xor_delta_step<T>);
+        return;
+    }
+
+    for (index_type i = 0; i < ipow(n, dims); ++i) {
+        x[i] = rotate_left_1(x[i]);
+    }
+
+    if (p == predictor::lorenzo || p == predictor::second_order) {
+        for (int order = p == predictor::second_order ? 2 : 1; order > 0; --order) {
+            for (dim_type axis = 0; axis < dims; ++axis) {
+                for_each_axis_line(x, dims, n, axis, block_transform_step<T>);
+            }
+        }
+    } else {
+        for_each_axis_line(x, dims, n, predictor_axis(p), block_transform_step<T>);
+    }
+
+    for (index_type i = 0; i < ipow(n, dims); ++i) {
+        x[i] = complement_negative(x[i]);
+    }
+}
+
+template<typename T>
+inline void inverse_predict(T *x, dim_type dims, index_type n, predictor p) {
+    if (p == predictor::none) { return; }
+    if (p == predictor::xor_delta) {
+        for_each_axis_line(x, dims, n, dims - 1, inverse_xor_delta_step<T>);
+        return;
+    }
+
+    for (index_type i = 0; i < ipow(n, dims); ++i) {
+        x[i] = complement_negative(x[i]);
+    }
+
+    if (p == predictor::lorenzo || p == predictor::second_order) {
+        for (int order = p == predictor::second_order ? 2 : 1; order > 0; --order) {
+            for (dim_type axis = 0; axis < dims; ++axis) {
+                for_each_axis_line(x, dims, n, axis, inverse_block_transform_step<T>);
+            }
+        }
+    } else {
+        for_each_axis_line(x, dims, n, predictor_axis(p), inverse_block_transform_step<T>);
+    }
+
+    for (index_type i = 0; i < ipow(n, dims); ++i) {
+        x[i] = rotate_right_1(x[i]);
+    }
+}
+
 
 template<typename Profile, typename SliceDataType, typename CubeDataType, typename F>
 [[gnu::always_inline]] void for_each_hypercube_slice(const static_extent<Profile::dimensions> &hc_offset,
@@ -1,8 +1,17 @@
 #pragma once
 
 #include "common.hh"
+#include "huffman.hh"
 
+#include <atomic>
+#include <bitset>
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <random>
 #include <stdexcept>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include <ndzip/ndzip.hh>
@@ -12,8 +21,11 @@
 #include <immintrin.h>
 #endif
 
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
 #ifdef NDZIP_OPENMP_SUPPORT
-#include <atomic>
 #include <omp.h>
 #include <queue>
 
@@ -71,29 +83,137 @@ class simd_aligned_buffer {
     void *_memory = nullptr;
 };
 
+// Sum and bounds of the values of a hypercube. NaNs are excluded from the bounds, so a hypercube of NaNs has an empty
+// range.
+template<typename T>
+struct hypercube_summary {
+    double sum = 0;
+    T min = std::numeric_limits<T>::infinity();
+    T max = -std::numeric_limits<T>::infinity();
+
+    void add(const T *values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            sum += values[i];
+            min = values[i] < min ? values[i] : min;
+            max = values[i] > max ? values[i] : max;
+        }
+    }
+};
+
+// Partial array_statistics of the values seen by one decoding thread
+struct statistics_accumulator {
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0;
+    double sum_of_squares = 0;
+    index_type num_values = 0;
+    index_type nan_count = 0;
+
+    void add(double value) {
+        ++num_values;
+        if (value != value) {
+            ++nan_count;
+            return;
+        }
+        min = value < min ? value : min;
+        max = value > max ? value : max;
+        sum += value;
+        sum_of_squares += value * value;
+    }
+
+    template<typename T>
+    void add(const T *values, index_type count) {
+        for (index_type i = 0; i < count; ++i) {
+            add(static_cast<double>(values[i]));
+        }
+    }
+
+    void merge(const statistics_accumulator &other) {
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+        sum += other.sum;
+        sum_of_squares += other.sum_of_squares;
+        num_values += other.num_values;
+        nan_count += other.nan_count;
+    }
+};
+
+// Loaders add the values of each row to `summary`, if given, while the row is being read anyway
 template<typename Profile>
 [[gnu::noinline]] void
 load_hypercube(const static_extent<Profile::dimensions> &hc_offset, const typename Profile::value_type *data,
-        const static_extent<Profile::dimensions> &data_size, typename Profile::bits_type *cube) {
+        const static_extent<Profile::dimensions> &data_size, typename Profile::bits_type *cube,
+        hypercube_summary<typename Profile::value_type> *summary = nullptr) {
     using value_type = typename Profile::value_type;
     using bits_type = typename Profile::bits_type;
 
     for_each_hypercube_slice<Profile>(
-            hc_offset, data, data_size, cube, [](const value_type *src, bits_type *dest, size_t n_elems) {
+            hc_offset, data, data_size, cube, [summary](const value_type *src, bits_type *dest, size_t n_elems) {
+                if (summary) { summary->add(src, n_elems); }
                 memcpy(assume_simd_aligned(dest), src, n_elems * sizeof(value_type));
             });
 }
 
+// Storers add the values of each row to `statistics`, if given, from the cube or as they are computed, so that the
+// hypercube is not read back from data
 template<typename Profile>
 [[gnu::noinline]] void
 store_hypercube(const static_extent<Profile::dimensions> &hc_offset, const typename Profile::bits_type *cube,
-        typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size) {
+        typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        statistics_accumulator *statistics = nullptr) {
+    using value_type = typename Profile::value_type;
+    using bits_type = typename Profile::bits_type;
+
+    for_each_hypercube_slice<Profile>(
+            hc_offset, data, data_size, cube, [statistics](value_type *dest, const bits_type *src, size_t n_elems) {
+                src = assume_simd_aligned(src);
+                memcpy(dest, src, n_elems * sizeof(value_type));
+                if (statistics) {
+                    for (size_t i = 0; i < n_elems; ++i) {
+                        statistics->add(load_aligned<value_type>(src + i));
+                    }
+                }
+            });
+}
+
+// Loads a hypercube as quantization bins. Returns false if some value could not be quantized within the error bound,
+// leaving the contents of cube unspecified.
+template<typename Profile>
+[[gnu::noinline]] bool load_quantized_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *cube, const quantizer<typename Profile::value_type> &quantizer,
+        hypercube_summary<typename Profile::value_type> *summary = nullptr) {
+    using value_type = typename Profile::value_type;
+    using bits_type = typename Profile::bits_type;
+
+    bool within_bound = true;
+    for_each_hypercube_slice<Profile>(
+            hc_offset, data, data_size, cube, [&](const value_type *src, bits_type *dest, size_t n_elems) {
+                if (summary) { summary->add(src, n_elems); }
+                dest = assume_simd_aligned(dest);
+                for (size_t i = 0; i < n_elems; ++i) {
+                    within_bound &= quantizer.quantize(src[i], dest[i]);
+                }
+            });
+    return within_bound;
+}
+
+template<typename Profile>
+[[gnu::noinline]] void store_dequantized_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::bits_type *cube, typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, const quantizer<typename Profile::value_type> &quantizer,
+        statistics_accumulator *statistics = nullptr) {
     using value_type = typename Profile::value_type;
     using bits_type = typename Profile::bits_type;
 
     for_each_hypercube_slice<Profile>(
-            hc_offset, data, data_size, cube, [](value_type *dest, const bits_type *src, size_t n_elems) {
-                memcpy(dest, assume_simd_aligned(src), n_elems * sizeof(value_type));
+            hc_offset, data, data_size, cube, [&](value_type *dest, const bits_type *src, size_t n_elems) {
+                src = assume_simd_aligned(src);
+                for (size_t i = 0; i < n_elems; ++i) {
+                    const auto value = quantizer.dequantize(src[i]);
+                    dest[i] = value;
+                    if (statistics) { statistics->add(value); }
+                }
             });
 }
 
@@ -130,7 +250,21 @@ template<typename Bits>
     }
 }
 
-template<index_type SideLength, typename Bits>
+// Element-wise differences the predictors are built from: arithmetic for Lorenzo-style transforms of rotated bits,
+// bitwise for XOR deltas of raw bits
+template<typename Bits>
+struct arithmetic_difference {
+    [[gnu::always_inline]] static __m256i forward(__m256i a, __m256i b) { return subtract_packed<Bits>(a, b); }
+    [[gnu::always_inline]] static Bits inverse(Bits a, Bits b) { return a + b; }
+};
+
+template<typename Bits>
+struct bitwise_difference {
+    [[gnu::always_inline]] static __m256i forward(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+    [[gnu::always_inline]] static Bits inverse(Bits a, Bits b) { return a ^ b; }
+};
+
+template<index_type SideLength, template<typename> typename Difference = arithmetic_difference, typename Bits>
 [[gnu::always_inline]] void block_transform_horizontal_avx2(Bits *line) {
     constexpr auto n_256bit_lanes = sizeof(Bits) * SideLength / simd_width_bytes;
     constexpr auto words_per_256bit_lane = simd_width_bytes / sizeof(Bits);
@@ -148,10 +282,10 @@ template<index_type SideLength, typename Bits>
         auto top = top_n;
         top_n = load_unaligned_256(line + (j + 1) * words_per_256bit_lane - 1);
         auto bottom = load_aligned_256(line + j * words_per_256bit_lane);
-        store_aligned_256(line + j * words_per_256bit_lane, subtract_packed<Bits>(bottom, top));
+        store_aligned_256(line + j * words_per_256bit_lane, Difference<Bits>::forward(bottom, top));
     }
     auto bottom = load_aligned_256(line + (n_256bit_lanes - 1) * words_per_256bit_lane);
-    store_aligned_256(line + (n_256bit_lanes - 1) * words_per_256bit_lane, subtract_packed<Bits>(bottom, top_n));
+    store_aligned_256(line + (n_256bit_lanes - 1) * words_per_256bit_lane, Difference<Bits>::forward(bottom, top_n));
 }
 
 template<index_type SideLength, typename Bits>
@@ -227,14 +361,14 @@ void block_transform_avx2(typename Profile::bits_type *x) {
     }
 }
 
-template<index_type SideLength, typename Bits>
+template<index_type SideLength, template<typename> typename Difference = arithmetic_difference, typename Bits>
 [[gnu::always_inline]] inline void inverse_block_transform_horizontal_sequential(Bits *x) {
     for (size_t i = 1; i < SideLength; ++i) {
-        x[i] += x[i - 1];
+        x[i] = Difference<Bits>::inverse(x[i], x[i - 1]);
     }
 }
 
-template<index_type SideLength, typename Bits>
+template<index_type SideLength, template<typename> typename Difference = arithmetic_difference, typename Bits>
 [[gnu::always_inline]] inline void inverse_block_transform_horizontal_interleaved(Bits *x) {
     constexpr auto interleave = 4;
     Bits vec[interleave];
@@ -244,7 +378,7 @@ template<index_type SideLength, typename Bits>
         }
         for (size_t j = 1; j < SideLength; ++j) {
             for (size_t k = 0; k < interleave; ++k) {
-                vec[k] += x[i + j + k * SideLength];
+                vec[k] = Difference<Bits>::inverse(vec[k], x[i + j + k * SideLength]);
             }
             for (size_t k = 0; k < interleave; ++k) {
                 x[i + j + k * SideLength] = vec[k];
@@ -320,6 +454,169 @@ void inverse_block_transform_avx2(typename Profile::bits_type *x) {
     }
 }
 
+template<typename Profile>
+void difference_along_axis_avx2(typename Profile::bits_type *x, dim_type axis) {
+    constexpr dim_type dims = Profile::dimensions;
+    constexpr size_t side_length = Profile::hypercube_side_length;
+    constexpr size_t hc_size = ipow(side_length, dims);
+
+    if (axis == dims - 1) {
+        for (size_t i = 0; i < hc_size; i += side_length) {
+            block_transform_horizontal_avx2<side_length>(x + i);
+        }
+    } else if constexpr (dims >= 2) {
+        if (axis == dims - 2) {
+            for (size_t i = 0; i < hc_size; i += side_length * side_length) {
+                block_transform_vertical_avx2<side_length>(x + i);
+            }
+        } else if constexpr (dims >= 3) {
+            block_transform_planes_avx2<side_length>(x);
+        }
+    }
+}
+
+template<typename Profile>
+void inverse_difference_along_axis_avx2(typename Profile::bits_type *x, dim_type axis) {
+    constexpr dim_type dims = Profile::dimensions;
+    constexpr size_t side_length = Profile::hypercube_side_length;
+    constexpr size_t hc_size = ipow(side_length, dims);
+
+    if (axis == dims - 1) {
+        if constexpr (dims == 1) {
+            inverse_block_transform_horizontal_sequential<side_length>(x);
+        } else {
+            for (size_t i = 0; i < hc_size; i += side_length * side_length) {
+                inverse_block_transform_horizontal_interleaved<side_length>(x + i);
+            }
+        }
+    } else if constexpr (dims >= 2) {
+        if (axis == dims - 2) {
+            for (size_t i = 0; i < hc_size; i += side_length * side_length) {
+                inverse_block_transform_vertical_avx2<side_length>(x + i);
+            }
+        } else if constexpr (dims >= 3) {
+            inverse_block_transform_planes_avx2<side_length>(x);
+        }
+    }
+}
+
+template<typename Profile>
+void predict_avx2(typename Profile::bits_type *x, predictor p) {
+    constexpr dim_type dims = Profile::dimensions;
+    constexpr size_t side_length = Profile::hypercube_side_length;
+    constexpr size_t hc_size = ipow(side_length, dims);
+
+    x = assume_simd_aligned(x);
+
+    switch (p) {
+        case predictor::none: return;
+        case predictor::lorenzo: block_transform_avx2<Profile>(x); return;
+        case predictor::xor_delta:
+            for (size_t i = 0; i < hc_size; i += side_length) {
+                block_transform_horizontal_avx2<side_length, bitwise_difference>(x + i);
+            }
+            return;
+        default: break;
+    }
+
+    for (size_t i = 0; i < hc_size; ++i) {
+        x[i] = rotate_left_1(x[i]);
+    }
+
+    if (p == predictor::second_order) {
+        for (int order = 0; order < 2; ++order) {
+            for (dim_type axis = 0; axis < dims; ++axis) {
+                difference_along_axis_avx2<Profile>(x, axis);
+            }
+        }
+    } else {
+        difference_along_axis_avx2<Profile>(x, predictor_axis(p));
+    }
+
+    for (size_t i = 0; i < hc_size; ++i) {
+        x[i] = complement_negative(x[i]);
+    }
+}
+
+template<typename Profile>
+void inverse_predict_avx2(typename Profile::bits_type *x, predictor p) {
+    constexpr dim_type dims = Profile::dimensions;
+    constexpr size_t side_length = Profile::hypercube_side_length;
+    constexpr size_t hc_size = ipow(side_length, dims);
+
+    x = assume_simd_aligned(x);
+
+    switch (p) {
+        case predictor::none: return;
+        case predictor::lorenzo: inverse_block_transform_avx2<Profile>(x); return;
+        case predictor::xor_delta:
+            if constexpr (dims == 1) {
+                inverse_block_transform_horizontal_sequential<side_length, bitwise_difference>(x);
+            } else {
+                for (size_t i = 0; i < hc_size; i += side_length * side_length) {
+                    inverse_block_transform_horizontal_interleaved<side_length, bitwise_difference>(x + i);
+                }
+            }
+            return;
+        default: break;
+    }
+
+    for (size_t i = 0; i < hc_size; ++i) {
+        x[i] = complement_negative(x[i]);
+    }
+
+    if (p == predictor::second_order) {
+        for (int order = 0; order < 2; ++order) {
+            for (dim_type axis = 0; axis < dims; ++axis) {
+                inverse_difference_along_axis_avx2<Profile>(x, axis);
+            }
+        }
+    } else {
+        inverse_difference_along_axis_avx2<Profile>(x, predictor_axis(p));
+    }
+
+    for (size_t i = 0; i < hc_size; ++i) {
+        x[i] = rotate_right_1(x[i]);
+    }
+}
+
+// Vectorized round_mantissa(), see there
+template<typename T>
+[[gnu::always_inline]] inline __m256i round_mantissa_avx2(__m256i bits, unsigned drop) {
+    using bits_type = detail::bits_type<T>;
+    const auto cmpeq = [](__m256i a, __m256i b) {
+        if constexpr (bits_of<bits_type> == 32) {
+            return _mm256_cmpeq_epi32(a, b);
+        } else {
+            return _mm256_cmpeq_epi64(a, b);
+        }
+    };
+    const auto broadcast = [](bits_type x) {
+        if constexpr (bits_of<bits_type> == 32) {
+            return _mm256_set1_epi32(static_cast<int32_t>(x));
+        } else {
+            return _mm256_set1_epi64x(static_cast<int64_t>(x));
+        }
+    };
+    const auto shift = _mm_cvtsi32_si128(static_cast<int>(drop));
+    const auto shifted = bits_of<bits_type> == 32 ? _mm256_srl_epi32(bits, shift) : _mm256_srl_epi64(bits, shift);
+
+    const auto keep_mask = broadcast(static_cast<bits_type>(~bits_type{0} << drop));
+    const auto exponent_mask = broadcast(detail::exponent_mask<T>);
+    const auto mantissa_mask = broadcast((bits_type{1} << mantissa_bits<T>) - 1);
+    const auto quiet_bit = broadcast(bits_type{1} << (mantissa_bits<T> - 1));
+    const auto bias = add_packed<bits_type>(broadcast(static_cast<bits_type>((bits_type{1} << (drop - 1)) - 1)),
+            _mm256_and_si256(shifted, broadcast(1)));
+    const auto rounded = _mm256_and_si256(add_packed<bits_type>(bits, bias), keep_mask);
+    const auto truncated = _mm256_and_si256(bits, keep_mask);
+    const auto zero_mantissa = cmpeq(_mm256_and_si256(bits, mantissa_mask), _mm256_setzero_si256());
+    const auto special = cmpeq(_mm256_and_si256(bits, exponent_mask), exponent_mask);
+    const auto overflow = cmpeq(_mm256_and_si256(rounded, exponent_mask), exponent_mask);
+    const auto result = _mm256_blendv_epi8(rounded, truncated, overflow);
+    const auto special_result = _mm256_or_si256(truncated, _mm256_andnot_si256(zero_mantissa, quiet_bit));
+    return _mm256_blendv_epi8(result, special_result, special);
+}
+
 #endif  // __AVX2__
 
 template<typename Profile>
@@ -340,6 +637,188 @@ template<typename Profile>
 #endif
 }
 
+template<typename Profile>
+[[gnu::noinline]] void predict(typename Profile::bits_type *x, predictor p) {
+#ifdef __AVX2__
+    predict_avx2<Profile>(x, p);
+#else
+    ndzip::detail::predict(x, Profile::dimensions, Profile::hypercube_side_length, p);
+#endif
+}
+
+template<typename Profile>
+[[gnu::noinline]] void inverse_predict(typename Profile::bits_type *x, predictor p) {
+#ifdef __AVX2__
+    inverse_predict_avx2<Profile>(x, p);
+#else
+    ndzip::detail::inverse_predict(x, Profile::dimensions, Profile::hypercube_side_length, p);
+#endif
+}
+
+// Loads a hypercube while rounding away the low `drop` mantissa bits of each value and shifting the remaining bits down
+template<typename Profile>
+[[gnu::noinline]] void load_truncated_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *cube, unsigned drop,
+        hypercube_summary<typename Profile::value_type> *summary = nullptr) {
+    using value_type = typename Profile::value_type;
+    using bits_type = typename Profile::bits_type;
+
+    for_each_hypercube_slice<Profile>(hc_offset, data, data_size, cube,
+            [drop, summary](const value_type *src, bits_type *dest, size_t n_elems) {
+                if (summary) { summary->add(src, n_elems); }
+                dest = assume_simd_aligned(dest);
+#ifdef __AVX2__
+                constexpr size_t words_per_vector = simd_width_bytes / sizeof(bits_type);
+                static_assert(Profile::hypercube_side_length % words_per_vector == 0);
+                const auto shift = _mm_cvtsi32_si128(static_cast<int>(drop));
+                for (size_t i = 0; i < n_elems; i += words_per_vector) {
+                    const auto rounded = round_mantissa_avx2<value_type>(load_unaligned_256(src + i), drop);
+                    store_aligned_256(dest + i,
+                            bits_of<bits_type> == 32 ? _mm256_srl_epi32(rounded, shift)
+                                                     : _mm256_srl_epi64(rounded, shift));
+                }
+#else
+                for (size_t i = 0; i < n_elems; ++i) {
+                    dest[i] = round_mantissa<value_type>(load_unaligned<bits_type>(src + i), drop) >> drop;
+                }
+#endif
+            });
+}
+
+// Inverse of load_truncated_hypercube
+template<typename Profile>
+[[gnu::noinline]] void store_truncated_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::bits_type *cube, typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, unsigned drop,
+        statistics_accumulator *statistics = nullptr) {
+    using value_type = typename Profile::value_type;
+    using bits_type = typename Profile::bits_type;
+
+    for_each_hypercube_slice<Profile>(hc_offset, data, data_size, cube,
+            [drop, statistics](value_type *dest, const bits_type *src, size_t n_elems) {
+                src = assume_simd_aligned(src);
+                for (size_t i = 0; i < n_elems; ++i) {
+                    store_unaligned(dest + i, static_cast<bits_type>(src[i] << drop));
+                }
+                if (statistics) {
+                    for (size_t i = 0; i < n_elems; ++i) {
+                        const auto bits = static_cast<bits_type>(src[i] << drop);
+                        statistics->add(load_aligned<value_type>(&bits));
+                    }
+                }
+            });
+}
+
+// Picks the predictor that minimizes the encoded size of a sample of the hypercube's zero-bit chunks. The encoded
+// size of a chunk is the popcount of its zero map, which is the bitwise OR of its residuals. Residuals are evaluated
+// row segment by row segment: Lorenzo and second-order differences across the outer axes are accumulated from the
+// neighboring rows, then differenced along the inner axis. Elements outside the hypercube count as zero.
+template<typename Profile>
+[[gnu::noinline]] predictor select_predictor(const typename Profile::bits_type *cube) {
+    using bits_type = typename Profile::bits_type;
+    constexpr dim_type dims = Profile::dimensions;
+    constexpr index_type side_length = Profile::hypercube_side_length;
+    constexpr index_type hc_size = ipow(side_length, dims);
+    constexpr index_type chunk_size = bits_of<bits_type>;
+    constexpr index_type sample_stride = 16;  // in chunks
+    constexpr index_type segment_length = std::min(side_length, chunk_size);
+    constexpr index_type halo = 2;  // preceding elements required by second-order differences
+    constexpr index_type padded_length = segment_length + halo;
+
+    enum { lorenzo, second_order, xor_delta, none, delta_axis_0 };
+    constexpr index_type num_candidates = delta_axis_0 + dims;
+    index_type cost[num_candidates] = {};
+
+    cube = assume_simd_aligned(cube);
+
+    for (index_type chunk = sample_stride / 2; chunk < hc_size / chunk_size; chunk += sample_stride) {
+        bits_type zero_map[num_candidates] = {};
+        for (index_type i0 = chunk * chunk_size; i0 < (chunk + 1) * chunk_size; i0 += segment_length) {
+            const index_type inner = i0 % side_length;
+            const index_type row = i0 / side_length;
+
+            const auto load_rotated = [&](index_type row_index, bits_type *out) {
+                for (index_type j = 0; j < padded_length; ++j) {
+                    out[j] = inner + j >= halo ? rotate_left_1(cube[row_index * side_length + inner + j - halo]) : 0;
+                }
+            };
+
+            // Lorenzo has coefficients (-1)^k on the outer neighbors {0, 1}^(dims-1), second order applies them
+            // twice, giving products of (1, -2, 1) on {0, 1, 2}^(dims-1)
+            bits_type first[padded_length] = {}, second[padded_length] = {};
+            bits_type axis_rows[dims][padded_length] = {};  // the row itself and its predecessors along outer axes
+            for (index_type neighbor = 0; neighbor < ipow(index_type{3}, dims - 1); ++neighbor) {
+                bits_type coefficient = 1;
+                bool in_bounds = true, in_first_order = true, odd = false;
+                index_type neighbor_row = row;
+                index_type num_offset_axes = 0, offset_axis = 0;
+                for (index_type d = dims - 1, c = neighbor, s = 1, r = row; d-- > 0;
+                        c /= 3, s *= side_length, r /= side_length) {
+                    const auto o = c % 3;
+                    in_bounds &= o <= r % side_length;
+                    in_first_order &= o < 2;
+                    if (o == 1) {
+                        coefficient *= bits_type{0} - 2;
+                        odd = !odd;
+                    }
+                    if (o != 0) {
+                        ++num_offset_axes;
+                        offset_axis = d;
+                    }
+                    neighbor_row -= o * s;
+                }
+                if (!in_bounds) { continue; }
+
+                bits_type values[padded_length];
+                load_rotated(neighbor_row, values);
+                for (index_type j = 0; j < padded_length; ++j) {
+                    second[j] += coefficient * values[j];
+                }
+                if (in_first_order) {
+                    for (index_type j = 0; j < padded_length; ++j) {
+                        first[j] += odd ? bits_type{0} - values[j] : values[j];
+                    }
+                }
+                if (num_offset_axes == 0) {
+                    std::copy(values, values + padded_length, axis_rows[dims - 1]);
+                } else if (num_offset_axes == 1 && in_first_order) {
+                    std::copy(values, values + padded_length, axis_rows[offset_axis]);
+                }
+            }
+
+            const auto *row_values = axis_rows[dims - 1];
+            for (index_type j = halo; j < padded_length; ++j) {
+                zero_map[lorenzo] |= complement_negative(first[j] - first[j - 1]);
+                zero_map[second_order] |= complement_negative(second[j] - 2 * second[j - 1] + second[j - 2]);
+                zero_map[delta_axis_0 + dims - 1] |= complement_negative(row_values[j] - row_values[j - 1]);
+                for (dim_type d = 0; d + 1 < dims; ++d) {
+                    zero_map[delta_axis_0 + d] |= complement_negative(row_values[j] - axis_rows[d][j]);
+                }
+            }
+            for (index_type k = i0; k < i0 + segment_length; ++k) {
+                zero_map[none] |= cube[k];
+                zero_map[xor_delta] |= cube[k] ^ (k % side_length > 0 ? cube[k - 1] : bits_type{0});
+            }
+        }
+        for (index_type c = 0; c < num_candidates; ++c) {
+            cost[c] += popcount(zero_map[c]);
+        }
+    }
+
+    index_type best = lorenzo;
+    for (index_type c = 1; c < num_candidates; ++c) {
+        if (cost[c] < cost[best]) { best = c; }
+    }
+    switch (best) {
+        case lorenzo: return predictor::lorenzo;
+        case second_order: return predictor::second_order;
+        case xor_delta: return predictor::xor_delta;
+        case none: return predictor::none;
+        default: return static_cast<predictor>(static_cast<uint8_t>(predictor::delta_axis_0) + best - delta_axis_0);
+    }
+}
+
 
 template<typename T>
 T generate_zero_map(const T *u) {
@@ -558,6 +1037,17 @@ template<typename Bits>
     return body_pos;
 }
 
+// Length in words of zero_bit_encode(cube), computed from the zero maps alone. Without output to write, no chunk needs
+// to be transposed or compacted, which makes a count over a dense hypercube as cheap as over a sparse one.
+template<typename Bits>
+index_type zero_bit_encoded_length(const Bits *cube, index_type hc_size) {
+    index_type length = hc_size / bits_of<Bits>;
+    for (index_type offset = 0; offset < hc_size; offset += bits_of<Bits>) {
+        length += popcount(generate_zero_map(cube + offset));
+    }
+    return length;
+}
+
 template<typename Bits>
 [[gnu::noinline]] size_t zero_bit_decode(const std::byte *stream, Bits *cube, size_t hc_size) {
     size_t head_pos = 0;
@@ -577,108 +1067,39 @@ template<typename Bits>
     return body_pos;
 }
 
+// Replaces a loaded hypercube by its integer residual against the co-located hypercube of the reference array and
+// returns the reference's contribution to the stream fingerprint.
 template<typename Profile>
-class serial_compressor : public compressor<typename Profile::value_type> {
-  public:
-    using value_type = typename Profile::value_type;
-
-  private:
-    using bits_type = typename Profile::bits_type;
-    constexpr static auto dimensions = Profile::dimensions;
-    constexpr static auto side_length = Profile::hypercube_side_length;
-    constexpr static auto hc_size = detail::ipow(side_length, dimensions);
-
-    detail::cpu::simd_aligned_buffer<bits_type> cube{hc_size};
-
-  public:
-    index_type compress(const value_type *data, const extent &data_size, bits_type *raw_stream) override;
-};
-
-template<typename Profile>
-index_type
-serial_compressor<Profile>::compress(const value_type *data, const extent &data_size, bits_type *raw_stream) {
-    if (data_size.dimensions() != dimensions) {
-        throw std::runtime_error{"data dimensionality does not match compressor dimensionality"};
+[[gnu::noinline]] uint64_t subtract_reference(const static_extent<Profile::dimensions> &hc_offset,
+        index_type hc_index, const typename Profile::value_type *reference,
+        const static_extent<Profile::dimensions> &data_size, typename Profile::bits_type *cube,
+        typename Profile::bits_type *reference_cube) {
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+    cube = assume_simd_aligned(cube);
+    reference_cube = assume_simd_aligned(reference_cube);
+
+    load_hypercube<Profile>(hc_offset, reference, data_size, reference_cube);
+    for (index_type i = 0; i < hc_size; ++i) {
+        cube[i] -= reference_cube[i];
     }
-
-    const auto static_size = detail::static_extent<dimensions>{data_size};
-    detail::stream<Profile> stream{num_hypercubes(static_size), raw_stream};
-
-    index_type offset = 0;
-    for_each_hypercube(static_size, [&](auto hc_offset, auto hc_index) {
-        detail::cpu::load_hypercube<Profile>(hc_offset, data, static_size, cube.data());
-        detail::cpu::block_transform<Profile>(cube.data());
-        offset += detail::cpu::zero_bit_encode<bits_type>(
-                          cube.data(), reinterpret_cast<std::byte *>(stream.hypercube(hc_index)) /* TODO */, hc_size)
-                / sizeof(bits_type);
-        stream.set_offset_after(hc_index, offset);
-    });
-
-    const auto border_length = detail::pack_border(stream.border(), data, static_size, Profile::hypercube_side_length);
-    return (stream.border() - stream.buffer) + border_length;
+    return hypercube_fingerprint(reference_cube, hc_size, hc_index);
 }
 
-
-template<typename Profile>
-class serial_decompressor : public decompressor<typename Profile::value_type> {
-  public:
-    using value_type = typename Profile::value_type;
-
-  private:
-    using bits_type = typename Profile::bits_type;
-
-    constexpr static auto dimensions = Profile::dimensions;
-    constexpr static auto side_length = Profile::hypercube_side_length;
-    constexpr static auto hc_size = detail::ipow(side_length, dimensions);
-
-    detail::cpu::simd_aligned_buffer<bits_type> cube{hc_size};
-
-  public:
-    ndzip::index_type decompress(const bits_type *raw_stream, value_type *data, const extent &data_size) override;
-};
-
 template<typename Profile>
-index_type
-serial_decompressor<Profile>::decompress(const bits_type *raw_stream, value_type *data, const extent &data_size) {
-    if (data_size.dimensions() != dimensions) {
-        throw std::runtime_error{"data dimensionality does not match decompressor dimensionality"};
+[[gnu::noinline]] uint64_t add_reference(const static_extent<Profile::dimensions> &hc_offset, index_type hc_index,
+        const typename Profile::value_type *reference, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *cube, typename Profile::bits_type *reference_cube) {
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+    cube = assume_simd_aligned(cube);
+    reference_cube = assume_simd_aligned(reference_cube);
+
+    load_hypercube<Profile>(hc_offset, reference, data_size, reference_cube);
+    for (index_type i = 0; i < hc_size; ++i) {
+        cube[i] += reference_cube[i];
     }
-
-    const auto static_size = detail::static_extent<dimensions>(data_size);
-    detail::stream<const Profile> stream{num_hypercubes(static_size), raw_stream};
-
-    for_each_hypercube(static_size, [&](auto hc_offset, auto hc_index) {
-        detail::cpu::zero_bit_decode<bits_type>(
-                reinterpret_cast<const std::byte *>(stream.hypercube(hc_index)), cube.data(), hc_size);
-        detail::cpu::inverse_block_transform<Profile>(cube.data());
-        detail::cpu::store_hypercube<Profile>(hc_offset, cube.data(), data, static_size);
-    });
-    const auto border_length
-            = detail::unpack_border(data, static_size, stream.border(), Profile::hypercube_side_length);
-    return (stream.border() - stream.buffer) + border_length;
+    return hypercube_fingerprint(reference_cube, hc_size, hc_index);
 }
 
-extern template class serial_compressor<profile<float, 1>>;
-extern template class serial_compressor<profile<float, 2>>;
-extern template class serial_compressor<profile<float, 3>>;
-extern template class serial_compressor<profile<double, 1>>;
-extern template class serial_compressor<profile<double, 2>>;
-extern template class serial_compressor<profile<double, 3>>;
-
-extern template class serial_decompressor<profile<float, 1>>;
-extern template class serial_decompressor<profile<float, 2>>;
-extern template class serial_decompressor<profile<float, 3>>;
-extern template class serial_decompressor<profile<double, 1>>;
-extern template class serial_decompressor<profile<double, 2>>;
-extern template class serial_decompressor<profile<double, 3>>;
-
-#ifdef SPLIT_CONFIGURATION_cpu_encoder
-template class serial_compressor<profile<DATA_TYPE, DIMENSIONS>>;
-template class serial_decompressor<profile<DATA_TYPE, DIMENSIONS>>;
-#endif
-
-#if NDZIP_OPENMP_SUPPORT
-
 template<typename Profile>
 struct cube_buffer {
     using value_type = typename Profile::value_type;
@@ -697,12 +1118,3067 @@ struct cube_buffer {
     const bits_type *data() const { return detail::cpu::assume_simd_aligned(cube.data()); }
 };
 
+// Staging area for the zero-bit encoding of a hypercube on its way through the entropy coder, and the decoding tables
+// of the entropy coder, which are rebuilt for every hypercube
 template<typename Profile>
-class openmp_compressor : public compressor<typename Profile::value_type> {
-  public:
-    using value_type = typename Profile::value_type;
-
-  private:
+struct encoding_buffer {
+    using bits_type = typename Profile::bits_type;
+
+    alignas(detail::cpu::simd_width_bytes) std::array<bits_type, Profile::compressed_block_length_bound> words;
+    huffman_decode_tables decode_tables;
+
+    bits_type *data() { return detail::cpu::assume_simd_aligned(words.data()); }
+};
+
+// Compile-time shape of a hypercube, outermost axis first. Every supported shape holds as many values as the cubic
+// hypercube of its dimensionality, so hypercubes are encoded like those of the default profile and only tiling and
+// block transform depend on the shape.
+template<index_type... Extents>
+struct hypercube_shape {
+    constexpr static dim_type dimensions = sizeof...(Extents);
+    constexpr static index_type extents[] = {Extents...};
+    constexpr static index_type num_values = (Extents * ...);
+    constexpr static index_type row_length = extents[dimensions - 1];
+
+    // Distance between neighbors along axis d in a flattened hypercube
+    constexpr static index_type stride(dim_type d) { return d + 1 < dimensions ? extents[d + 1] * stride(d + 1) : 1; }
+
+    static static_extent<dimensions> tile() { return static_extent<dimensions>{Extents...}; }
+
+    static extent as_extent() {
+        extent shape(dimensions);
+        std::copy(std::begin(extents), std::end(extents), shape.begin());
+        return shape;
+    }
+
+    static bool matches(const extent &shape) {
+        if (shape.dimensions() != dimensions) { return false; }
+        for (dim_type d = 0; d < dimensions; ++d) {
+            if (shape[d] != extents[d]) { return false; }
+        }
+        return true;
+    }
+};
+
+// Hypercubes along short innermost axes must still fill a SIMD register per row
+template<dim_type Dims>
+struct supported_hypercube_shapes;
+
+template<>
+struct supported_hypercube_shapes<1> {
+    using type = std::tuple<hypercube_shape<4096>>;
+};
+
+template<>
+struct supported_hypercube_shapes<2> {
+    using type = std::tuple<hypercube_shape<64, 64>, hypercube_shape<32, 128>, hypercube_shape<16, 256>,
+            hypercube_shape<128, 32>, hypercube_shape<256, 16>>;
+};
+
+template<>
+struct supported_hypercube_shapes<3> {
+    using type = std::tuple<hypercube_shape<16, 16, 16>, hypercube_shape<4, 32, 32>, hypercube_shape<32, 4, 32>,
+            hypercube_shape<8, 16, 32>, hypercube_shape<8, 32, 16>, hypercube_shape<16, 8, 32>,
+            hypercube_shape<16, 32, 8>, hypercube_shape<32, 8, 16>, hypercube_shape<32, 16, 8>>;
+};
+
+// Calls fn with the supported hypercube_shape equal to `shape`, throws if there is none
+template<dim_type Dims, typename Fn>
+void visit_hypercube_shape(const extent &shape, const Fn &fn) {
+    const auto visit = [&](auto... shapes) {
+        return ((decltype(shapes)::matches(shape) && (fn(shapes), true)) || ...);
+    };
+    if (!std::apply(visit, typename supported_hypercube_shapes<Dims>::type{})) {
+        throw std::invalid_argument{"unsupported hypercube shape"};
+    }
+}
+
+inline std::vector<extent> list_hypercube_shapes(dim_type dims) {
+    const auto list = [](auto... shapes) { return std::vector<extent>{decltype(shapes)::as_extent()...}; };
+    switch (dims) {
+        case 1: return std::apply(list, typename supported_hypercube_shapes<1>::type{});
+        case 2: return std::apply(list, typename supported_hypercube_shapes<2>::type{});
+        case 3: return std::apply(list, typename supported_hypercube_shapes<3>::type{});
+        default: abort();
+    }
+}
+
+template<typename T>
+void validate_stream_options(const stream_options &options, dim_type dims) {
+    if (options.level < 0 || options.level > max_compression_level) {
+        throw std::invalid_argument{"compression level must be between 0 and " + std::to_string(max_compression_level)};
+    }
+    if (!(options.error_bound >= 0 && std::isfinite(options.error_bound))) {
+        throw std::invalid_argument{"error bound must be finite and non-negative"};
+    }
+    if (options.mantissa_bits < 0 || options.mantissa_bits > static_cast<int>(mantissa_bits<T>)) {
+        throw std::invalid_argument{
+                "number of mantissa bits must be between 0 and " + std::to_string(mantissa_bits<T>)};
+    }
+    if (options.mantissa_bits > 0 && options.error_bound > 0) {
+        throw std::invalid_argument{"mantissa truncation cannot be combined with an error bound"};
+    }
+    constexpr auto max_rate = static_cast<int>(bits_of<bits_type<T>>) + 1;
+    if (options.fixed_rate != 0 && (options.fixed_rate < 2 || options.fixed_rate > max_rate)) {
+        throw std::invalid_argument{"fixed rate must be 0 or between 2 and " + std::to_string(max_rate)};
+    }
+    if (options.fixed_rate > 0 && (options.level > 0 || options.error_bound > 0 || options.mantissa_bits > 0)) {
+        throw std::invalid_argument{"fixed-rate compression cannot be combined with levels or other lossy modes"};
+    }
+    if (options.progressive
+            && (options.adaptive_prediction || options.level > 0 || options.error_bound > 0
+                    || options.mantissa_bits > 0 || options.fixed_rate > 0 || options.hypercube_means
+                    || options.hypercube_bounds || options.deduplicate || options.prediction_chain_length > 0)) {
+        throw std::invalid_argument{"progressive streams cannot be combined with other stream options"};
+    }
+    if (options.deduplicate && options.fixed_rate > 0) {
+        throw std::invalid_argument{"fixed-rate streams cannot be deduplicated"};
+    }
+    if (options.prediction_chain_length < 0 || options.prediction_chain_length == 1) {
+        throw std::invalid_argument{"prediction chain length must be 0 or at least 2"};
+    }
+    if (options.prediction_chain_length > 0
+            && (options.adaptive_prediction || options.error_bound > 0 || options.mantissa_bits > 0
+                    || options.fixed_rate > 0 || options.deduplicate)) {
+        throw std::invalid_argument{
+                "cross-hypercube prediction cannot be combined with adaptive prediction, lossy modes or deduplication"};
+    }
+    if (options.raw_fallback
+            && (options.error_bound > 0 || options.mantissa_bits > 0 || options.fixed_rate > 0 || options.progressive
+                    || options.hypercube_shape)) {
+        throw std::invalid_argument{"raw fallback cannot be combined with lossy modes, progressive streams or shapes"};
+    }
+    if (options.compressed_border && (options.fixed_rate > 0 || options.progressive || options.hypercube_shape)) {
+        throw std::invalid_argument{
+                "compressed borders cannot be combined with fixed-rate, progressive or custom-shaped streams"};
+    }
+    if (options.fold_dimensions && (options.progressive || options.hypercube_shape)) {
+        throw std::invalid_argument{"dimension folding cannot be combined with progressive or custom-shaped streams"};
+    }
+    if (options.hypercube_checksums && (options.fixed_rate > 0 || options.progressive || options.hypercube_shape)) {
+        throw std::invalid_argument{
+                "hypercube checksums cannot be combined with fixed-rate, progressive or custom-shaped streams"};
+    }
+    if (options.hypercube_shape) {
+        if (options.adaptive_prediction || options.error_bound > 0 || options.mantissa_bits > 0
+                || options.fixed_rate > 0 || options.progressive || options.hypercube_means || options.hypercube_bounds
+                || options.deduplicate || options.prediction_chain_length > 0) {
+            throw std::invalid_argument{"custom hypercube shapes cannot be combined with options other than level"};
+        }
+        const auto check_shape = [](auto) {};
+        switch (dims) {
+            case 1: visit_hypercube_shape<1>(*options.hypercube_shape, check_shape); break;
+            case 2: visit_hypercube_shape<2>(*options.hypercube_shape, check_shape); break;
+            case 3: visit_hypercube_shape<3>(*options.hypercube_shape, check_shape); break;
+        }
+    }
+}
+
+// Estimates the length of a stream compressed with default stream options from the hypercubes of a stratified random
+// sample, or counts it exactly if sample_fraction is 1. Headers and border are known without compressing anything.
+template<typename Profile>
+compressed_length_estimate estimate_compressed_length(
+        const typename Profile::value_type *data, const extent &data_size, double sample_fraction) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, dims);
+    constexpr index_type min_samples = 16;
+    constexpr double z_95 = 1.96;
+
+    const auto static_size = static_extent<dims>{data_size};
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    const auto header_length = ceil(num_hypercubes * bytes_of<index_type>, bytes_of<bits_type>) / bytes_of<bits_type>;
+    const auto fixed_length = header_length + border_element_count(static_size, side_length);
+    auto num_samples = num_hypercubes;
+    if (sample_fraction < 1) {
+        const auto fraction = static_cast<index_type>(std::ceil(sample_fraction * num_hypercubes));
+        num_samples = std::min(num_hypercubes, std::max(min_samples, fraction));
+    }
+
+    simd_aligned_buffer<bits_type> cube(hc_size);
+    std::mt19937 rng;  // default seed, estimates are reproducible
+    double sum = 0;
+    double sum_of_squares = 0;
+    for (index_type s = 0; s < num_samples; ++s) {
+        auto hc_index = s;
+        if (num_samples < num_hypercubes) {
+            const auto first_in_stratum = static_cast<index_type>(uint64_t{s} * num_hypercubes / num_samples);
+            const auto end_of_stratum = static_cast<index_type>(uint64_t{s + 1} * num_hypercubes / num_samples);
+            hc_index = std::uniform_int_distribution<index_type>{first_in_stratum, end_of_stratum - 1}(rng);
+        }
+        const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+        load_hypercube<Profile>(hc_offset, data, static_size, cube.data());
+        block_transform<Profile>(cube.data());
+        const auto length = static_cast<double>(zero_bit_encoded_length(cube.data(), hc_size));
+        sum += length;
+        sum_of_squares += length * length;
+    }
+
+    if (num_samples == num_hypercubes) {
+        const auto length = fixed_length + static_cast<index_type>(sum);
+        return {length, length, length, true};
+    }
+
+    // Normal-approximation 95% interval for the total, with finite population correction
+    const auto n = static_cast<double>(num_samples);
+    const auto population = static_cast<double>(num_hypercubes);
+    const auto mean = sum / n;
+    const auto variance = num_samples > 1 ? std::max(0.0, (sum_of_squares - n * mean * mean) / (n - 1)) : 0.0;
+    const auto half_width = z_95 * population * std::sqrt(variance / n * (1 - n / population));
+    const auto min_total = population * static_cast<double>(hc_size / bits_of<bits_type>);
+    const auto max_total = population * static_cast<double>(hc_size / bits_of<bits_type> + hc_size);
+    const auto total = [&](double t) {
+        return fixed_length + static_cast<index_type>(std::llround(std::clamp(t, min_total, max_total)));
+    };
+    return {total(population * mean), total(population * mean - half_width), total(population * mean + half_width),
+            false};
+}
+
+// Zero-bit encodes a transformed hypercube to dest and returns the encoded length in words. At levels > 0, the
+// encoding is staged in scratch and written as an entropy-coded frame.
+template<typename Profile>
+index_type encode_hypercube(const typename Profile::bits_type *cube, typename Profile::bits_type *dest, int level,
+        typename Profile::bits_type *scratch) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+
+    if (level == 0) {
+        return zero_bit_encode<bits_type>(cube, reinterpret_cast<std::byte *>(dest), hc_size) / sizeof(bits_type);
+    }
+
+    const auto encoded = reinterpret_cast<const std::byte *>(scratch);
+    const auto encoded_size = zero_bit_encode<bits_type>(cube, reinterpret_cast<std::byte *>(scratch), hc_size);
+
+    const auto frame = reinterpret_cast<std::byte *>(dest);
+    const auto body = frame + entropy_frame_header_size;
+    auto num_contexts = level == 1 ? 1u : bytes_of<bits_type>;
+    auto body_size = huffman_encode(encoded, encoded_size, num_contexts, body, encoded_size);
+    if (body_size == 0) {
+        num_contexts = 0;
+        body_size = encoded_size;
+        memcpy(body, encoded, encoded_size);
+    }
+    store_unaligned(frame, static_cast<uint32_t>(encoded_size));
+    store_unaligned(frame + sizeof(uint32_t), static_cast<uint32_t>(num_contexts));
+
+    const auto frame_size = entropy_frame_header_size + body_size;
+    const auto frame_length = div_ceil(frame_size, sizeof(bits_type));
+    memset(frame + frame_size, 0, frame_length * sizeof(bits_type) - frame_size);
+    return static_cast<index_type>(frame_length);
+}
+
+// Inverse of encode_hypercube for a hypercube of src_length words
+template<typename Profile>
+void decode_hypercube(const typename Profile::bits_type *src, index_type src_length,
+        typename Profile::bits_type *cube, bool entropy_coded, encoding_buffer<Profile> &scratch) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+
+    const auto frame = reinterpret_cast<const std::byte *>(src);
+    if (!entropy_coded) {
+        zero_bit_decode<bits_type>(frame, cube, hc_size);
+        return;
+    }
+
+    const auto frame_size = size_t{src_length} * sizeof(bits_type);
+    const auto encoded_size = load_unaligned<uint32_t>(frame);
+    const auto num_contexts = load_unaligned<uint32_t>(frame + sizeof(uint32_t));
+    const auto body = frame + entropy_frame_header_size;
+    if (frame_size < entropy_frame_header_size
+            || encoded_size > Profile::compressed_block_length_bound * sizeof(bits_type)
+            || (num_contexts == 0 && encoded_size > frame_size - entropy_frame_header_size)) {
+        throw std::runtime_error{"corrupt entropy-coded hypercube"};
+    }
+
+    if (num_contexts == 0) {
+        zero_bit_decode<bits_type>(body, cube, hc_size);
+    } else {
+        huffman_decode(body, frame_size - entropy_frame_header_size, reinterpret_cast<std::byte *>(scratch.data()),
+                encoded_size, num_contexts, scratch.decode_tables);
+        zero_bit_decode<bits_type>(reinterpret_cast<const std::byte *>(scratch.data()), cube, hc_size);
+    }
+}
+
+
+// Copies the values of the hypercube at hc_offset to an unaligned stream position
+template<typename Profile>
+void write_raw_hypercube(const static_extent<Profile::dimensions> &hc_offset, const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, typename Profile::bits_type *dest) {
+    using value_type = typename Profile::value_type;
+    using bits_type = typename Profile::bits_type;
+
+    for_each_hypercube_slice<Profile>(
+            hc_offset, data, data_size, dest, [](const value_type *src, bits_type *dest, size_t n_elems) {
+                memcpy(dest, src, n_elems * sizeof(value_type));
+            });
+}
+
+// Inverse of write_raw_hypercube for a hypercube of src_length words
+template<typename Profile>
+void read_raw_hypercube(const static_extent<Profile::dimensions> &hc_offset, const typename Profile::bits_type *src,
+        index_type src_length, typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        statistics_accumulator *statistics = nullptr) {
+    using value_type = typename Profile::value_type;
+    using bits_type = typename Profile::bits_type;
+
+    if (src_length != ipow(Profile::hypercube_side_length, Profile::dimensions)) {
+        throw std::runtime_error{"corrupt raw hypercube"};
+    }
+    for_each_hypercube_slice<Profile>(
+            hc_offset, data, data_size, src, [statistics](value_type *dest, const bits_type *src, size_t n_elems) {
+                memcpy(dest, src, n_elems * sizeof(value_type));
+                if (statistics) {
+                    for (size_t i = 0; i < n_elems; ++i) {
+                        statistics->add(load_aligned<value_type>(src + i));
+                    }
+                }
+            });
+}
+
+// Encodes a transformed hypercube like encode_hypercube or, with raw_fallback, stores the values of the hypercube at
+// hc_offset raw if encoding would not make it smaller. At level 0 this is decided from the zero-bit encoded length
+// without encoding. Returns the stored length in words and sets raw accordingly.
+template<typename Profile>
+index_type encode_or_write_raw_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        const typename Profile::bits_type *cube, typename Profile::bits_type *dest, int level,
+        typename Profile::bits_type *scratch, bool raw_fallback, bool &raw) {
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+
+    raw = false;
+    if (!raw_fallback || (level == 0 && zero_bit_encoded_length(cube, hc_size) < hc_size)) {
+        return encode_hypercube<Profile>(cube, dest, level, scratch);
+    }
+    if (level > 0) {
+        const auto length = encode_hypercube<Profile>(cube, dest, level, scratch);
+        if (length < hc_size) { return length; }
+    }
+    write_raw_hypercube<Profile>(hc_offset, data, data_size, dest);
+    raw = true;
+    return hc_size;
+}
+
+
+// Reads the preamble of a stream that is expected to make use of the optional features in expected_flags
+template<typename Bits>
+preamble read_stream_preamble(const Bits *raw_stream, uint32_t expected_flags) {
+    if (expected_flags == 0) { return preamble{}; }
+    const auto preamble = read_preamble(raw_stream);
+    if ((preamble.flags ^ expected_flags) & preamble::reference_residual) {
+        throw std::runtime_error{expected_flags & preamble::reference_residual
+                        ? "stream was not compressed against a reference"
+                        : "stream was compressed against a reference"};
+    }
+    if (preamble.flags != expected_flags) {
+        throw std::runtime_error{"stream was compressed with different stream options"};
+    }
+    return preamble;
+}
+
+// Zeroes the per-hypercube tables following the preamble including their padding, entries are filled in as
+// hypercubes are encoded
+template<typename Bits>
+void clear_hypercube_tables(const preamble &preamble, Bits *raw_stream, index_type num_hypercubes) {
+    const auto begin = preamble_length<Bits>(preamble);
+    memset(raw_stream + begin, 0, (stream_prefix_length<Bits>(preamble, num_hypercubes) - begin) * sizeof(Bits));
+}
+
+inline void validate_predictor_table(const uint8_t *selectors, index_type num_hypercubes, dim_type dims) {
+    if (!selectors) { return; }
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+        if (!is_valid_predictor(selectors[hc_index], dims)) {
+            throw std::runtime_error{"stream contains an invalid predictor selector"};
+        }
+    }
+}
+
+// Applies the stream's prediction scheme to a loaded hypercube. With a predictor table, the predictor is selected
+// per hypercube and recorded in the table, otherwise the Lorenzo block transform is used.
+template<typename Profile>
+void forward_transform(typename Profile::bits_type *cube, index_type hc_index, uint8_t *selectors) {
+    if (selectors) {
+        const auto p = select_predictor<Profile>(cube);
+        selectors[hc_index] = static_cast<uint8_t>(p);
+        predict<Profile>(cube, p);
+    } else {
+        block_transform<Profile>(cube);
+    }
+}
+
+// Selectors must have been checked with validate_predictor_table()
+template<typename Profile>
+void inverse_transform(typename Profile::bits_type *cube, index_type hc_index, const uint8_t *selectors) {
+    if (selectors) {
+        inverse_predict<Profile>(cube, static_cast<predictor>(selectors[hc_index]));
+    } else {
+        inverse_block_transform<Profile>(cube);
+    }
+}
+
+// Loads a hypercube for encoding. Error-bounded streams hold quantization bins unless some value of the hypercube
+// cannot be quantized within the bound, in which case it is loaded verbatim and marked in the verbatim table.
+// Streams with truncated mantissas round away dropped_mantissa_bits from each value. If `summary` is given, it receives
+// the sum and bounds of the original values.
+template<typename Profile>
+void load_stream_hypercube(const static_extent<Profile::dimensions> &hc_offset, index_type hc_index,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *cube, unsigned dropped_mantissa_bits,
+        const std::optional<quantizer<typename Profile::value_type>> &quantizer, uint8_t *verbatim,
+        hypercube_summary<typename Profile::value_type> *summary = nullptr) {
+    if (quantizer) {
+        const bool quantized
+                = load_quantized_hypercube<Profile>(hc_offset, data, data_size, cube, *quantizer, summary);
+        verbatim[hc_index] = !quantized;
+        if (quantized) { return; }
+        summary = nullptr;  // already complete, quantization does not stop at the first value out of bounds
+    }
+    if (dropped_mantissa_bits > 0) {
+        load_truncated_hypercube<Profile>(hc_offset, data, data_size, cube, dropped_mantissa_bits, summary);
+    } else {
+        load_hypercube<Profile>(hc_offset, data, data_size, cube, summary);
+    }
+}
+
+template<typename Profile>
+void store_stream_hypercube(const static_extent<Profile::dimensions> &hc_offset, index_type hc_index,
+        const typename Profile::bits_type *cube, typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, unsigned dropped_mantissa_bits,
+        const std::optional<quantizer<typename Profile::value_type>> &quantizer, const uint8_t *verbatim,
+        statistics_accumulator *statistics = nullptr) {
+    if (quantizer && !verbatim[hc_index]) {
+        store_dequantized_hypercube<Profile>(hc_offset, cube, data, data_size, *quantizer, statistics);
+    } else if (dropped_mantissa_bits > 0) {
+        store_truncated_hypercube<Profile>(hc_offset, cube, data, data_size, dropped_mantissa_bits, statistics);
+    } else {
+        store_hypercube<Profile>(hc_offset, cube, data, data_size, statistics);
+    }
+}
+
+// With cross-hypercube prediction, hypercubes form chains of up to chain_length hypercubes along the innermost
+// dimension, and all but the first hypercube of every chain are predicted from their predecessor
+template<typename Profile>
+bool predicts_leading_face(const static_extent<Profile::dimensions> &hc_offset, const preamble &preamble) {
+    return (preamble.flags & preamble::cross_prediction)
+            && hc_offset[Profile::dimensions - 1] / Profile::hypercube_side_length % preamble.chain_length != 0;
+}
+
+// Number of hypercubes following hc_index that are predicted from it directly or indirectly
+template<typename Profile>
+index_type chain_successors(index_type hc_index, const static_extent<Profile::dimensions> &data_size,
+        const preamble &preamble) {
+    if (!(preamble.flags & preamble::cross_prediction)) { return 0; }
+    const auto row_hypercubes = data_size[Profile::dimensions - 1] / Profile::hypercube_side_length;
+    const auto position_in_row = hc_index % row_hypercubes;
+    const auto chain_end
+            = std::min(row_hypercubes, (position_in_row / preamble.chain_length + 1) * preamble.chain_length);
+    return chain_end - position_in_row - 1;
+}
+
+// Lorenzo-predicts the values preceding every row of the hypercube at hc_offset, which belong to its predecessor in the
+// chain, across the leading face. This is the term the block transform would subtract from the first value of every
+// row if it extended its innermost delta into the predecessor.
+template<typename Profile>
+void predecessor_face_residuals(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *face) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto face_size = ipow(side_length, dims - 1);
+
+    const auto tile_size = static_extent<dims>::broadcast(side_length);
+    for (index_type i = 0; i < face_size; ++i) {
+        const auto row = data + linear_index(data_size, hc_offset + extent_from_linear_id(i * side_length, tile_size));
+        face[i] = rotate_left_1(load_unaligned<bits_type>(row - 1));
+    }
+    // Deltas along all outer axes, in reverse so that every difference is taken against the unmodified neighbor
+    for (index_type stride = 1; stride < face_size; stride *= side_length) {
+        for (index_type i = face_size; i-- > 0;) {
+            if (i / stride % side_length != 0) { face[i] -= face[i - stride]; }
+        }
+    }
+}
+
+// Continues the innermost delta of the block transform across the leading face of a transformed hypercube, so that
+// the first value of every row is predicted from the predecessor instead of being left as a face residual
+template<typename Profile>
+void subtract_leading_face(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *cube) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto face_size = ipow(side_length, Profile::dimensions - 1);
+
+    bits_type face[face_size];
+    predecessor_face_residuals<Profile>(hc_offset, data, data_size, face);
+    for (index_type i = 0; i < face_size; ++i) {
+        auto &first = cube[i * side_length];
+        first = complement_negative(static_cast<bits_type>(complement_negative(first) - face[i]));
+    }
+}
+
+// Inverse of subtract_leading_face, applied before the inverse block transform. Requires the predecessor to be stored
+// in data already.
+template<typename Profile>
+void add_leading_face(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *cube) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto face_size = ipow(side_length, Profile::dimensions - 1);
+
+    bits_type face[face_size];
+    predecessor_face_residuals<Profile>(hc_offset, data, data_size, face);
+    for (index_type i = 0; i < face_size; ++i) {
+        auto &first = cube[i * side_length];
+        first = complement_negative(static_cast<bits_type>(complement_negative(first) + face[i]));
+    }
+}
+
+inline void check_reference_fingerprint(const preamble &preamble, uint64_t fingerprint) {
+    if (fingerprint != preamble.reference_fingerprint) {
+        throw std::runtime_error{"reference does not match the array the stream was compressed against"};
+    }
+}
+
+// A contiguous range of untouched hypercubes (and possibly the border) that moves from old_begin to new_begin during
+// an in-place stream update. Positions are in words relative to the first hypercube.
+struct stream_run {
+    index_type old_begin;
+    index_type new_begin;
+    index_type length;
+    unsigned wave = 0;
+};
+
+// Moving runs in-place is only safe if no run overwrites the source of another run that has not been moved yet.
+// Runs moving towards the stream start never interfere with runs moving towards the end and vice versa, so each
+// direction is ordered separately into waves of mutually independent moves.
+inline unsigned schedule_stream_runs(std::vector<stream_run> &runs) {
+    unsigned num_waves = 0;
+    for (size_t j = 0; j < runs.size(); ++j) {
+        auto &rj = runs[j];
+        if (rj.new_begin >= rj.old_begin) { continue; }
+        for (size_t i = j; i-- > 0 && runs[i].old_begin + runs[i].length > rj.new_begin;) {
+            if (runs[i].new_begin < runs[i].old_begin) { rj.wave = std::max(rj.wave, runs[i].wave + 1); }
+        }
+        num_waves = std::max(num_waves, rj.wave + 1);
+    }
+    const auto first_backward_wave = num_waves;
+    for (size_t j = runs.size(); j-- > 0;) {
+        auto &rj = runs[j];
+        if (rj.new_begin <= rj.old_begin) { continue; }
+        rj.wave = first_backward_wave;
+        for (size_t k = j + 1; k < runs.size() && runs[k].old_begin < rj.new_begin + rj.length; ++k) {
+            if (runs[k].new_begin > runs[k].old_begin) { rj.wave = std::max(rj.wave, runs[k].wave + 1); }
+        }
+        num_waves = std::max(num_waves, rj.wave + 1);
+    }
+    return num_waves;
+}
+
+inline void
+inclusive_scan_parallel(const index_type *in, index_type *out, index_type n, [[maybe_unused]] int num_threads) {
+#if NDZIP_OPENMP_SUPPORT
+    if (num_threads > 1) {
+        // Every thread sums up one contiguous chunk, then scans it again starting from the scanned chunk totals
+        std::vector<index_type> chunk_offsets(num_threads + 1);
+#pragma omp parallel num_threads(num_threads)
+        {
+            const auto tid = omp_get_thread_num();
+            const auto nt = omp_get_num_threads();
+            const auto chunk_begin = static_cast<index_type>(uint64_t{n} * tid / nt);
+            const auto chunk_end = static_cast<index_type>(uint64_t{n} * (tid + 1) / nt);
+
+            index_type sum = 0;
+            for (index_type i = chunk_begin; i < chunk_end; ++i) {
+                sum += in[i];
+            }
+            chunk_offsets[tid + 1] = sum;
+
+#pragma omp barrier
+#pragma omp single
+            for (int t = 0; t < nt; ++t) {
+                chunk_offsets[t + 1] += chunk_offsets[t];
+            }
+
+            sum = chunk_offsets[tid];
+            for (index_type i = chunk_begin; i < chunk_end; ++i) {
+                out[i] = sum += in[i];
+            }
+        }
+        return;
+    }
+#endif
+    index_type sum = 0;
+    for (index_type i = 0; i < n; ++i) {
+        out[i] = sum += in[i];
+    }
+}
+
+// Loads a hypercube with the low `drop` bits of each value removed and the remaining magnitude bits shifted down,
+// leaving the sign bit in place so that values of opposite sign stay as far apart as before the reduction. Dropped
+// mantissa bits are rounded away, dropped exponent bits are truncated.
+template<typename Profile>
+void load_reduced_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *cube, unsigned drop) {
+    using value_type = typename Profile::value_type;
+    using bits_type = typename Profile::bits_type;
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+    constexpr auto sign_bit = bits_type{1} << (bits_of<bits_type> - 1);
+
+    if (drop == 0) {
+        load_hypercube<Profile>(hc_offset, data, data_size, cube);
+        return;
+    }
+    if (drop >= bits_of<bits_type>) {
+        memset(cube, 0, hc_size * sizeof(bits_type));
+        return;
+    }
+    if (drop < mantissa_bits<value_type>) {
+        load_truncated_hypercube<Profile>(hc_offset, data, data_size, cube, drop);
+    } else {
+        load_hypercube<Profile>(hc_offset, data, data_size, cube);
+        for (index_type i = 0; i < hc_size; ++i) {
+            cube[i] >>= drop;
+        }
+    }
+    const auto shifted_sign_bit = static_cast<bits_type>(sign_bit >> drop);
+    for (index_type i = 0; i < hc_size; ++i) {
+        cube[i] = static_cast<bits_type>((cube[i] << drop) & sign_bit) | (cube[i] & ~shifted_sign_bit);
+    }
+}
+
+// Inverse of load_reduced_hypercube for 0 < drop < bits, restores the magnitude bits of a hypercube in place
+template<typename Profile>
+void expand_reduced_hypercube(typename Profile::bits_type *cube, unsigned drop) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+    constexpr auto sign_bit = bits_type{1} << (bits_of<bits_type> - 1);
+
+    for (index_type i = 0; i < hc_size; ++i) {
+        cube[i] = (cube[i] & sign_bit) | static_cast<bits_type>((cube[i] & ~sign_bit) << drop);
+    }
+}
+
+// Number of further low-order bits to drop from every value of a hypercube whose zero-bit encoding, with the chunk
+// heads at `heads`, exceeds budget words. Reduction keeps the sign bits, which the transform rotates into the lowest
+// plane, and narrows the residuals by as many bits, so each chunk loses the planes right above it. Returns the width
+// of Bits if no drop short of all bits fits.
+template<typename Bits>
+unsigned fixed_rate_further_drop(const Bits *heads, index_type num_chunks, index_type budget) {
+    constexpr auto sign_plane = bits_of<Bits> - 1;
+
+    // Number of chunks with a non-zero word in the plane of each bit position
+    index_type plane_words[bits_of<Bits>] = {};
+    for (index_type chunk = 0; chunk < num_chunks; ++chunk) {
+        for (unsigned plane = 0; plane < bits_of<Bits>; ++plane) {
+            plane_words[plane] += (heads[chunk] >> plane) & Bits{1};
+        }
+    }
+    index_type length = num_chunks;
+    for (unsigned plane = 0; plane < bits_of<Bits>; ++plane) {
+        length += plane_words[plane];
+    }
+    // Rounding the reduced values adds noise of a few units to their residuals, which is assumed to fill all empty
+    // words of the lowest plane above the sign plane and half of those of the next one. Residuals of values reduced to
+    // their sign bits reach into these planes as well.
+    for (unsigned drop = 1; drop <= sign_plane; ++drop) {
+        if (drop < sign_plane) { length -= plane_words[drop]; }
+        auto predicted_length = length;
+        for (unsigned plane = drop + 1; plane <= drop + 2; ++plane) {
+            predicted_length += (num_chunks - (plane < sign_plane ? plane_words[plane] : 0)) >> (plane - drop - 1);
+        }
+        if (predicted_length <= budget) { return drop; }
+    }
+    return bits_of<Bits>;
+}
+
+// Encodes a hypercube into a fixed-rate slot, dropping just enough low-order bits from every value to fit the
+// zero-bit encoding behind the slot's leading word, which records the number of dropped bits. `summary`, if given,
+// receives the sum and bounds of the original values.
+template<typename Profile>
+void encode_fixed_rate_hypercube(const static_extent<Profile::dimensions> &hc_offset, index_type hc_index,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        uint8_t *selectors, typename Profile::bits_type *cube, typename Profile::bits_type *slot,
+        index_type slot_length, typename Profile::bits_type *scratch,
+        hypercube_summary<typename Profile::value_type> *summary = nullptr) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+    constexpr auto num_chunks = static_cast<index_type>(hc_size / bits_of<bits_type>);
+
+    // Dropping all bits leaves only the chunk heads, which fit into any slot of at least two words per chunk
+    const auto budget = slot_length - 1;
+    unsigned drop = 0;
+    index_type length;
+    for (;;) {
+        if (drop == 0) {
+            load_hypercube<Profile>(hc_offset, data, data_size, cube, std::exchange(summary, nullptr));
+        } else {
+            load_reduced_hypercube<Profile>(hc_offset, data, data_size, cube, drop);
+        }
+        forward_transform<Profile>(cube, hc_index, selectors);
+        length = static_cast<index_type>(
+                zero_bit_encode<bits_type>(cube, reinterpret_cast<std::byte *>(scratch), hc_size) / sizeof(bits_type));
+        if (length <= budget) { break; }
+        // The plane counts of the first encoding predict the required drop, so that one re-encoding usually fits.
+        // Rounding noise beyond the assumed amount can widen the reduced residuals past the prediction, in which case
+        // the counts of the re-encoding predict the remaining drop.
+        drop = std::min<unsigned>(drop + fixed_rate_further_drop(scratch, num_chunks, budget), bits_of<bits_type>);
+    }
+
+    slot[0] = drop;
+    memcpy(slot + 1, scratch, length * sizeof(bits_type));
+    memset(slot + 1 + length, 0, (budget - length) * sizeof(bits_type));
+}
+
+template<typename Profile>
+void decode_fixed_rate_hypercube(const static_extent<Profile::dimensions> &hc_offset, index_type hc_index,
+        const typename Profile::bits_type *slot, const uint8_t *selectors, typename Profile::bits_type *cube,
+        typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        statistics_accumulator *statistics = nullptr) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+
+    const auto drop = static_cast<unsigned>(slot[0]);
+    zero_bit_decode<bits_type>(reinterpret_cast<const std::byte *>(slot + 1), cube, hc_size);
+    inverse_transform<Profile>(cube, hc_index, selectors);
+    if (drop > 0 && drop < bits_of<bits_type>) { expand_reduced_hypercube<Profile>(cube, drop); }
+    store_hypercube<Profile>(hc_offset, cube, data, data_size, statistics);
+}
+
+template<typename Bits>
+void validate_fixed_rate_slots(const Bits *slots, index_type slot_length, index_type num_hypercubes) {
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+        if (slots[hc_index * slot_length] > bits_of<Bits>) {
+            throw std::runtime_error{"stream contains an invalid fixed-rate hypercube"};
+        }
+    }
+}
+
+// Summarizes a hypercube without loading it, for updates, which do not load clean hypercubes
+template<typename Profile>
+hypercube_summary<typename Profile::value_type> summarize_hypercube(
+        const static_extent<Profile::dimensions> &hc_offset, const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size) {
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, Profile::dimensions);
+
+    const auto tile_size = static_extent<Profile::dimensions>::broadcast(side_length);
+    hypercube_summary<typename Profile::value_type> summary;
+    for (index_type i = 0; i < hc_size; i += side_length) {
+        summary.add(data + linear_index(data_size, hc_offset + extent_from_linear_id(i, tile_size)), side_length);
+    }
+    return summary;
+}
+
+// Adds the border left by hypercubes of shape hc_shape to the per-thread accumulators (nullptr if statistics are
+// disabled) and merges them
+template<typename Profile>
+void finish_statistics(const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        std::vector<statistics_accumulator> *thread_statistics, array_statistics *statistics,
+        const static_extent<Profile::dimensions> &hc_shape
+        = static_extent<Profile::dimensions>::broadcast(Profile::hypercube_side_length)) {
+    if (!thread_statistics) { return; }
+
+    statistics_accumulator total;
+    for_each_border_slice(data_size, hc_shape,
+            [&](index_type offset, index_type count) { total.add(data + offset, count); });
+    for (auto &partial : *thread_statistics) {
+        total.merge(partial);
+    }
+
+    const auto num_counted = total.num_values - total.nan_count;
+    const auto undefined = std::numeric_limits<double>::quiet_NaN();
+    statistics->min = num_counted > 0 ? total.min : undefined;
+    statistics->max = num_counted > 0 ? total.max : undefined;
+    statistics->mean = num_counted > 0 ? total.sum / static_cast<double>(num_counted) : undefined;
+    statistics->l2_norm = num_counted > 0 ? std::sqrt(total.sum_of_squares) : undefined;
+    statistics->nan_count = total.nan_count;
+}
+
+// Records a hypercube in the side tables of hypercube means and bounds, which are nullptr if the stream has none
+template<typename Profile>
+void write_hypercube_index_entry(index_type hc_index, const hypercube_summary<typename Profile::value_type> &summary,
+        typename Profile::bits_type *means, typename Profile::bits_type *bounds) {
+    using value_type = typename Profile::value_type;
+    using bits_type = typename Profile::bits_type;
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+
+    if (means) { means[hc_index] = bit_cast<bits_type>(static_cast<value_type>(summary.sum / hc_size)); }
+    if (bounds) {
+        bounds[2 * hc_index] = bit_cast<bits_type>(summary.min);
+        bounds[2 * hc_index + 1] = bit_cast<bits_type>(summary.max);
+    }
+}
+
+// Compressors record every hypercube as they load it, duplicates share the entry of the hypercube they refer to
+template<typename Bits>
+void copy_duplicate_index_entries(const std::vector<index_type> &sources, Bits *means, Bits *bounds) {
+    for (index_type hc_index = 0; hc_index < sources.size(); ++hc_index) {
+        const auto source = sources[hc_index];
+        if (source == hc_index) { continue; }
+        if (means) { means[hc_index] = means[source]; }
+        if (bounds) {
+            bounds[2 * hc_index] = bounds[2 * source];
+            bounds[2 * hc_index + 1] = bounds[2 * source + 1];
+        }
+    }
+}
+
+#ifndef __SSE4_2__
+inline constexpr auto crc32c_table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = crc & 1u ? (crc >> 1u) ^ 0x82f63b78u : crc >> 1u;
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+#endif
+
+// CRC-32C (Castagnoli) of size bytes, eight bytes per instruction with SSE 4.2 and byte-wise from a table otherwise
+inline uint32_t crc32c(const void *data, size_t size, uint32_t seed) {
+    auto p = static_cast<const std::byte *>(data);
+    const auto end = p + size;
+    uint32_t crc = ~seed;
+#ifdef __SSE4_2__
+    uint64_t crc64 = crc;
+    for (; p + 8 <= end; p += 8) {
+        crc64 = _mm_crc32_u64(crc64, load_unaligned<uint64_t>(p));
+    }
+    crc = static_cast<uint32_t>(crc64);
+    for (; p < end; ++p) {
+        crc = _mm_crc32_u8(crc, static_cast<uint8_t>(*p));
+    }
+#else
+    for (; p < end; ++p) {
+        crc = crc32c_table[(crc ^ static_cast<uint32_t>(*p)) & 0xffu] ^ (crc >> 8u);
+    }
+#endif
+    return ~crc;
+}
+
+// 64-bit hash of the bits of a hypercube: the xxHash64 of its rows in one pass, without gathering them first
+template<typename Profile>
+uint64_t hash_hypercube(const static_extent<Profile::dimensions> &hc_offset, const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size) {
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, Profile::dimensions);
+    constexpr auto row_size = side_length * sizeof(typename Profile::value_type);
+    static_assert(row_size % xxhash64_state::stripe_size == 0);
+
+    const auto tile_size = static_extent<Profile::dimensions>::broadcast(side_length);
+    xxhash64_state state{0};
+    for (index_type i = 0; i < hc_size; i += side_length) {
+        state.add_stripes(data + linear_index(data_size, hc_offset + extent_from_linear_id(i, tile_size)), row_size);
+    }
+    return state.finish();
+}
+
+template<typename Profile>
+bool hypercubes_equal(const static_extent<Profile::dimensions> &left_offset,
+        const static_extent<Profile::dimensions> &right_offset, const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size) {
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, Profile::dimensions);
+
+    const auto tile_size = static_extent<Profile::dimensions>::broadcast(side_length);
+    for (index_type i = 0; i < hc_size; i += side_length) {
+        const auto row_offset = extent_from_linear_id(i, tile_size);
+        if (memcmp(data + linear_index(data_size, left_offset + row_offset),
+                    data + linear_index(data_size, right_offset + row_offset),
+                    side_length * sizeof(typename Profile::value_type))
+                != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Maps every hypercube to the first hypercube with bit-identical values, which is the hypercube itself unless it is
+// a duplicate. Hashes are computed in parallel and inserted into a lock-free open-addressing table that keeps the
+// lowest index of every group of identical hypercubes, so the result does not depend on the number of threads.
+template<typename Profile>
+std::vector<index_type> find_duplicate_hypercubes(const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &static_size, [[maybe_unused]] int num_threads) {
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto empty = ~index_type{};
+
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    const auto hc_offset = [&](index_type hc_index) {
+        return extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+    };
+    const auto same_hypercube = [&](index_type a, index_type b, const std::vector<uint64_t> &hashes) {
+        return hashes[a] == hashes[b] && hypercubes_equal<Profile>(hc_offset(a), hc_offset(b), data, static_size);
+    };
+
+    std::vector<uint64_t> hashes(num_hypercubes);
+    size_t capacity = 1;
+    while (capacity < 2 * size_t{num_hypercubes}) {
+        capacity *= 2;
+    }
+    const auto table = std::make_unique<std::atomic<index_type>[]>(capacity);
+
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel num_threads(num_threads)
+#endif
+    {
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp for schedule(static)
+#endif
+        for (size_t slot = 0; slot < capacity; ++slot) {
+            table[slot].store(empty, std::memory_order_relaxed);
+        }
+
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp for schedule(static)
+#endif
+        for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+            hashes[hc_index] = hash_hypercube<Profile>(hc_offset(hc_index), data, static_size);
+        }
+
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp for schedule(static)
+#endif
+        for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+            auto slot = hashes[hc_index] & (capacity - 1);
+            auto entry = table[slot].load(std::memory_order_relaxed);
+            for (;;) {
+                if (entry == empty) {
+                    // On failure, entry is reloaded and the slot examined again
+                    if (table[slot].compare_exchange_strong(entry, hc_index)) { break; }
+                } else if (same_hypercube(entry, hc_index, hashes)) {
+                    // Only identical hypercubes ever replace an occupied entry, so it suffices to keep the minimum
+                    while (hc_index < entry && !table[slot].compare_exchange_weak(entry, hc_index)) {}
+                    break;
+                } else {
+                    slot = (slot + 1) & (capacity - 1);
+                    entry = table[slot].load(std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    std::vector<index_type> sources(num_hypercubes);
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+        for (auto slot = hashes[hc_index] & (capacity - 1);; slot = (slot + 1) & (capacity - 1)) {
+            const auto entry = table[slot].load(std::memory_order_relaxed);
+            if (same_hypercube(entry, hc_index, hashes)) {
+                sources[hc_index] = entry;
+                break;
+            }
+        }
+    }
+    return sources;
+}
+
+// Index of the hypercube whose encoding a hypercube shares, which is the hypercube itself unless its offset is marked
+// as a back-reference
+template<typename Profile>
+index_type encoding_source(detail::stream<const Profile> &stream, index_type hc_index) {
+    if (!stream.is_back_reference(hc_index)) { return hc_index; }
+    const auto source = stream.hypercube_size(hc_index) == 1 ? *stream.hypercube(hc_index) : hc_index;
+    if (source >= hc_index || stream.is_back_reference(static_cast<index_type>(source))) {
+        throw std::runtime_error{"stream contains an invalid hypercube back-reference"};
+    }
+    return static_cast<index_type>(source);
+}
+
+// Checksum of the encoding of a hypercube, seeded with its index and header markers so that encodings at the wrong
+// position and flipped markers are detected as well
+template<typename Profile>
+uint32_t hypercube_checksum(const typename Profile::bits_type *encoding, index_type length, index_type hc_index,
+        bool raw, bool back_reference) {
+    const auto seed = hc_index << 2u | (raw ? 1u : 0u) | (back_reference ? 2u : 0u);
+    return crc32c(encoding, length * sizeof(typename Profile::bits_type), seed);
+}
+
+template<typename Bits>
+uint32_t border_checksum(const Bits *border, index_type length, index_type num_hypercubes) {
+    return crc32c(border, length * sizeof(Bits), num_hypercubes << 2u | 3u);
+}
+
+// Returns false if the encoding of a hypercube, or of the hypercube it is a duplicate of, does not match its checksum.
+// Encodings that no valid stream could hold are rejected before they are read.
+template<typename Profile>
+bool hypercube_intact(detail::stream<const Profile> &stream, const uint32_t *checksums, index_type hc_index) {
+    constexpr uint64_t max_hc_length = Profile::entropy_coded_block_length_bound;
+    const auto begin = hc_index == 0 ? 0 : stream.offset_after(hc_index - 1);
+    const auto length = stream.hypercube_size(hc_index);
+    if (begin > hc_index * max_hc_length || length > max_hc_length) { return false; }
+    const bool back_reference = stream.is_back_reference(hc_index);
+    if (hypercube_checksum<Profile>(stream.hypercube(hc_index), length, hc_index, stream.is_raw(hc_index),
+                back_reference)
+            != checksums[hc_index]) {
+        return false;
+    }
+    if (!back_reference) { return true; }
+    const auto source = length == 1 ? *stream.hypercube(hc_index) : hc_index;
+    return source < hc_index && !stream.is_back_reference(static_cast<index_type>(source))
+            && hypercube_intact(stream, checksums, static_cast<index_type>(source));
+}
+
+// Collects the hypercubes marked in corrupt (one byte per hypercube)
+inline std::vector<index_type> corrupt_hypercube_indices(const std::vector<uint8_t> &corrupt) {
+    std::vector<index_type> indices;
+    for (index_type hc_index = 0; hc_index < corrupt.size(); ++hc_index) {
+        if (corrupt[hc_index]) { indices.push_back(hc_index); }
+    }
+    return indices;
+}
+
+template<typename Profile>
+void copy_hypercube(const static_extent<Profile::dimensions> &source_offset,
+        const static_extent<Profile::dimensions> &dest_offset, typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, statistics_accumulator *statistics = nullptr) {
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, Profile::dimensions);
+
+    const auto tile_size = static_extent<Profile::dimensions>::broadcast(side_length);
+    for (index_type i = 0; i < hc_size; i += side_length) {
+        const auto row_offset = extent_from_linear_id(i, tile_size);
+        const auto source_row = data + linear_index(data_size, source_offset + row_offset);
+        memcpy(data + linear_index(data_size, dest_offset + row_offset), source_row,
+                side_length * sizeof(typename Profile::value_type));
+        if (statistics) { statistics->add(source_row, side_length); }
+    }
+}
+
+// Fixed-rate compression. Every hypercube has a known position in the stream, so threads encode them in any order
+// without coordination.
+template<typename Profile>
+index_type compress_fixed_rate(const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &static_size, const preamble &preamble,
+        typename Profile::bits_type *raw_stream, std::vector<cube_buffer<Profile>> &thread_cubes,
+        std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    constexpr auto side_length = Profile::hypercube_side_length;
+
+    [[maybe_unused]] const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    clear_hypercube_tables(preamble, raw_stream, num_hypercubes);
+    const auto means = means_table(preamble, raw_stream, num_hypercubes);
+    const auto bounds = bounds_table(preamble, raw_stream, num_hypercubes);
+    const auto selectors = predictor_table(preamble, raw_stream);
+    const auto slot_length = fixed_rate_slot_length<Profile>(preamble);
+    const auto slots = raw_stream + stream_prefix_length<typename Profile::bits_type>(preamble, num_hypercubes);
+
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+        hypercube_summary<typename Profile::value_type> summary;
+        encode_fixed_rate_hypercube<Profile>(hc_offset, hc_index, data, static_size, selectors,
+                thread_cubes[tid].data(), slots + hc_index * slot_length, slot_length, thread_scratch[tid].data(),
+                means || bounds ? &summary : nullptr);
+        write_hypercube_index_entry<Profile>(hc_index, summary, means, bounds);
+    }
+
+    const auto border = slots + num_hypercubes * slot_length;
+    const auto border_length = pack_border(border, data, static_size, side_length);
+    write_preamble(preamble, raw_stream);
+    return static_cast<index_type>(border - raw_stream) + border_length;
+}
+
+template<typename Profile>
+index_type decompress_fixed_rate(const typename Profile::bits_type *raw_stream, const preamble &preamble,
+        typename Profile::value_type *data, const static_extent<Profile::dimensions> &static_size,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<statistics_accumulator> *thread_statistics) {
+    constexpr auto side_length = Profile::hypercube_side_length;
+
+    [[maybe_unused]] const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    const auto selectors = predictor_table(preamble, raw_stream);
+    validate_predictor_table(selectors, num_hypercubes, Profile::dimensions);
+    const auto slot_length = fixed_rate_slot_length<Profile>(preamble);
+    const auto slots = raw_stream + stream_prefix_length<typename Profile::bits_type>(preamble, num_hypercubes);
+    validate_fixed_rate_slots(slots, slot_length, num_hypercubes);
+
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+        decode_fixed_rate_hypercube<Profile>(hc_offset, hc_index, slots + hc_index * slot_length, selectors,
+                thread_cubes[tid].data(), data, static_size, thread_statistics ? &(*thread_statistics)[tid] : nullptr);
+    }
+
+    const auto border = slots + num_hypercubes * slot_length;
+    const auto border_length = unpack_border(data, static_size, border, side_length);
+    return static_cast<index_type>(border - raw_stream) + border_length;
+}
+
+// Contiguous slices of the border with their positions in the packed border, grouped into chunks of about
+// chunk_length elements for (un)packing in parallel. Chunk c consists of slices begins[c] to begins[c + 1]. Slices are
+// split at chunk boundaries unless split is false, which keeps every slice whole for the per-slice fingerprints of
+// residual borders.
+struct border_chunks {
+    struct slice {
+        index_type data_offset;
+        index_type border_offset;
+        index_type count;
+    };
+
+    constexpr static index_type chunk_length = 16384;
+
+    std::vector<slice> slices;
+    std::vector<size_t> begins{0};
+    index_type length = 0;
+
+    size_t num_chunks() const { return begins.size() - 1; }
+};
+
+template<typename Profile>
+border_chunks make_border_chunks(const static_extent<Profile::dimensions> &data_size, bool split) {
+    constexpr auto chunk_length = border_chunks::chunk_length;
+
+    border_chunks chunks;
+    for_each_border_slice(data_size, Profile::hypercube_side_length, [&](index_type data_offset, index_type count) {
+        while (count > 0) {
+            const auto chunk = chunks.length / chunk_length;
+            while (chunks.begins.size() <= chunk) {
+                chunks.begins.push_back(chunks.slices.size());
+            }
+            const auto n = split ? std::min(count, (chunk + 1) * chunk_length - chunks.length) : count;
+            chunks.slices.push_back({data_offset, chunks.length, n});
+            data_offset += n;
+            chunks.length += n;
+            count -= n;
+        }
+    });
+    chunks.begins.push_back(chunks.slices.size());
+    return chunks;
+}
+
+// Packs chunk c of the border, or its residual to reference if not null. Returns the fingerprint of the reference.
+template<typename Profile>
+uint64_t pack_border_chunk(const border_chunks &chunks, size_t c, typename Profile::bits_type *border,
+        const typename Profile::value_type *data, const typename Profile::value_type *reference) {
+    using bits_type = typename Profile::bits_type;
+
+    uint64_t fingerprint = 0;
+    for (auto s = chunks.begins[c]; s < chunks.begins[c + 1]; ++s) {
+        const auto &slice = chunks.slices[s];
+        const auto src = data + slice.data_offset;
+        const auto dest = border + slice.border_offset;
+        if (reference) {
+            const auto ref = reference + slice.data_offset;
+            for (index_type i = 0; i < slice.count; ++i) {
+                dest[i] = load_unaligned<bits_type>(src + i) - load_unaligned<bits_type>(ref + i);
+            }
+            fingerprint ^= border_fingerprint(ref, slice.count, slice.data_offset);
+        } else {
+            memcpy(dest, src, slice.count * sizeof(bits_type));
+        }
+    }
+    return fingerprint;
+}
+
+// Inverse of pack_border_chunk
+template<typename Profile>
+uint64_t unpack_border_chunk(const border_chunks &chunks, size_t c, typename Profile::value_type *data,
+        const typename Profile::bits_type *border, const typename Profile::value_type *reference) {
+    using bits_type = typename Profile::bits_type;
+
+    uint64_t fingerprint = 0;
+    for (auto s = chunks.begins[c]; s < chunks.begins[c + 1]; ++s) {
+        const auto &slice = chunks.slices[s];
+        const auto src = border + slice.border_offset;
+        const auto dest = data + slice.data_offset;
+        if (reference) {
+            const auto ref = reference + slice.data_offset;
+            for (index_type i = 0; i < slice.count; ++i) {
+                store_unaligned(dest + i, static_cast<bits_type>(src[i] + load_unaligned<bits_type>(ref + i)));
+            }
+            fingerprint ^= border_fingerprint(ref, slice.count, slice.data_offset);
+        } else {
+            memcpy(dest, src, slice.count * sizeof(bits_type));
+        }
+    }
+    return fingerprint;
+}
+
+// Multi-threaded pack_border, or pack_border_residual if reference is not null
+template<typename Profile>
+index_type pack_border_parallel(typename Profile::bits_type *border, const typename Profile::value_type *data,
+        const typename Profile::value_type *reference, const static_extent<Profile::dimensions> &data_size,
+        int num_threads, uint64_t &fingerprint) {
+    const auto chunks = make_border_chunks<Profile>(data_size, reference == nullptr);
+    uint64_t border_hash = 0;
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic) reduction(^ : border_hash)
+#endif
+    for (size_t c = 0; c < chunks.num_chunks(); ++c) {
+        border_hash ^= pack_border_chunk<Profile>(chunks, c, border, data, reference);
+    }
+    fingerprint ^= border_hash;
+    return chunks.length;
+}
+
+// Multi-threaded unpack_border, or unpack_border_residual if reference is not null
+template<typename Profile>
+index_type unpack_border_parallel(typename Profile::value_type *data, const typename Profile::value_type *reference,
+        const static_extent<Profile::dimensions> &data_size, const typename Profile::bits_type *border,
+        int num_threads, uint64_t &fingerprint) {
+    const auto chunks = make_border_chunks<Profile>(data_size, reference == nullptr);
+    uint64_t border_hash = 0;
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic) reduction(^ : border_hash)
+#endif
+    for (size_t c = 0; c < chunks.num_chunks(); ++c) {
+        border_hash ^= unpack_border_chunk<Profile>(chunks, c, data, border, reference);
+    }
+    fingerprint ^= border_hash;
+    return chunks.length;
+}
+
+// pack_border on num_threads threads
+template<typename Profile>
+index_type pack_raw_border(typename Profile::bits_type *border, const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, int num_threads) {
+    if (num_threads == 1) { return pack_border(border, data, data_size, Profile::hypercube_side_length); }
+    uint64_t fingerprint = 0;
+    return pack_border_parallel<Profile>(border, data, nullptr, data_size, num_threads, fingerprint);
+}
+
+// unpack_border on num_threads threads
+template<typename Profile>
+index_type unpack_raw_border(typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        const typename Profile::bits_type *border, int num_threads) {
+    if (num_threads == 1) { return unpack_border(data, data_size, border, Profile::hypercube_side_length); }
+    uint64_t fingerprint = 0;
+    return unpack_border_parallel<Profile>(data, nullptr, data_size, border, num_threads, fingerprint);
+}
+
+// Progressive compression. The first pass writes all chunk heads, which fixes the position of every plane word, and
+// stages the non-zero plane words of each hypercube in order. The second pass scatters them from the staging area to
+// their sections without coordination.
+template<typename Profile>
+index_type compress_progressive(const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &static_size, const preamble &preamble,
+        typename Profile::bits_type *raw_stream, std::vector<cube_buffer<Profile>> &thread_cubes) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto num_planes = bits_of<bits_type>;
+    constexpr auto hc_size = ipow(side_length, dims);
+    constexpr auto chunks_per_hc = static_cast<index_type>(hc_size / num_planes);
+
+    const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    const auto layout = progressive_stream_layout<Profile>(preamble, static_size);
+    const auto heads = raw_stream + layout.heads;
+
+    // Number of non-zero words per hypercube and plane, turned into their stream positions by the prefix sum below
+    std::vector<index_type> positions(num_hypercubes * num_planes);
+    // The plane words of hypercube i start at staged[i * hc_size], in the order of their chunks
+    simd_aligned_buffer<bits_type> staged(size_t{num_hypercubes} * hc_size);
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        const auto cube = thread_cubes[tid].data();
+        const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+        load_hypercube<Profile>(hc_offset, data, static_size, cube);
+        xor_lorenzo_transform(cube, dims, side_length);
+        auto stage = staged.data() + size_t{hc_index} * hc_size;
+        for (index_type chunk = 0; chunk < chunks_per_hc; ++chunk) {
+            const auto head = generate_zero_map(cube + chunk * num_planes);
+            heads[hc_index * chunks_per_hc + chunk] = head;
+            if (head == 0) { continue; }
+            alignas(simd_width_bytes) bits_type transposed[num_planes];
+            transpose_bits(cube + chunk * num_planes, transposed);
+            for (index_type plane = 0; plane < num_planes; ++plane) {
+                if ((head >> (num_planes - 1 - plane)) & bits_type{1}) {
+                    ++positions[hc_index * num_planes + plane];
+                    *stage++ = transposed[plane];
+                }
+            }
+        }
+    }
+
+    auto offset = layout.planes;
+    for (index_type plane = 0; plane < num_planes; ++plane) {
+        for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+            offset += std::exchange(positions[hc_index * num_planes + plane], offset);
+        }
+        raw_stream[layout.plane_table + plane] = offset;
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+        const auto position = positions.data() + hc_index * num_planes;
+        auto stage = staged.data() + size_t{hc_index} * hc_size;
+        for (index_type chunk = 0; chunk < chunks_per_hc; ++chunk) {
+            const auto head = heads[hc_index * chunks_per_hc + chunk];
+            if (head == 0) { continue; }
+            for (index_type plane = 0; plane < num_planes; ++plane) {
+                if ((head >> (num_planes - 1 - plane)) & bits_type{1}) { raw_stream[position[plane]++] = *stage++; }
+            }
+        }
+    }
+
+    pack_raw_border<Profile>(raw_stream + layout.border, data, static_size, num_threads);
+    write_preamble(preamble, raw_stream);
+    return offset;
+}
+
+// Decodes the num_planes most significant bit planes of a progressive stream, reading only the stream up to the end
+// of the last of these planes
+template<typename Profile>
+index_type decompress_progressive(const typename Profile::bits_type *raw_stream, const preamble &preamble,
+        unsigned num_planes, typename Profile::value_type *data, const static_extent<Profile::dimensions> &static_size,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<statistics_accumulator> *thread_statistics) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto max_planes = bits_of<bits_type>;
+    constexpr auto chunks_per_hc = static_cast<index_type>(ipow(side_length, dims) / max_planes);
+
+    const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    const auto layout = progressive_stream_layout<Profile>(preamble, static_size);
+    validate_plane_table(raw_stream, layout);
+    const auto heads = raw_stream + layout.heads;
+    const auto plane_mask = num_planes < max_planes ? ~(~bits_type{} >> num_planes) : ~bits_type{};
+
+    std::vector<index_type> positions(num_hypercubes * num_planes);
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+        for (index_type chunk = 0; chunk < chunks_per_hc; ++chunk) {
+            const auto head = heads[hc_index * chunks_per_hc + chunk];
+            for (index_type plane = 0; plane < num_planes; ++plane) {
+                positions[hc_index * num_planes + plane] += (head >> (max_planes - 1 - plane)) & bits_type{1};
+            }
+        }
+    }
+
+    auto offset = layout.planes;
+    for (index_type plane = 0; plane < num_planes; ++plane) {
+        for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+            offset += std::exchange(positions[hc_index * num_planes + plane], offset);
+        }
+        if (offset != raw_stream[layout.plane_table + plane]) {
+            throw std::runtime_error{"stream contains an invalid bit plane table"};
+        }
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        const auto cube = thread_cubes[tid].data();
+        const auto position = positions.data() + hc_index * num_planes;
+        for (index_type chunk = 0; chunk < chunks_per_hc; ++chunk) {
+            const auto head = heads[hc_index * chunks_per_hc + chunk] & plane_mask;
+            const auto chunk_words = cube + chunk * max_planes;
+            if (head == 0) {
+                memset(chunk_words, 0, max_planes * sizeof(bits_type));
+                continue;
+            }
+            alignas(simd_width_bytes) bits_type transposed[max_planes];
+            for (index_type plane = 0; plane < max_planes; ++plane) {
+                transposed[plane] = (head >> (max_planes - 1 - plane)) & bits_type{1} ? raw_stream[position[plane]++]
+                                                                                       : bits_type{0};
+            }
+            transpose_bits(transposed, chunk_words);
+        }
+        inverse_xor_lorenzo_transform(cube, dims, side_length);
+        const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+        store_hypercube<Profile>(
+                hc_offset, cube, data, static_size, thread_statistics ? &(*thread_statistics)[tid] : nullptr);
+    }
+
+    unpack_raw_border<Profile>(data, static_size, raw_stream + layout.border, num_threads);
+    return num_planes > 0 ? static_cast<index_type>(raw_stream[layout.plane_table + num_planes - 1]) : layout.planes;
+}
+
+template<typename Profile>
+index_type decompress_planes(const typename Profile::bits_type *raw_stream, unsigned num_planes,
+        typename Profile::value_type *data, const extent &data_size, const stream_options &options,
+        std::vector<cube_buffer<Profile>> &thread_cubes) {
+    if (data_size.dimensions() != Profile::dimensions) {
+        throw std::runtime_error{"data dimensionality does not match decompressor dimensionality"};
+    }
+    if (!options.progressive) {
+        throw std::invalid_argument{"decompressing bit planes requires a decompressor for progressive streams"};
+    }
+    if (num_planes > bits_of<typename Profile::bits_type>) {
+        throw std::invalid_argument{"number of bit planes exceeds the width of the value type"};
+    }
+    const auto preamble = read_stream_preamble(raw_stream, preamble_flags(options, false));
+    return decompress_progressive<Profile>(raw_stream, preamble, num_planes, data,
+            static_extent<Profile::dimensions>{data_size}, thread_cubes, nullptr);
+}
+
+// Offsets that reach the marker bits of the offset header would be read back as markers, see header_marker_bits
+inline void check_stream_offset(uint64_t position, index_type max_offset) {
+    if (position > max_offset) {
+        throw std::length_error{"compressed stream exceeds the length addressable by its offset header"};
+    }
+}
+
+// Appends the encodings of num_tasks groups of task_length consecutive hypercubes to a stream in order. Stream
+// positions are only known after encoding, so encode_task(task, tid, dest, lengths) encodes all hypercubes of a task
+// out-of-place, the i-th one to dest + i * entropy_coded_block_length_bound, in batches of a few tasks per thread.
+// Returns false without writing the remaining hypercubes once their encodings exceed max_length words.
+template<typename Profile, typename EncodeTask>
+bool write_hypercubes_batched(detail::stream<Profile> &stream, index_type num_tasks, index_type task_length,
+        int num_threads, const EncodeTask &encode_task, index_type max_length = UINT32_MAX) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto max_hc_length = Profile::entropy_coded_block_length_bound;
+    constexpr index_type tasks_per_thread = 8;
+
+    const auto batch_size = static_cast<index_type>(num_threads) * tasks_per_thread;
+    std::vector<bits_type> encoded(size_t{batch_size} * task_length * max_hc_length);
+    std::vector<index_type> encoded_lengths(batch_size * task_length);
+    uint64_t offset = 0;
+    for (index_type first_task = 0; first_task < num_tasks; first_task += batch_size) {
+        const auto end_task = std::min(num_tasks, first_task + batch_size);
+        const auto first_hc = first_task * task_length;
+        const auto end_hc = end_task * task_length;
+
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+#endif
+        for (index_type task = first_task; task < end_task; ++task) {
+#if NDZIP_OPENMP_SUPPORT
+            const auto tid = omp_get_thread_num();
+#else
+            const auto tid = 0;
+#endif
+            const auto batch_hc = (task - first_task) * task_length;
+            encode_task(task, tid, encoded.data() + size_t{batch_hc} * max_hc_length,
+                    encoded_lengths.data() + batch_hc);
+        }
+
+        for (index_type hc_index = first_hc; hc_index < end_hc; ++hc_index) {
+            offset += encoded_lengths[hc_index - first_hc];
+            check_stream_offset(offset, stream.max_offset());
+            stream.set_offset_after(hc_index, static_cast<index_type>(offset));
+        }
+        if (offset > max_length) { return false; }
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+        for (index_type hc_index = first_hc; hc_index < end_hc; ++hc_index) {
+            memcpy(stream.hypercube(hc_index), encoded.data() + size_t{hc_index - first_hc} * max_hc_length,
+                    encoded_lengths[hc_index - first_hc] * sizeof(bits_type));
+        }
+    }
+    return true;
+}
+
+// Streams with preamble::padded_border begin their border with one of these words
+enum border_encoding : uint32_t {
+    raw_border = 0,        // followed by the pack_border encoding
+    padded_hypercubes = 1  // followed by an offset header and the encodings of all partial hypercubes
+};
+
+// Offsets of the hypercubes that overlap the end of the array along some dimension, in linear order
+template<typename Profile>
+std::vector<static_extent<Profile::dimensions>> partial_hypercube_offsets(
+        const static_extent<Profile::dimensions> &data_size) {
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+
+    static_extent<dims> padded_grid;
+    for (dim_type d = 0; d < dims; ++d) {
+        padded_grid[d] = div_ceil(data_size[d], side_length);
+    }
+    std::vector<static_extent<dims>> offsets;
+    for (index_type i = 0; i < num_elements(padded_grid); ++i) {
+        const auto hc_offset = extent_from_linear_id(i, padded_grid) * side_length;
+        bool partial = false;
+        for (dim_type d = 0; d < dims; ++d) {
+            partial |= hc_offset[d] + side_length > data_size[d];
+        }
+        if (partial) { offsets.push_back(hc_offset); }
+    }
+    return offsets;
+}
+
+// Loads a hypercube that extends past the end of the array, replicating the last element along every dimension. The
+// Lorenzo transform turns the padding into zero residuals, so it costs little more than a zero chunk head.
+template<typename Profile>
+void load_padded_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *cube) {
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, dims);
+
+    const auto tile_size = static_extent<dims>::broadcast(side_length);
+    const auto row_length = std::min(side_length, data_size[dims - 1] - hc_offset[dims - 1]);
+    for (index_type row = 0; row < hc_size / side_length; ++row) {
+        auto pos = hc_offset + extent_from_linear_id(row * side_length, tile_size);
+        for (dim_type d = 0; d + 1 < dims; ++d) {
+            pos[d] = std::min(pos[d], data_size[d] - 1);
+        }
+        const auto dest = cube + row * side_length;
+        memcpy(dest, data + linear_index(data_size, pos), row_length * sizeof(typename Profile::value_type));
+        std::fill(dest + row_length, dest + side_length, dest[row_length - 1]);
+    }
+}
+
+// Stores the part of a decoded hypercube that lies inside the array
+template<typename Profile>
+void store_partial_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::bits_type *cube, typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size) {
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, dims);
+
+    const auto tile_size = static_extent<dims>::broadcast(side_length);
+    const auto row_length = std::min(side_length, data_size[dims - 1] - hc_offset[dims - 1]);
+    for (index_type row = 0; row < hc_size / side_length; ++row) {
+        const auto pos = hc_offset + extent_from_linear_id(row * side_length, tile_size);
+        bool inside = true;
+        for (dim_type d = 0; d + 1 < dims; ++d) {
+            inside &= pos[d] < data_size[d];
+        }
+        if (inside) {
+            memcpy(data + linear_index(data_size, pos), cube + row * side_length,
+                    row_length * sizeof(typename Profile::value_type));
+        }
+    }
+}
+
+// Encodes the border as edge-padded partial hypercubes through the parallel hypercube pipeline, or stores it raw if
+// that is not larger, as for tiny arrays. Returns the border length in words, at most one more than pack_border's.
+template<typename Profile>
+index_type pack_padded_border(typename Profile::bits_type *border, const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, int level, std::vector<cube_buffer<Profile>> &thread_cubes,
+        std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto side_length = Profile::hypercube_side_length;
+
+    const auto offsets = partial_hypercube_offsets<Profile>(data_size);
+    const auto num_partials = static_cast<index_type>(offsets.size());
+    const auto raw_length = border_element_count(data_size, side_length);
+    detail::stream<Profile> partials{num_partials, border + 1};
+    const auto header_length = static_cast<index_type>(partials.hypercube(0) - partials.buffer);
+
+    const auto encode_task = [&](index_type i, int tid, bits_type *dest, index_type *lengths) {
+        const auto cube = thread_cubes[tid].data();
+        load_padded_hypercube<Profile>(offsets[i], data, data_size, cube);
+        block_transform<Profile>(cube);
+        lengths[0] = encode_hypercube<Profile>(cube, dest, level, thread_scratch[tid].data());
+    };
+    if (num_partials > 0 && header_length < raw_length
+            && write_hypercubes_batched(partials, num_partials, 1, static_cast<int>(thread_cubes.size()), encode_task,
+                    raw_length - header_length - 1)) {
+        border[0] = padded_hypercubes;
+        return static_cast<index_type>(partials.border() - border);
+    }
+    border[0] = raw_border;
+    return 1 + pack_raw_border<Profile>(border + 1, data, data_size, static_cast<int>(thread_cubes.size()));
+}
+
+// Decodes partial hypercube i of a padded border into cube
+template<typename Profile>
+void decode_partial_hypercube(detail::stream<const Profile> &partials, index_type i,
+        typename Profile::bits_type *cube, bool entropy_coded, encoding_buffer<Profile> &scratch) {
+    decode_hypercube<Profile>(partials.hypercube(i), partials.hypercube_size(i), cube, entropy_coded, scratch);
+    inverse_block_transform<Profile>(cube);
+}
+
+// Inverse of pack_padded_border. Returns the border length in words.
+template<typename Profile>
+index_type unpack_padded_border(typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, const typename Profile::bits_type *border,
+        bool entropy_coded, std::vector<cube_buffer<Profile>> &thread_cubes,
+        std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    [[maybe_unused]] const auto num_threads = static_cast<int>(thread_cubes.size());
+    if (border[0] == raw_border) { return 1 + unpack_raw_border<Profile>(data, data_size, border + 1, num_threads); }
+    if (border[0] != padded_hypercubes) { throw std::runtime_error{"stream contains an invalid border encoding"}; }
+
+    const auto offsets = partial_hypercube_offsets<Profile>(data_size);
+    const auto num_partials = static_cast<index_type>(offsets.size());
+    detail::stream<const Profile> partials{num_partials, border + 1};
+    std::exception_ptr exception;
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+#endif
+    for (index_type i = 0; i < num_partials; ++i) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        // exceptions must not escape the parallel region
+        try {
+            auto stream = partials;  // accessors are not const
+            decode_partial_hypercube<Profile>(
+                    stream, i, thread_cubes[tid].data(), entropy_coded, thread_scratch[tid]);
+            store_partial_hypercube<Profile>(offsets[i], thread_cubes[tid].data(), data, data_size);
+        } catch (...) {
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp critical(exception)
+#endif
+            if (!exception) { exception = std::current_exception(); }
+        }
+    }
+    if (exception) { std::rethrow_exception(exception); }
+    return static_cast<index_type>(partials.border() - border);
+}
+
+// Length of a border in words, as returned by pack_padded_border
+template<typename Profile>
+index_type padded_border_length(
+        const typename Profile::bits_type *border, const static_extent<Profile::dimensions> &data_size) {
+    if (border[0] == raw_border) { return 1 + border_element_count(data_size, Profile::hypercube_side_length); }
+    const auto num_partials = static_cast<index_type>(partial_hypercube_offsets<Profile>(data_size).size());
+    detail::stream<const Profile> partials{num_partials, border + 1};
+    return static_cast<index_type>(partials.border() - border);
+}
+
+// Returns false if the border does not match its checksum, without reading past the largest possible border
+template<typename Profile>
+bool border_intact(const preamble &preamble, detail::stream<const Profile> &stream, const uint32_t *checksums,
+        const static_extent<Profile::dimensions> &data_size) {
+    constexpr uint64_t max_hc_length = Profile::entropy_coded_block_length_bound;
+    const auto num_hypercubes = stream.num_hypercubes;
+    if (num_hypercubes > 0 && stream.offset_after(num_hypercubes - 1) > num_hypercubes * max_hc_length) {
+        return false;
+    }
+    const auto raw_length = border_element_count(data_size, Profile::hypercube_side_length);
+    auto length = raw_length;
+    if (preamble.flags & preamble::padded_border) {
+        length = padded_border_length<Profile>(stream.border(), data_size);
+        if (length > raw_length + 1) { return false; }
+    }
+    return border_checksum(stream.border(), length, num_hypercubes) == checksums[num_hypercubes];
+}
+
+// Border (un)packing for the stream layouts that support preamble::padded_border, on one thread per cube buffer
+template<typename Profile>
+index_type pack_stream_border(const preamble &preamble, typename Profile::bits_type *border,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size, int level,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    if (preamble.flags & preamble::padded_border) {
+        return pack_padded_border<Profile>(border, data, data_size, level, thread_cubes, thread_scratch);
+    }
+    return pack_raw_border<Profile>(border, data, data_size, static_cast<int>(thread_cubes.size()));
+}
+
+template<typename Profile>
+index_type unpack_stream_border(const preamble &preamble, typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, const typename Profile::bits_type *border,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    if (preamble.flags & preamble::padded_border) {
+        const bool entropy_coded = preamble.flags & preamble::entropy_coded;
+        return unpack_padded_border<Profile>(data, data_size, border, entropy_coded, thread_cubes, thread_scratch);
+    }
+    return unpack_raw_border<Profile>(data, data_size, border, static_cast<int>(thread_cubes.size()));
+}
+
+// Random access to the hypercubes of a stream with an offset header or fixed-rate slots, used by the decoders that
+// only need some of the hypercubes or do not write them to the full-resolution array
+template<typename Profile>
+class hypercube_reader {
+  public:
+    using value_type = typename Profile::value_type;
+    using bits_type = typename Profile::bits_type;
+    constexpr static auto dimensions = Profile::dimensions;
+
+    hypercube_reader(const bits_type *raw_stream, const preamble &preamble, index_type num_hypercubes)
+        : _selectors{predictor_table(preamble, raw_stream)}
+        , _dropped_bits{dropped_mantissa_bits<value_type>(preamble)}
+        , _quantizer{stream_quantizer<value_type>(preamble)}
+        , _verbatim{verbatim_table(preamble, raw_stream, num_hypercubes)}
+        , _entropy_coded{(preamble.flags & preamble::entropy_coded) != 0}
+        , _slot_length{preamble.flags & preamble::fixed_rate ? fixed_rate_slot_length<Profile>(preamble) : 0}
+        , _stream{num_hypercubes, raw_stream + stream_prefix_length<bits_type>(preamble, num_hypercubes),
+                  header_marker_bits(preamble)} {
+        validate_predictor_table(_selectors, num_hypercubes, dimensions);
+        if (_slot_length > 0) {
+            validate_fixed_rate_slots(_stream.buffer, _slot_length, num_hypercubes);
+            _border = _stream.buffer + num_hypercubes * _slot_length;
+        } else {
+            _border = _stream.border();
+        }
+    }
+
+    const bits_type *border() const { return _border; }
+
+    // Decodes a hypercube into data at hc_offset. Throws if the hypercube is corrupt.
+    void decode(index_type hc_index, const static_extent<dimensions> &hc_offset, value_type *data,
+            const static_extent<dimensions> &data_size, bits_type *cube, encoding_buffer<Profile> &scratch) const {
+        if (_slot_length > 0) {
+            decode_fixed_rate_hypercube<Profile>(
+                    hc_offset, hc_index, _stream.buffer + hc_index * _slot_length, _selectors, cube, data, data_size);
+        } else {
+            auto stream = _stream;  // accessors are not const
+            const auto source = encoding_source(stream, hc_index);
+            if (stream.is_raw(source)) {
+                read_raw_hypercube<Profile>(
+                        hc_offset, stream.hypercube(source), stream.hypercube_size(source), data, data_size);
+                return;
+            }
+            decode_hypercube<Profile>(
+                    stream.hypercube(source), stream.hypercube_size(source), cube, _entropy_coded, scratch);
+            inverse_transform<Profile>(cube, source, _selectors);
+            store_stream_hypercube<Profile>(
+                    hc_offset, source, cube, data, data_size, _dropped_bits, _quantizer, _verbatim);
+        }
+    }
+
+  private:
+    const uint8_t *_selectors;
+    unsigned _dropped_bits;
+    std::optional<quantizer<value_type>> _quantizer;
+    const uint8_t *_verbatim;
+    bool _entropy_coded;
+    index_type _slot_length;
+    detail::stream<const Profile> _stream;
+    const bits_type *_border;
+};
+
+// Decodes every hypercube into a tile of its own and averages the tile in blocks of factor^dims values. Blocks never
+// straddle the boundary between hypercubes and border because factor divides the hypercube side length.
+template<typename Profile>
+index_type decompress_preview(const typename Profile::bits_type *raw_stream, unsigned factor,
+        typename Profile::value_type *preview, const extent &data_size, const stream_options &options,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    using value_type = typename Profile::value_type;
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, dims);
+
+    if (data_size.dimensions() != dims) {
+        throw std::runtime_error{"data dimensionality does not match decompressor dimensionality"};
+    }
+    if (factor == 0 || factor > side_length || (factor & (factor - 1)) != 0) {
+        throw std::invalid_argument{"preview factor must be a power of two not larger than the hypercube side length"};
+    }
+    if (options.progressive || options.prediction_chain_length > 0 || options.hypercube_shape) {
+        throw std::invalid_argument{
+                "previews of progressive, cross-predicted or custom-shaped streams are not supported"};
+    }
+
+    const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto static_size = static_extent<dims>{data_size};
+    const auto preview_size = static_extent<dims>{preview_extent(data_size, factor)};
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+
+    const auto preamble = read_stream_preamble(raw_stream, preamble_flags(options, false));
+    const hypercube_reader<Profile> reader{raw_stream, preamble, num_hypercubes};
+    const auto means = factor == side_length ? means_table(preamble, raw_stream, num_hypercubes) : nullptr;
+
+    const auto tile_size = static_extent<dims>::broadcast(side_length);
+    const auto block_grid = static_extent<dims>::broadcast(side_length / factor);
+    const auto num_blocks = num_elements(block_grid);
+    const auto block_size = ipow(index_type{factor}, dims);
+    std::vector<std::vector<value_type>> thread_tiles(num_threads, std::vector<value_type>(hc_size));
+    std::vector<std::vector<double>> thread_sums(num_threads, std::vector<double>(num_blocks));
+
+    std::exception_ptr exception;
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+        const auto preview_offset = hc_offset / factor;
+        if (means) {
+            preview[linear_index(preview_size, preview_offset)] = bit_cast<value_type>(means[hc_index]);
+            continue;
+        }
+
+        // exceptions must not escape the parallel region
+        const auto tile = thread_tiles[tid].data();
+        try {
+            reader.decode(hc_index, static_extent<dims>{}, tile, tile_size, thread_cubes[tid].data(),
+                    thread_scratch[tid]);
+        } catch (...) {
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp critical(exception)
+#endif
+            if (!exception) { exception = std::current_exception(); }
+            continue;
+        }
+
+        auto &sums = thread_sums[tid];
+        std::fill(sums.begin(), sums.end(), 0.0);
+        for (index_type i = 0; i < hc_size; i += side_length) {
+            const auto block_row = linear_index(block_grid, extent_from_linear_id(i, tile_size) / factor);
+            for (index_type j = 0; j < side_length; ++j) {
+                sums[block_row + j / factor] += tile[i + j];
+            }
+        }
+        for (index_type block = 0; block < num_blocks; ++block) {
+            const auto pos = preview_offset + extent_from_linear_id(block, block_grid);
+            preview[linear_index(preview_size, pos)] = static_cast<value_type>(sums[block] / block_size);
+        }
+    }
+    if (exception) { std::rethrow_exception(exception); }
+
+    // Blocks in the border may be cut off by the end of the array and are averaged over their actual elements
+    std::vector<double> border_sums(num_elements(preview_size));
+    std::vector<index_type> border_counts(num_elements(preview_size));
+    const auto add_border_value = [&](const static_extent<dims> &pos, value_type value) {
+        const auto block = linear_index(preview_size, pos / factor);
+        border_sums[block] += value;
+        ++border_counts[block];
+    };
+    const auto border = reader.border();
+    index_type border_length = 0;
+    if ((preamble.flags & preamble::padded_border) && border[0] == padded_hypercubes) {
+        const auto offsets = partial_hypercube_offsets<Profile>(static_size);
+        detail::stream<const Profile> partials{static_cast<index_type>(offsets.size()), border + 1};
+        const auto cube = thread_cubes[0].data();
+        for (index_type i = 0; i < offsets.size(); ++i) {
+            decode_partial_hypercube<Profile>(partials, i, cube, preamble.flags & preamble::entropy_coded,
+                    thread_scratch[0]);
+            for (index_type j = 0; j < hc_size; ++j) {
+                const auto pos = offsets[i] + extent_from_linear_id(j, tile_size);
+                bool inside = true;
+                for (dim_type d = 0; d < dims; ++d) {
+                    inside &= pos[d] < static_size[d];
+                }
+                if (inside) { add_border_value(pos, bit_cast<value_type>(cube[j])); }
+            }
+        }
+        border_length = static_cast<index_type>(partials.border() - border);
+    } else {
+        // A raw border in a padded-border stream follows its encoding word
+        border_length = preamble.flags & preamble::padded_border ? 1 : 0;
+        for_each_border_slice(static_size, side_length, [&](index_type offset, index_type count) {
+            for (index_type i = 0; i < count; ++i) {
+                add_border_value(extent_from_linear_id(offset + i, static_size),
+                        load_unaligned<value_type>(border + border_length + i));
+            }
+            border_length += count;
+        });
+    }
+    for (index_type block = 0; block < border_sums.size(); ++block) {
+        if (border_counts[block] > 0) {
+            preview[block] = static_cast<value_type>(border_sums[block] / border_counts[block]);
+        }
+    }
+    return static_cast<index_type>(reader.border() - raw_stream) + border_length;
+}
+
+// Decodes the hypercubes whose bounds satisfy may_match, and the border. Returns the number of decoded hypercubes.
+template<typename Profile>
+index_type decompress_where(const typename Profile::bits_type *raw_stream,
+        const std::function<bool(typename Profile::value_type, typename Profile::value_type)> &may_match,
+        typename Profile::value_type *data, const extent &data_size, const stream_options &options,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    using value_type = typename Profile::value_type;
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+
+    if (data_size.dimensions() != dims) {
+        throw std::runtime_error{"data dimensionality does not match decompressor dimensionality"};
+    }
+    if (!options.hypercube_bounds) {
+        throw std::invalid_argument{"selective decompression requires a decompressor for streams with bounds"};
+    }
+    if (options.prediction_chain_length > 0) {
+        throw std::invalid_argument{"selective decompression of cross-predicted streams is not supported"};
+    }
+
+    [[maybe_unused]] const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto static_size = static_extent<dims>{data_size};
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+
+    const auto preamble = read_stream_preamble(raw_stream, preamble_flags(options, false));
+    const hypercube_reader<Profile> reader{raw_stream, preamble, num_hypercubes};
+    const auto bounds = bounds_table(preamble, raw_stream, num_hypercubes);
+
+    index_type num_decoded = 0;
+    std::exception_ptr exception;
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic) reduction(+ : num_decoded)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        // exceptions, also from may_match, must not escape the parallel region
+        try {
+            if (!may_match(bit_cast<value_type>(bounds[2 * hc_index]),
+                        bit_cast<value_type>(bounds[2 * hc_index + 1]))) {
+                continue;
+            }
+            const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+            reader.decode(hc_index, hc_offset, data, static_size, thread_cubes[tid].data(),
+                    thread_scratch[tid]);
+            ++num_decoded;
+        } catch (...) {
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp critical(exception)
+#endif
+            if (!exception) { exception = std::current_exception(); }
+        }
+    }
+    if (exception) { std::rethrow_exception(exception); }
+
+    unpack_stream_border<Profile>(preamble, data, static_size, reader.border(), thread_cubes, thread_scratch);
+    return num_decoded;
+}
+
+inline void validate_region(const box &region, const extent &data_size) {
+    const auto dims = data_size.dimensions();
+    if (region.offset.dimensions() != dims || region.size.dimensions() != dims) {
+        throw std::invalid_argument{"region dimensionality does not match the array"};
+    }
+    for (dim_type d = 0; d < dims; ++d) {
+        if (region.offset[d] > data_size[d] || region.size[d] > data_size[d] - region.offset[d]) {
+            throw std::invalid_argument{"region exceeds the bounds of the array"};
+        }
+    }
+}
+
+inline bool block_intersects_region(const extent &block_offset, const extent &block_size, const box &region) {
+    for (dim_type d = 0; d < block_size.dimensions(); ++d) {
+        if (block_offset[d] >= region.offset[d] + region.size[d]
+                || region.offset[d] >= block_offset[d] + block_size[d]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copies the elements of a block of block_size at block_offset that lie inside region to region_data, an array of
+// size region.size, one row of the innermost dimension at a time
+template<typename T, typename Element>
+void copy_block_to_region(const Element *block, const extent &block_offset, const extent &block_size,
+        const box &region, T *region_data) {
+    static_assert(sizeof(Element) == sizeof(T));
+    if (!block_intersects_region(block_offset, block_size, region)) { return; }
+    const auto dims = block_size.dimensions();
+    extent begin(dims);
+    extent end(dims);
+    for (dim_type d = 0; d < dims; ++d) {
+        begin[d] = std::max(block_offset[d], region.offset[d]);
+        end[d] = std::min(block_offset[d] + block_size[d], region.offset[d] + region.size[d]);
+    }
+    const auto row_length = end[dims - 1] - begin[dims - 1];
+    for (auto pos = begin;;) {
+        memcpy(region_data + linear_index(region.size, pos - region.offset),
+                block + linear_index(block_size, pos - block_offset), row_length * sizeof(T));
+        auto d = dims - 1;
+        for (; d > 0; --d) {
+            if (++pos[d - 1] < end[d - 1]) { break; }
+            pos[d - 1] = begin[d - 1];
+        }
+        if (d == 0) { return; }
+    }
+}
+
+// Decodes the elements inside region into data, an array of size region.size, from only the hypercubes that intersect
+// the region and the border. Hypercubes of progressive, cross-predicted and custom-shaped streams cannot be decoded
+// individually, so decode_all(full) decompresses these into a temporary array of data_size first.
+template<typename Profile, typename DecodeAll>
+index_type decompress_region(const typename Profile::bits_type *raw_stream, const box &region,
+        typename Profile::value_type *data, const extent &data_size, const stream_options &options,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<encoding_buffer<Profile>> &thread_scratch,
+        const DecodeAll &decode_all) {
+    using value_type = typename Profile::value_type;
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, dims);
+
+    if (data_size.dimensions() != dims) {
+        throw std::runtime_error{"data dimensionality does not match decompressor dimensionality"};
+    }
+    validate_region(region, data_size);
+    if (options.progressive || options.prediction_chain_length > 0 || options.hypercube_shape) {
+        std::vector<value_type> full(num_elements(data_size));
+        const auto stream_length = decode_all(full.data());
+        copy_block_to_region(full.data(), extent(dims), data_size, region, data);
+        return stream_length;
+    }
+
+    [[maybe_unused]] const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto static_size = static_extent<dims>{data_size};
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    const auto preamble = read_stream_preamble(raw_stream, preamble_flags(options, false));
+    const hypercube_reader<Profile> reader{raw_stream, preamble, num_hypercubes};
+
+    // The hypercubes intersecting the region form a sub-grid starting at first_hc
+    const auto hc_grid = static_size / side_length;
+    static_extent<dims> first_hc;
+    static_extent<dims> region_grid;
+    for (dim_type d = 0; d < dims; ++d) {
+        first_hc[d] = region.offset[d] / side_length;
+        const auto end_hc = std::min(div_ceil(region.offset[d] + region.size[d], side_length), hc_grid[d]);
+        region_grid[d] = end_hc > first_hc[d] ? end_hc - first_hc[d] : 0;
+    }
+    const auto num_region_hcs = num_elements(region.size) > 0 ? num_elements(region_grid) : 0;
+
+    const auto tile_size = static_extent<dims>::broadcast(side_length);
+    std::vector<std::vector<value_type>> thread_tiles(num_threads, std::vector<value_type>(hc_size));
+    std::exception_ptr exception;
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+#endif
+    for (index_type i = 0; i < num_region_hcs; ++i) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        const auto hc_grid_pos = first_hc + extent_from_linear_id(i, region_grid);
+        const auto tile = thread_tiles[tid].data();
+        // exceptions must not escape the parallel region
+        try {
+            reader.decode(linear_index(hc_grid, hc_grid_pos), static_extent<dims>{}, tile, tile_size,
+                    thread_cubes[tid].data(), thread_scratch[tid]);
+            copy_block_to_region(tile, hc_grid_pos * side_length, tile_size, region, data);
+        } catch (...) {
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp critical(exception)
+#endif
+            if (!exception) { exception = std::current_exception(); }
+        }
+    }
+    if (exception) { std::rethrow_exception(exception); }
+
+    const auto border = reader.border();
+    index_type border_length = 0;
+    if ((preamble.flags & preamble::padded_border) && border[0] == padded_hypercubes) {
+        const auto offsets = partial_hypercube_offsets<Profile>(static_size);
+        detail::stream<const Profile> partials{static_cast<index_type>(offsets.size()), border + 1};
+        const auto cube = thread_cubes[0].data();
+        for (index_type i = 0; i < offsets.size(); ++i) {
+            if (!block_intersects_region(offsets[i], tile_size, region)) { continue; }
+            decode_partial_hypercube<Profile>(partials, i, cube, preamble.flags & preamble::entropy_coded,
+                    thread_scratch[0]);
+            copy_block_to_region(cube, offsets[i], tile_size, region, data);
+        }
+        border_length = static_cast<index_type>(partials.border() - border);
+    } else {
+        // A raw border in a padded-border stream follows its encoding word. Slices are copied row by row, which are
+        // contiguous in both the array and the region.
+        border_length = preamble.flags & preamble::padded_border ? 1 : 0;
+        for_each_border_slice(static_size, side_length, [&](index_type offset, index_type count) {
+            for (index_type i = 0; i < count;) {
+                const auto pos = extent_from_linear_id(offset + i, static_size);
+                auto row_size = static_extent<dims>::broadcast(1);
+                row_size[dims - 1] = std::min(count - i, static_size[dims - 1] - pos[dims - 1]);
+                copy_block_to_region(border + border_length + i, pos, row_size, region, data);
+                i += row_size[dims - 1];
+            }
+            border_length += count;
+        });
+    }
+    return static_cast<index_type>(border - raw_stream) + border_length;
+}
+
+// Difference between the transformed values of a hypercube of a secondary field and the co-located hypercube of the
+// primary field, taken between the two's complement representations of the residuals
+template<typename Bits>
+Bits field_difference(Bits secondary, Bits primary) {
+    return complement_negative(static_cast<Bits>(complement_negative(secondary) - complement_negative(primary)));
+}
+
+template<typename Bits>
+Bits field_sum(Bits difference, Bits primary) {
+    return complement_negative(static_cast<Bits>(complement_negative(difference) + complement_negative(primary)));
+}
+
+// Replaces a transformed hypercube of a secondary field by its difference to the transformed co-located hypercube of
+// the primary field if that leaves fewer non-zero bit planes in the zero-bit chunks. Returns whether it did.
+template<typename Profile>
+bool subtract_primary_field(const typename Profile::bits_type *primary, typename Profile::bits_type *cube) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto hc_size = ipow(Profile::hypercube_side_length, Profile::dimensions);
+
+    index_type independent_cost = 0;
+    index_type predicted_cost = 0;
+    for (index_type i = 0; i < hc_size; i += bits_of<bits_type>) {
+        bits_type independent = 0;
+        bits_type predicted = 0;
+        for (index_type j = i; j < i + bits_of<bits_type>; ++j) {
+            independent |= cube[j];
+            predicted |= field_difference(cube[j], primary[j]);
+        }
+        independent_cost += popcount(independent);
+        predicted_cost += popcount(predicted);
+    }
+    if (predicted_cost >= independent_cost) { return false; }
+
+    for (index_type i = 0; i < hc_size; ++i) {
+        cube[i] = field_difference(cube[i], primary[i]);
+    }
+    return true;
+}
+
+// Joint compression of several arrays of the same size. The offset header and the hypercube bodies interleave the
+// fields hypercube by hypercube, so that a single pass over the stream decodes all of them, and the borders of all
+// fields follow in order.
+template<typename Profile>
+index_type compress_fields(const typename Profile::value_type *const *fields, index_type num_fields,
+        const extent &data_size, const stream_options &options, typename Profile::bits_type *raw_stream,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<cube_buffer<Profile>> &thread_primary_cubes,
+        std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto max_hc_length = Profile::entropy_coded_block_length_bound;
+
+    if (data_size.dimensions() != dims) {
+        throw std::runtime_error{"data dimensionality does not match compressor dimensionality"};
+    }
+
+    const auto preamble = make_joint_preamble(options, num_fields);
+    const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto static_size = static_extent<dims>{data_size};
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    const auto num_entries = num_hypercubes * num_fields;
+    clear_hypercube_tables(preamble, raw_stream, num_entries);
+    const auto field_predicted = field_prediction_table(preamble, raw_stream, num_entries);
+    detail::stream<Profile> stream{num_entries, raw_stream + stream_prefix_length<bits_type>(preamble, num_entries)};
+
+    write_hypercubes_batched(stream, num_hypercubes, num_fields, num_threads,
+            [&](index_type hc_index, int tid, bits_type *encoded, index_type *encoded_lengths) {
+                const auto primary = thread_primary_cubes[tid].data();
+                const auto cube = thread_cubes[tid].data();
+                const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+                for (index_type field = 0; field < num_fields; ++field) {
+                    const auto transformed = field == 0 ? primary : cube;
+                    load_hypercube<Profile>(hc_offset, fields[field], static_size, transformed);
+                    block_transform<Profile>(transformed);
+                    if (field > 0 && subtract_primary_field<Profile>(primary, cube)) {
+                        field_predicted[hc_index * num_fields + field] = 1;
+                    }
+                    encoded_lengths[field] = encode_hypercube<Profile>(transformed, encoded + field * max_hc_length,
+                            options.level, thread_scratch[tid].data());
+                }
+            });
+
+    auto border = stream.border();
+    for (index_type field = 0; field < num_fields; ++field) {
+        border += pack_border(border, fields[field], static_size, side_length);
+    }
+    write_preamble(preamble, raw_stream);
+    return static_cast<index_type>(border - raw_stream);
+}
+
+template<typename Profile>
+index_type decompress_fields(const typename Profile::bits_type *raw_stream, typename Profile::value_type *const *fields,
+        index_type num_fields, const extent &data_size, const stream_options &options,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<cube_buffer<Profile>> &thread_primary_cubes,
+        std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto dims = Profile::dimensions;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, dims);
+
+    if (data_size.dimensions() != dims) {
+        throw std::runtime_error{"data dimensionality does not match decompressor dimensionality"};
+    }
+
+    const auto preamble = read_stream_preamble(raw_stream, make_joint_preamble(options, num_fields).flags);
+    if (preamble.num_fields != num_fields) { throw std::runtime_error{"stream holds a different number of fields"}; }
+    [[maybe_unused]] const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto static_size = static_extent<dims>{data_size};
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    const auto num_entries = num_hypercubes * num_fields;
+    const auto field_predicted = field_prediction_table(preamble, raw_stream, num_entries);
+    for (index_type entry = 0; entry < num_entries; ++entry) {
+        if (field_predicted[entry] > (entry % num_fields != 0 ? 1 : 0)) {
+            throw std::runtime_error{"stream contains an invalid field prediction table"};
+        }
+    }
+    detail::stream<const Profile> stream{
+            num_entries, raw_stream + stream_prefix_length<bits_type>(preamble, num_entries)};
+
+    const bool entropy_coded = preamble.flags & preamble::entropy_coded;
+    std::exception_ptr exception;
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        const auto primary = thread_primary_cubes[tid].data();
+        const auto cube = thread_cubes[tid].data();
+        auto &scratch = thread_scratch[tid];
+        const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+        // exceptions must not escape the parallel region
+        try {
+            const auto first_entry = hc_index * num_fields;
+            decode_hypercube<Profile>(stream.hypercube(first_entry), stream.hypercube_size(first_entry), primary,
+                    entropy_coded, scratch);
+            for (index_type field = 1; field < num_fields; ++field) {
+                const auto entry = first_entry + field;
+                decode_hypercube<Profile>(
+                        stream.hypercube(entry), stream.hypercube_size(entry), cube, entropy_coded, scratch);
+                if (field_predicted[entry]) {
+                    for (index_type i = 0; i < hc_size; ++i) {
+                        cube[i] = field_sum(cube[i], primary[i]);
+                    }
+                }
+                inverse_block_transform<Profile>(cube);
+                store_hypercube<Profile>(hc_offset, cube, fields[field], static_size);
+            }
+            inverse_block_transform<Profile>(primary);
+            store_hypercube<Profile>(hc_offset, primary, fields[0], static_size);
+        } catch (...) {
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp critical(exception)
+#endif
+            if (!exception) { exception = std::current_exception(); }
+        }
+    }
+    if (exception) { std::rethrow_exception(exception); }
+
+    auto border = stream.border();
+    for (index_type field = 0; field < num_fields; ++field) {
+        border += unpack_border(fields[field], static_size, border, side_length);
+    }
+    return static_cast<index_type>(border - raw_stream);
+}
+
+// Offset of the hc_index-th hypercube of shape Shape in an array, hypercubes are numbered in row-major order
+template<typename Shape>
+static_extent<Shape::dimensions> shaped_hypercube_offset(
+        index_type hc_index, const static_extent<Shape::dimensions> &data_size) {
+    static_extent<Shape::dimensions> offset;
+    for (dim_type d = Shape::dimensions; d-- > 0;) {
+        const auto num_along_axis = data_size[d] / Shape::extents[d];
+        offset[d] = hc_index % num_along_axis * Shape::extents[d];
+        hc_index /= num_along_axis;
+    }
+    return offset;
+}
+
+// Offset of the row-th row of a hypercube of shape Shape relative to its first element in an array
+template<typename Shape>
+index_type shaped_row_offset(index_type row, const static_extent<Shape::dimensions> &data_size) {
+    index_type offset = 0;
+    index_type stride = 1;
+    for (dim_type d = Shape::dimensions - 1; d-- > 0;) {
+        stride *= data_size[d + 1];
+        offset += row % Shape::extents[d] * stride;
+        row /= Shape::extents[d];
+    }
+    return offset;
+}
+
+template<typename Shape, typename Profile>
+[[gnu::noinline]] void load_shaped_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        typename Profile::bits_type *cube) {
+    const auto first = data + linear_index(data_size, hc_offset);
+    for (index_type i = 0; i < Shape::num_values; i += Shape::row_length) {
+        memcpy(assume_simd_aligned(cube) + i, first + shaped_row_offset<Shape>(i / Shape::row_length, data_size),
+                Shape::row_length * sizeof(typename Profile::value_type));
+    }
+}
+
+template<typename Shape, typename Profile>
+[[gnu::noinline]] void store_shaped_hypercube(const static_extent<Profile::dimensions> &hc_offset,
+        const typename Profile::bits_type *cube, typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, statistics_accumulator *statistics = nullptr) {
+    using value_type = typename Profile::value_type;
+
+    const auto first = data + linear_index(data_size, hc_offset);
+    for (index_type i = 0; i < Shape::num_values; i += Shape::row_length) {
+        memcpy(first + shaped_row_offset<Shape>(i / Shape::row_length, data_size), assume_simd_aligned(cube) + i,
+                Shape::row_length * sizeof(value_type));
+    }
+    if (statistics) {
+        for (index_type i = 0; i < Shape::num_values; ++i) {
+            statistics->add(load_aligned<value_type>(assume_simd_aligned(cube) + i));
+        }
+    }
+}
+
+// Differences between neighbors along one outer axis of a hypercube. Strides and extents are compile-time constants,
+// so the contiguous inner loop is vectorized for every shape.
+template<typename Shape, dim_type Axis, typename Bits>
+[[gnu::always_inline]] inline void shaped_difference_along_axis(Bits *x) {
+    constexpr auto stride = Shape::stride(Axis);
+    constexpr auto extent = Shape::extents[Axis];
+    for (index_type slab = 0; slab < Shape::num_values; slab += extent * stride) {
+        for (index_type j = slab + (extent - 1) * stride; j > slab; j -= stride) {
+            for (index_type k = 0; k < stride; ++k) {
+                x[j + k] -= x[j - stride + k];
+            }
+        }
+    }
+}
+
+template<typename Shape, dim_type Axis, typename Bits>
+[[gnu::always_inline]] inline void inverse_shaped_difference_along_axis(Bits *x) {
+    constexpr auto stride = Shape::stride(Axis);
+    constexpr auto extent = Shape::extents[Axis];
+    for (index_type slab = 0; slab < Shape::num_values; slab += extent * stride) {
+        for (index_type j = slab + stride; j < slab + extent * stride; j += stride) {
+            for (index_type k = 0; k < stride; ++k) {
+                x[j + k] += x[j - stride + k];
+            }
+        }
+    }
+}
+
+// Lorenzo block transform of a hypercube of shape Shape, equivalent to block_transform for cubic shapes
+template<typename Shape, typename Bits>
+[[gnu::noinline]] void shaped_block_transform(Bits *x) {
+    constexpr auto row_length = Shape::row_length;
+    x = assume_simd_aligned(x);
+
+    for (index_type i = 0; i < Shape::num_values; ++i) {
+        x[i] = rotate_left_1(x[i]);
+    }
+    for (index_type i = 0; i < Shape::num_values; i += row_length) {
+#ifdef __AVX2__
+        block_transform_horizontal_avx2<row_length>(x + i);
+#else
+        for (index_type j = i + row_length - 1; j > i; --j) {
+            x[j] -= x[j - 1];
+        }
+#endif
+    }
+    if constexpr (Shape::dimensions >= 2) { shaped_difference_along_axis<Shape, Shape::dimensions - 2>(x); }
+    if constexpr (Shape::dimensions >= 3) { shaped_difference_along_axis<Shape, 0>(x); }
+    for (index_type i = 0; i < Shape::num_values; ++i) {
+        x[i] = complement_negative(x[i]);
+    }
+}
+
+template<typename Shape, typename Bits>
+[[gnu::noinline]] void inverse_shaped_block_transform(Bits *x) {
+    constexpr auto row_length = Shape::row_length;
+    x = assume_simd_aligned(x);
+
+    for (index_type i = 0; i < Shape::num_values; ++i) {
+        x[i] = complement_negative(x[i]);
+    }
+    if constexpr (Shape::dimensions >= 3) { inverse_shaped_difference_along_axis<Shape, 0>(x); }
+    if constexpr (Shape::dimensions >= 2) { inverse_shaped_difference_along_axis<Shape, Shape::dimensions - 2>(x); }
+    for (index_type i = 0; i < Shape::num_values; i += row_length) {
+        for (index_type j = i + 1; j < i + row_length; ++j) {
+            x[j] += x[j - 1];
+        }
+    }
+    for (index_type i = 0; i < Shape::num_values; ++i) {
+        x[i] = rotate_right_1(x[i]);
+    }
+}
+
+// Streams with a custom hypercube shape tile the array with hypercubes of that shape and leave all other elements to
+// the border. Only the tiling and the block transform depend on the shape, the hypercubes are encoded like those of
+// the cubic profile.
+template<typename Profile, typename Shape>
+index_type compress_with_shape(const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, const preamble &preamble, int level,
+        typename Profile::bits_type *raw_stream, std::vector<cube_buffer<Profile>> &thread_cubes,
+        std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    using bits_type = typename Profile::bits_type;
+    static_assert(Shape::num_values == ipow(Profile::hypercube_side_length, Profile::dimensions));
+
+    const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto num_hypercubes = detail::num_hypercubes(data_size, Shape::tile());
+    clear_hypercube_tables(preamble, raw_stream, num_hypercubes);
+    detail::stream<Profile> stream{
+            num_hypercubes, raw_stream + stream_prefix_length<bits_type>(preamble, num_hypercubes)};
+
+    write_hypercubes_batched(stream, num_hypercubes, 1, num_threads,
+            [&](index_type hc_index, int tid, bits_type *encoded, index_type *encoded_length) {
+                const auto cube = thread_cubes[tid].data();
+                load_shaped_hypercube<Shape, Profile>(
+                        shaped_hypercube_offset<Shape>(hc_index, data_size), data, data_size, cube);
+                shaped_block_transform<Shape>(cube);
+                *encoded_length = encode_hypercube<Profile>(cube, encoded, level, thread_scratch[tid].data());
+            });
+
+    const auto border_length = pack_border(stream.border(), data, data_size, Shape::tile());
+    write_preamble(preamble, raw_stream);
+    return static_cast<index_type>(stream.border() - raw_stream) + border_length;
+}
+
+template<typename Profile, typename Shape>
+index_type decompress_with_shape(const typename Profile::bits_type *raw_stream, const preamble &preamble,
+        typename Profile::value_type *data, const static_extent<Profile::dimensions> &data_size,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<encoding_buffer<Profile>> &thread_scratch,
+        array_statistics *statistics) {
+    using bits_type = typename Profile::bits_type;
+
+    [[maybe_unused]] const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto num_hypercubes = detail::num_hypercubes(data_size, Shape::tile());
+    detail::stream<const Profile> stream{
+            num_hypercubes, raw_stream + stream_prefix_length<bits_type>(preamble, num_hypercubes)};
+    std::vector<statistics_accumulator> thread_statistics(statistics ? thread_cubes.size() : 0);
+
+    const bool entropy_coded = preamble.flags & preamble::entropy_coded;
+    std::exception_ptr exception;
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        const auto cube = thread_cubes[tid].data();
+        const auto hc_offset = shaped_hypercube_offset<Shape>(hc_index, data_size);
+        // exceptions must not escape the parallel region
+        try {
+            decode_hypercube<Profile>(stream.hypercube(hc_index), stream.hypercube_size(hc_index), cube,
+                    entropy_coded, thread_scratch[tid]);
+            inverse_shaped_block_transform<Shape>(cube);
+            store_shaped_hypercube<Shape, Profile>(
+                    hc_offset, cube, data, data_size, statistics ? &thread_statistics[tid] : nullptr);
+        } catch (...) {
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp critical(exception)
+#endif
+            if (!exception) { exception = std::current_exception(); }
+        }
+    }
+    if (exception) { std::rethrow_exception(exception); }
+
+    const auto border_length = unpack_border(data, data_size, stream.border(), Shape::tile());
+    finish_statistics<Profile>(data, data_size, statistics ? &thread_statistics : nullptr, statistics, Shape::tile());
+    return static_cast<index_type>(stream.border() - raw_stream) + border_length;
+}
+
+template<typename Profile>
+index_type compress_shaped(const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, const preamble &preamble, int level,
+        typename Profile::bits_type *raw_stream, std::vector<cube_buffer<Profile>> &thread_cubes,
+        std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    index_type length = 0;
+    visit_hypercube_shape<Profile::dimensions>(stream_hypercube_shape(preamble, Profile::dimensions), [&](auto shape) {
+        length = compress_with_shape<Profile, decltype(shape)>(
+                data, data_size, preamble, level, raw_stream, thread_cubes, thread_scratch);
+    });
+    return length;
+}
+
+// The preamble must have been read with the flags of the decompressor's options, which include the hypercube shape
+template<typename Profile>
+index_type decompress_shaped(const typename Profile::bits_type *raw_stream, const preamble &preamble,
+        const stream_options &options, typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &data_size, std::vector<cube_buffer<Profile>> &thread_cubes,
+        std::vector<encoding_buffer<Profile>> &thread_scratch, array_statistics *statistics) {
+    const auto shape = stream_hypercube_shape(preamble, Profile::dimensions);
+    if (shape != *options.hypercube_shape) {
+        throw std::runtime_error{"stream was compressed with a different hypercube shape"};
+    }
+    index_type length = 0;
+    visit_hypercube_shape<Profile::dimensions>(shape, [&](auto shape) {
+        length = decompress_with_shape<Profile, decltype(shape)>(
+                raw_stream, preamble, data, data_size, thread_cubes, thread_scratch, statistics);
+    });
+    return length;
+}
+
+template<typename Profile>
+index_type update_stream(const typename Profile::value_type *data,
+        const static_extent<Profile::dimensions> &static_size, const std::vector<box> &dirty,
+        const stream_options &options, typename Profile::bits_type *raw_stream,
+        std::vector<cube_buffer<Profile>> &thread_cubes, std::vector<encoding_buffer<Profile>> &thread_scratch) {
+    using bits_type = typename Profile::bits_type;
+    constexpr auto side_length = Profile::hypercube_side_length;
+    constexpr auto max_hc_length = Profile::entropy_coded_block_length_bound;
+
+    [[maybe_unused]] const auto num_threads = static_cast<int>(thread_cubes.size());
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    auto [dirty_hcs, border_dirty] = find_dirty_hypercubes(static_size, dirty);
+    auto num_dirty = static_cast<index_type>(dirty_hcs.size());
+
+    const auto preamble = read_stream_preamble(raw_stream, preamble_flags(options, false));
+    if (preamble.flags & preamble::shaped_hypercubes) {
+        // Dirty regions are tracked in cubic hypercubes, so the stream is rebuilt
+        return compress_shaped<Profile>(
+                data, static_size, preamble, options.level, raw_stream, thread_cubes, thread_scratch);
+    }
+    const auto selectors = predictor_table(preamble, raw_stream);
+    const auto dropped_bits = dropped_mantissa_bits<typename Profile::value_type>(preamble);
+    const auto quantizer = stream_quantizer<typename Profile::value_type>(preamble);
+    const auto verbatim = verbatim_table(preamble, raw_stream, num_hypercubes);
+    const auto border_length = border_element_count(static_size, side_length);
+
+    const auto checksums = checksum_table(preamble, raw_stream, num_hypercubes);
+    const auto means = means_table(preamble, raw_stream, num_hypercubes);
+    const auto bounds = bounds_table(preamble, raw_stream, num_hypercubes);
+    if (means || bounds) {
+        for (const auto hc_index : dirty_hcs) {
+            const auto hc_offset = extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+            write_hypercube_index_entry<Profile>(
+                    hc_index, summarize_hypercube<Profile>(hc_offset, data, static_size), means, bounds);
+        }
+    }
+
+    if (preamble.flags & preamble::progressive) {
+        // Every plane section interleaves all hypercubes, so the stream is rebuilt
+        return compress_progressive<Profile>(data, static_size, preamble, raw_stream, thread_cubes);
+    }
+
+    if (preamble.flags & preamble::fixed_rate) {
+        // Slots do not move, dirty hypercubes are re-encoded in place
+        const auto slot_length = fixed_rate_slot_length<Profile>(preamble);
+        const auto slots = raw_stream + stream_prefix_length<bits_type>(preamble, num_hypercubes);
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+#endif
+        for (index_type i = 0; i < num_dirty; ++i) {
+#if NDZIP_OPENMP_SUPPORT
+            const auto tid = omp_get_thread_num();
+#else
+            const auto tid = 0;
+#endif
+            const auto hc_offset = extent_from_linear_id(dirty_hcs[i], static_size / side_length) * side_length;
+            encode_fixed_rate_hypercube<Profile>(hc_offset, dirty_hcs[i], data, static_size, selectors,
+                    thread_cubes[tid].data(), slots + dirty_hcs[i] * slot_length, slot_length,
+                    thread_scratch[tid].data());
+        }
+        const auto border = slots + num_hypercubes * slot_length;
+        if (border_dirty) { detail::pack_border(border, data, static_size, side_length); }
+        return static_cast<index_type>(border - raw_stream) + border_length;
+    }
+
+    detail::stream<Profile> stream{num_hypercubes,
+            raw_stream + stream_prefix_length<bits_type>(preamble, num_hypercubes), header_marker_bits(preamble)};
+    const auto base = stream.hypercube(0);
+
+    // A clean border moves with the hypercubes before it. A dirty one is re-packed and may change its length.
+    auto stream_border_length = preamble.flags & preamble::padded_border
+            ? padded_border_length<Profile>(stream.border(), static_size)
+            : border_length;
+
+    // Duplicates of a dirty hypercube are re-encoded along with it. Re-encoded hypercubes are never deduplicated, but
+    // the back-references of all other hypercubes stay valid because hypercubes keep their indices.
+    std::vector<bool> back_references(num_hypercubes);
+    if (preamble.flags & preamble::deduplicated) {
+        detail::stream<const Profile> const_stream{stream.num_hypercubes, stream.buffer, stream.marker_bits};
+        std::vector<bool> is_dirty(num_hypercubes);
+        for (const auto hc_index : dirty_hcs) {
+            is_dirty[hc_index] = true;
+        }
+        for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+            if (is_dirty[hc_index]) { continue; }
+            const auto source = encoding_source(const_stream, hc_index);
+            if (is_dirty[source]) {
+                is_dirty[hc_index] = true;
+                dirty_hcs.push_back(hc_index);
+            } else {
+                back_references[hc_index] = source != hc_index;
+            }
+        }
+        std::sort(dirty_hcs.begin(), dirty_hcs.end());
+        num_dirty = static_cast<index_type>(dirty_hcs.size());
+    }
+
+    // The successors of a dirty hypercube in its prediction chain are re-encoded along with it
+    if (preamble.flags & preamble::cross_prediction) {
+        std::vector<bool> is_dirty(num_hypercubes);
+        for (const auto hc_index : dirty_hcs) {
+            const auto num_successors = chain_successors<Profile>(hc_index, static_size, preamble);
+            std::fill_n(is_dirty.begin() + hc_index, num_successors + 1, true);
+        }
+        dirty_hcs.clear();
+        for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+            if (is_dirty[hc_index]) { dirty_hcs.push_back(hc_index); }
+        }
+        num_dirty = static_cast<index_type>(dirty_hcs.size());
+    }
+
+    // Encode all dirty hypercubes out-of-place first, their new positions are only known after the prefix sum
+    std::vector<bits_type> encoded(num_dirty * max_hc_length);
+    std::vector<index_type> encoded_lengths(num_dirty);
+    std::vector<uint8_t> encoded_raw(num_dirty);  // not vector<bool>, which threads cannot write concurrently
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+#endif
+    for (index_type i = 0; i < num_dirty; ++i) {
+#if NDZIP_OPENMP_SUPPORT
+        const auto tid = omp_get_thread_num();
+#else
+        const auto tid = 0;
+#endif
+        auto &cube = thread_cubes[tid];
+        const auto hc_offset = extent_from_linear_id(dirty_hcs[i], static_size / side_length) * side_length;
+        load_stream_hypercube<Profile>(
+                hc_offset, dirty_hcs[i], data, static_size, cube.data(), dropped_bits, quantizer, verbatim);
+        forward_transform<Profile>(cube.data(), dirty_hcs[i], selectors);
+        if (predicts_leading_face<Profile>(hc_offset, preamble)) {
+            subtract_leading_face<Profile>(hc_offset, data, static_size, cube.data());
+        }
+        bool raw;
+        encoded_lengths[i] = encode_or_write_raw_hypercube<Profile>(hc_offset, data, static_size, cube.data(),
+                encoded.data() + i * max_hc_length, options.level, thread_scratch[tid].data(),
+                preamble.flags & preamble::raw_fallback, raw);
+        encoded_raw[i] = raw;
+        if (checksums) {
+            checksums[dirty_hcs[i]] = hypercube_checksum<Profile>(
+                    encoded.data() + i * max_hc_length, encoded_lengths[i], dirty_hcs[i], raw, false);
+        }
+    }
+
+    // Rebuild the offset header from the old hypercube lengths and the new lengths of dirty hypercubes
+    std::vector<index_type> old_offsets(num_hypercubes);
+    std::vector<index_type> lengths(num_hypercubes);
+    std::vector<bool> raw(num_hypercubes);
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+        old_offsets[hc_index] = stream.offset_after(hc_index);
+        lengths[hc_index] = stream.hypercube_size(hc_index);
+        raw[hc_index] = stream.is_raw(hc_index);
+    }
+    for (index_type i = 0; i < num_dirty; ++i) {
+        lengths[dirty_hcs[i]] = encoded_lengths[i];
+        raw[dirty_hcs[i]] = encoded_raw[i] != 0;
+    }
+    // Checked before the header is overwritten so that the stream stays intact if the update does not fit
+    check_stream_offset(std::accumulate(lengths.begin(), lengths.end(), uint64_t{0}), stream.max_offset());
+    inclusive_scan_parallel(lengths.data(), stream.header(), num_hypercubes, num_threads);
+    for (index_type hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
+        if (back_references[hc_index]) { stream.set_back_reference(hc_index); }
+        if (raw[hc_index]) { stream.set_raw(hc_index); }
+    }
+
+    const auto old_begin = [&](index_type hc_index) { return hc_index == 0 ? 0 : old_offsets[hc_index - 1]; };
+    const auto new_begin = [&](index_type hc_index) { return hc_index == 0 ? 0 : stream.offset_after(hc_index - 1); };
+
+    std::vector<stream_run> runs;
+    for (index_type i = 0; i <= num_dirty; ++i) {
+        const auto first_hc = i == 0 ? 0 : dirty_hcs[i - 1] + 1;
+        const auto end_hc = i < num_dirty ? dirty_hcs[i] : num_hypercubes;
+        auto old_end = old_begin(end_hc);
+        if (i == num_dirty && !border_dirty) { old_end += stream_border_length; }
+        if (old_end > old_begin(first_hc) && old_begin(first_hc) != new_begin(first_hc)) {
+            runs.push_back(stream_run{old_begin(first_hc), new_begin(first_hc), old_end - old_begin(first_hc)});
+        }
+    }
+
+    const auto num_waves = schedule_stream_runs(runs);
+    for (unsigned wave = 0; wave < num_waves; ++wave) {
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+#endif
+        for (size_t r = 0; r < runs.size(); ++r) {
+            if (runs[r].wave == wave) {
+                memmove(base + runs[r].new_begin, base + runs[r].old_begin, runs[r].length * sizeof(bits_type));
+            }
+        }
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+#endif
+    for (index_type i = 0; i < num_dirty; ++i) {
+        memcpy(base + new_begin(dirty_hcs[i]), encoded.data() + i * max_hc_length,
+                encoded_lengths[i] * sizeof(bits_type));
+    }
+
+    if (border_dirty) {
+        stream_border_length = pack_stream_border<Profile>(
+                preamble, stream.border(), data, static_size, options.level, thread_cubes, thread_scratch);
+        if (checksums) {
+            checksums[num_hypercubes] = border_checksum(stream.border(), stream_border_length, num_hypercubes);
+        }
+    }
+    return static_cast<index_type>(stream.border() - raw_stream) + stream_border_length;
+}
+
+template<typename Profile>
+class serial_compressor : public compressor<typename Profile::value_type> {
+  public:
+    using value_type = typename Profile::value_type;
+
+  private:
+    using bits_type = typename Profile::bits_type;
+    constexpr static auto dimensions = Profile::dimensions;
+    constexpr static auto side_length = Profile::hypercube_side_length;
+    constexpr static auto hc_size = detail::ipow(side_length, dimensions);
+
+    stream_options options;
+    detail::cpu::simd_aligned_buffer<bits_type> cube{hc_size};
+    detail::cpu::simd_aligned_buffer<bits_type> reference_cube{hc_size};
+    detail::cpu::simd_aligned_buffer<bits_type> scratch{Profile::compressed_block_length_bound};
+
+  public:
+    explicit serial_compressor(const stream_options &options = {}) : options(options) {
+        validate_stream_options<value_type>(options, dimensions);
+    }
+
+    index_type compress(const value_type *data, const extent &data_size, bits_type *raw_stream) override {
+        return compress(data, nullptr, data_size, raw_stream);
+    }
+
+    index_type compress(const value_type *data, const value_type *reference, const extent &data_size,
+            bits_type *raw_stream) override;
+
+    index_type update(const value_type *data, const extent &data_size, const std::vector<box> &dirty,
+            bits_type *raw_stream) override;
+
+    index_type compress_fields(const value_type *const *fields, index_type num_fields, const extent &data_size,
+            bits_type *raw_stream) override {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        std::vector<cube_buffer<Profile>> primary_cubes(1);
+        std::vector<encoding_buffer<Profile>> scratch_buffers(1);
+        return detail::cpu::compress_fields<Profile>(
+                fields, num_fields, data_size, options, raw_stream, cubes, primary_cubes, scratch_buffers);
+    }
+};
+
+template<typename Profile>
+index_type serial_compressor<Profile>::compress(
+        const value_type *data, const value_type *reference, const extent &data_size, bits_type *raw_stream) {
+    if (data_size.dimensions() != dimensions) {
+        throw std::runtime_error{"data dimensionality does not match compressor dimensionality"};
+    }
+
+    const auto static_size = detail::static_extent<dimensions>{data_size};
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+
+    auto preamble = make_preamble(options, reference != nullptr);
+    if (preamble.flags & preamble::progressive) {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        return compress_progressive<Profile>(data, static_size, preamble, raw_stream, cubes);
+    }
+    if (preamble.flags & preamble::fixed_rate) {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        std::vector<encoding_buffer<Profile>> scratch_buffers(1);
+        return compress_fixed_rate<Profile>(data, static_size, preamble, raw_stream, cubes, scratch_buffers);
+    }
+    if (preamble.flags & preamble::shaped_hypercubes) {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        std::vector<encoding_buffer<Profile>> scratch_buffers(1);
+        return compress_shaped<Profile>(data, static_size, preamble, options.level, raw_stream, cubes, scratch_buffers);
+    }
+    clear_hypercube_tables(preamble, raw_stream, num_hypercubes);
+    const auto means = means_table(preamble, raw_stream, num_hypercubes);
+    const auto bounds = bounds_table(preamble, raw_stream, num_hypercubes);
+    const auto selectors = predictor_table(preamble, raw_stream);
+    const auto dropped_bits = dropped_mantissa_bits<value_type>(preamble);
+    const auto quantizer = stream_quantizer<value_type>(preamble);
+    const auto verbatim = verbatim_table(preamble, raw_stream, num_hypercubes);
+    const auto checksums = checksum_table(preamble, raw_stream, num_hypercubes);
+    detail::stream<Profile> stream{num_hypercubes,
+            raw_stream + stream_prefix_length<bits_type>(preamble, num_hypercubes), header_marker_bits(preamble)};
+
+    const auto sources = preamble.flags & preamble::deduplicated
+            ? find_duplicate_hypercubes<Profile>(data, static_size, 1)
+            : std::vector<index_type>{};
+
+    uint64_t fingerprint = 0;
+    uint64_t offset = 0;
+    for_each_hypercube(static_size, [&](auto hc_offset, auto hc_index) {
+        if (!sources.empty() && sources[hc_index] != hc_index) {
+            *stream.hypercube(hc_index) = sources[hc_index];
+            check_stream_offset(++offset, stream.max_offset());
+            stream.set_offset_after(hc_index, static_cast<index_type>(offset));
+            stream.set_back_reference(hc_index);
+            if (checksums) {
+                checksums[hc_index]
+                        = hypercube_checksum<Profile>(stream.hypercube(hc_index), 1, hc_index, false, true);
+            }
+            return;
+        }
+        hypercube_summary<value_type> summary;
+        load_stream_hypercube<Profile>(hc_offset, hc_index, data, static_size, cube.data(), dropped_bits, quantizer,
+                verbatim, means || bounds ? &summary : nullptr);
+        write_hypercube_index_entry<Profile>(hc_index, summary, means, bounds);
+        if (reference) {
+            fingerprint ^= detail::cpu::subtract_reference<Profile>(
+                    hc_offset, hc_index, reference, static_size, cube.data(), reference_cube.data());
+        }
+        forward_transform<Profile>(cube.data(), hc_index, selectors);
+        if (predicts_leading_face<Profile>(hc_offset, preamble)) {
+            subtract_leading_face<Profile>(hc_offset, data, static_size, cube.data());
+        }
+        bool raw;
+        const auto length = encode_or_write_raw_hypercube<Profile>(hc_offset, data, static_size, cube.data(),
+                stream.hypercube(hc_index), options.level, scratch.data(), options.raw_fallback, raw);
+        if (checksums) {
+            checksums[hc_index] = hypercube_checksum<Profile>(stream.hypercube(hc_index), length, hc_index, raw, false);
+        }
+        offset += length;
+        check_stream_offset(offset, stream.max_offset());
+        stream.set_offset_after(hc_index, static_cast<index_type>(offset));
+        if (raw) { stream.set_raw(hc_index); }
+    });
+    copy_duplicate_index_entries(sources, means, bounds);
+
+    index_type border_length;
+    if (reference) {
+        border_length = detail::pack_border_residual(
+                stream.border(), data, reference, static_size, side_length, fingerprint);
+        preamble.reference_fingerprint = fingerprint;
+    } else {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        std::vector<encoding_buffer<Profile>> scratch_buffers(1);
+        border_length = pack_stream_border<Profile>(
+                preamble, stream.border(), data, static_size, options.level, cubes, scratch_buffers);
+    }
+    if (checksums) { checksums[num_hypercubes] = border_checksum(stream.border(), border_length, num_hypercubes); }
+    write_preamble(preamble, raw_stream);
+    return (stream.border() - raw_stream) + border_length;
+}
+
+template<typename Profile>
+index_type serial_compressor<Profile>::update(
+        const value_type *data, const extent &data_size, const std::vector<box> &dirty, bits_type *raw_stream) {
+    if (data_size.dimensions() != dimensions) {
+        throw std::runtime_error{"data dimensionality does not match compressor dimensionality"};
+    }
+
+    std::vector<cube_buffer<Profile>> cubes(1);
+    std::vector<encoding_buffer<Profile>> scratch_buffers(1);
+    return update_stream<Profile>(
+            data, detail::static_extent<dimensions>{data_size}, dirty, options, raw_stream, cubes, scratch_buffers);
+}
+
+
+template<typename Profile>
+class serial_decompressor : public decompressor<typename Profile::value_type> {
+  public:
+    using value_type = typename Profile::value_type;
+    using bounds_predicate = typename decompressor<value_type>::bounds_predicate;
+
+  private:
+    using bits_type = typename Profile::bits_type;
+
+    constexpr static auto dimensions = Profile::dimensions;
+    constexpr static auto side_length = Profile::hypercube_side_length;
+    constexpr static auto hc_size = detail::ipow(side_length, dimensions);
+
+    stream_options options;
+    detail::cpu::simd_aligned_buffer<bits_type> cube{hc_size};
+    detail::cpu::simd_aligned_buffer<bits_type> reference_cube{hc_size};
+    std::vector<encoding_buffer<Profile>> scratch_buffers = std::vector<encoding_buffer<Profile>>(1);
+
+  public:
+    explicit serial_decompressor(const stream_options &options = {}) : options(options) {
+        validate_stream_options<value_type>(options, dimensions);
+    }
+
+    index_type decompress(const bits_type *raw_stream, value_type *data, const extent &data_size) override {
+        return decode(raw_stream, nullptr, data, data_size, nullptr, nullptr);
+    }
+
+    index_type decompress(const bits_type *raw_stream, value_type *data, const extent &data_size,
+            array_statistics &statistics) override {
+        return decode(raw_stream, nullptr, data, data_size, &statistics, nullptr);
+    }
+
+    index_type decompress(const bits_type *raw_stream, const value_type *reference, value_type *data,
+            const extent &data_size) override {
+        return decode(raw_stream, reference, data, data_size, nullptr, nullptr);
+    }
+
+    index_type decompress_planes(const bits_type *raw_stream, unsigned num_planes, value_type *data,
+            const extent &data_size) override {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        return detail::cpu::decompress_planes<Profile>(raw_stream, num_planes, data, data_size, options, cubes);
+    }
+
+    index_type decompress_preview(const bits_type *raw_stream, unsigned factor, value_type *preview,
+            const extent &data_size) override {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        return detail::cpu::decompress_preview<Profile>(
+                raw_stream, factor, preview, data_size, options, cubes, scratch_buffers);
+    }
+
+    index_type decompress_where(const bits_type *raw_stream, const bounds_predicate &may_match, value_type *data,
+            const extent &data_size) override {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        return detail::cpu::decompress_where<Profile>(
+                raw_stream, may_match, data, data_size, options, cubes, scratch_buffers);
+    }
+
+    index_type decompress_region(const bits_type *raw_stream, const box &region, value_type *data,
+            const extent &data_size) override {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        return detail::cpu::decompress_region<Profile>(raw_stream, region, data, data_size, options, cubes,
+                scratch_buffers, [&](value_type *full) { return decompress(raw_stream, full, data_size); });
+    }
+
+    index_type decompress_fields(const bits_type *raw_stream, value_type *const *fields, index_type num_fields,
+            const extent &data_size) override {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        std::vector<cube_buffer<Profile>> primary_cubes(1);
+        return detail::cpu::decompress_fields<Profile>(
+                raw_stream, fields, num_fields, data_size, options, cubes, primary_cubes, scratch_buffers);
+    }
+
+    verification_result decompress_verified(
+            const bits_type *raw_stream, value_type *data, const extent &data_size) override {
+        if (!options.hypercube_checksums) {
+            throw std::invalid_argument{"verified decompression requires a decompressor for streams with checksums"};
+        }
+        verification_result result;
+        result.stream_length = decode(raw_stream, nullptr, data, data_size, nullptr, &result);
+        return result;
+    }
+
+  private:
+    index_type decode(const bits_type *raw_stream, const value_type *reference, value_type *data,
+            const extent &data_size, array_statistics *statistics, verification_result *verification);
+};
+
+template<typename Profile>
+index_type serial_decompressor<Profile>::decode(const bits_type *raw_stream, const value_type *reference,
+        value_type *data, const extent &data_size, array_statistics *statistics, verification_result *verification) {
+    if (data_size.dimensions() != dimensions) {
+        throw std::runtime_error{"data dimensionality does not match decompressor dimensionality"};
+    }
+
+    const auto static_size = detail::static_extent<dimensions>(data_size);
+    const auto num_hypercubes = detail::num_hypercubes(static_size);
+    std::vector<statistics_accumulator> thread_statistics(statistics ? 1 : 0);
+    const auto statistics_sink = statistics ? &thread_statistics : nullptr;
+
+    const auto preamble = read_stream_preamble(raw_stream, preamble_flags(options, reference != nullptr));
+    if (preamble.flags & (preamble::progressive | preamble::fixed_rate)) {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        const auto length = preamble.flags & preamble::progressive
+                ? decompress_progressive<Profile>(
+                        raw_stream, preamble, bits_of<bits_type>, data, static_size, cubes, statistics_sink)
+                : decompress_fixed_rate<Profile>(raw_stream, preamble, data, static_size, cubes, statistics_sink);
+        finish_statistics<Profile>(data, static_size, statistics_sink, statistics);
+        return length;
+    }
+    if (preamble.flags & preamble::shaped_hypercubes) {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        return decompress_shaped<Profile>(
+                raw_stream, preamble, options, data, static_size, cubes, scratch_buffers, statistics);
+    }
+    const auto selectors = predictor_table(preamble, raw_stream);
+    validate_predictor_table(selectors, num_hypercubes, dimensions);
+    const auto dropped_bits = dropped_mantissa_bits<value_type>(preamble);
+    const auto quantizer = stream_quantizer<value_type>(preamble);
+    const auto verbatim = verbatim_table(preamble, raw_stream, num_hypercubes);
+    detail::stream<const Profile> stream{num_hypercubes,
+            raw_stream + stream_prefix_length<bits_type>(preamble, num_hypercubes), header_marker_bits(preamble)};
+    const auto checksums = verification ? checksum_table(preamble, raw_stream, num_hypercubes) : nullptr;
+    std::vector<uint8_t> corrupt(checksums ? num_hypercubes : 0);
+
+    const bool entropy_coded = preamble.flags & preamble::entropy_coded;
+    const auto hc_statistics = statistics ? &thread_statistics[0] : nullptr;
+    uint64_t fingerprint = 0;
+    for_each_hypercube(static_size, [&](auto hc_offset, auto hc_index) {
+        // Hypercubes predicted from a corrupt predecessor cannot be restored either
+        if (checksums
+                && ((predicts_leading_face<Profile>(hc_offset, preamble) && corrupt[hc_index - 1])
+                        || !hypercube_intact(stream, checksums, hc_index))) {
+            corrupt[hc_index] = 1;
+            return;
+        }
+
+        // Duplicates are copied from their source, which has already been decoded
+        const auto source = encoding_source(stream, hc_index);
+        if (source != hc_index) {
+            const auto source_offset = extent_from_linear_id(source, static_size / side_length) * side_length;
+            copy_hypercube<Profile>(source_offset, hc_offset, data, static_size, hc_statistics);
+        } else if (stream.is_raw(hc_index)) {
+            read_raw_hypercube<Profile>(hc_offset, stream.hypercube(hc_index), stream.hypercube_size(hc_index), data,
+                    static_size, hc_statistics);
+        } else {
+            decode_hypercube<Profile>(stream.hypercube(hc_index), stream.hypercube_size(hc_index), cube.data(),
+                    entropy_coded, scratch_buffers[0]);
+            if (predicts_leading_face<Profile>(hc_offset, preamble)) {
+                add_leading_face<Profile>(hc_offset, data, static_size, cube.data());
+            }
+            inverse_transform<Profile>(cube.data(), hc_index, selectors);
+            if (reference) {
+                fingerprint ^= detail::cpu::add_reference<Profile>(
+                        hc_offset, hc_index, reference, static_size, cube.data(), reference_cube.data());
+            }
+            store_stream_hypercube<Profile>(hc_offset, hc_index, cube.data(), data, static_size, dropped_bits,
+                    quantizer, verbatim, hc_statistics);
+        }
+    });
+
+    if (checksums) {
+        verification->corrupt_hypercubes = corrupt_hypercube_indices(corrupt);
+        verification->corrupt_border = !border_intact(preamble, stream, checksums, static_size);
+        if (verification->corrupt_border) { return 0; }
+    }
+
+    index_type border_length;
+    if (reference) {
+        border_length = detail::unpack_border_residual(
+                data, reference, static_size, stream.border(), side_length, fingerprint);
+        check_reference_fingerprint(preamble, fingerprint);
+    } else {
+        std::vector<cube_buffer<Profile>> cubes(1);
+        border_length = unpack_stream_border<Profile>(
+                preamble, data, static_size, stream.border(), cubes, scratch_buffers);
+    }
+    finish_statistics<Profile>(data, static_size, statistics_sink, statistics);
+    return (stream.border() - raw_stream) + border_length;
+}
+
+extern template class serial_compressor<profile<float, 1>>;
+extern template class serial_compressor<profile<float, 2>>;
+extern template class serial_compressor<profile<float, 3>>;
+extern template class serial_compressor<profile<double, 1>>;
+extern template class serial_compressor<profile<double, 2>>;
+extern template class serial_compressor<profile<double, 3>>;
+
+extern template class serial_decompressor<profile<float, 1>>;
+extern template class serial_decompressor<profile<float, 2>>;
+extern template class serial_decompressor<profile<float, 3>>;
+extern template class serial_decompressor<profile<double, 1>>;
+extern template class serial_decompressor<profile<double, 2>>;
+extern template class serial_decompressor<profile<double, 3>>;
+
+#ifdef SPLIT_CONFIGURATION_cpu_encoder
+template class serial_compressor<profile<DATA_TYPE, DIMENSIONS>>;
+template class serial_decompressor<profile<DATA_TYPE, DIMENSIONS>>;
+#endif
+
+#if NDZIP_OPENMP_SUPPORT
+
+template<typename Profile>
+class openmp_compressor : public compressor<typename Profile::value_type> {
+  public:
+    using value_type = typename Profile::value_type;
+
+  private:
     using bits_type = typename Profile::bits_type;
 
     constexpr static auto dimensions = Profile::dimensions;
@@ -713,8 +4189,9 @@ class openmp_compressor : public compressor<typename Profile::value_type> {
 
     struct write_buffer {
         size_t first_hc_index = SIZE_MAX;
-        std::array<bits_type, Profile::compressed_block_length_bound * num_hcs_per_chunk> stream;
+        std::array<bits_type, Profile::entropy_coded_block_length_bound * num_hcs_per_chunk> stream;
         boost::container::static_vector<uint32_t, num_hcs_per_chunk> offsets_after_hcs;
+        std::bitset<num_hcs_per_chunk> raw_hcs;
 
         size_t num_hypercubes() const { return offsets_after_hcs.size(); }
 
@@ -728,13 +4205,18 @@ class openmp_compressor : public compressor<typename Profile::value_type> {
     };
 
     const unsigned num_threads;
+    stream_options options;
     std::vector<cube_buffer<Profile>> thread_cubes{num_threads};
+    std::vector<cube_buffer<Profile>> thread_reference_cubes{num_threads};
+    std::vector<encoding_buffer<Profile>> thread_scratch{num_threads};
     std::vector<write_buffer> write_buffers{num_write_buffers};
     std::priority_queue<write_buffer *, std::vector<write_buffer *>, hc_index_order> write_task_queue;
     boost::lockfree::queue<write_buffer *, boost::lockfree::capacity<num_write_buffers>> free_write_buffers;
 
   public:
-    explicit openmp_compressor(unsigned num_threads) : num_threads(num_threads) {
+    explicit openmp_compressor(unsigned num_threads, const stream_options &options = {})
+        : num_threads(num_threads), options(options) {
+        validate_stream_options<value_type>(options, dimensions);
         // priority_queue does not expose vector::reserve, push nonsense instead which will be
         // cleared by prepare()
         for (auto &wb : write_buffers) {
@@ -752,13 +4234,28 @@ class openmp_compressor : public compressor<typename Profile::value_type> {
         }
     }
 
-    index_type compress(const value_type *data, const extent &data_size, bits_type *stream) override;
+    index_type compress(const value_type *data, const extent &data_size, bits_type *stream) override {
+        return compress(data, nullptr, data_size, stream);
+    }
+
+    index_type compress(const value_type *data, const value_type *reference, const extent &data_size,
+            bits_type *stream) override;
+
+    index_type update(const value_type *data, const extent &data_size, const std::vector<box> &dirty,
+            bits_type *stream) override;
+
+    index_type compress_fields(const value_type *const *fields, index_type num_fields, const extent &data_size,
+            bits_type *stream) override {
+        return detail::cpu::compress_fields<Profile>(fields, num_fields, data_size, options, stream, thread_cubes,
+                thread_reference_cubes, thread_scratch);
+    }
 };
 
 template<typename Profile>
 class openmp_decompressor : public decompressor<typename Profile::value_type> {
   public:
     using value_type = typename Profile::value_type;
+    using bounds_predicate = typename decompressor<value_type>::bounds_predicate;
 
   private:
     using bits_type = typename Profile::bits_type;
@@ -768,18 +4265,79 @@ class openmp_decompressor : public decompressor<typename Profile::value_type> {
     constexpr static auto hc_size = detail::ipow(side_length, dimensions);
 
     const unsigned num_threads;
+    stream_options options;
     std::vector<cube_buffer<Profile>> thread_cubes{num_threads};
+    std::vector<cube_buffer<Profile>> thread_reference_cubes{num_threads};
+    std::vector<encoding_buffer<Profile>> thread_scratch{num_threads};
 
   public:
-    explicit openmp_decompressor(unsigned num_threads) : num_threads(num_threads) {}
+    explicit openmp_decompressor(unsigned num_threads, const stream_options &options = {})
+        : num_threads(num_threads), options(options) {
+        validate_stream_options<value_type>(options, dimensions);
+    }
+
+    index_type decompress(const bits_type *stream, value_type *data, const extent &data_size) override {
+        return decode(stream, nullptr, data, data_size, nullptr, nullptr);
+    }
+
+    index_type decompress(const bits_type *stream, value_type *data, const extent &data_size,
+            array_statistics &statistics) override {
+        return decode(stream, nullptr, data, data_size, &statistics, nullptr);
+    }
+
+    index_type decompress(const bits_type *stream, const value_type *reference, value_type *data,
+            const extent &data_size) override {
+        return decode(stream, reference, data, data_size, nullptr, nullptr);
+    }
+
+    index_type decompress_planes(const bits_type *stream, unsigned num_planes, value_type *data,
+            const extent &data_size) override {
+        return detail::cpu::decompress_planes<Profile>(stream, num_planes, data, data_size, options, thread_cubes);
+    }
+
+    index_type decompress_preview(const bits_type *stream, unsigned factor, value_type *preview,
+            const extent &data_size) override {
+        return detail::cpu::decompress_preview<Profile>(
+                stream, factor, preview, data_size, options, thread_cubes, thread_scratch);
+    }
+
+    index_type decompress_where(const bits_type *stream, const bounds_predicate &may_match, value_type *data,
+            const extent &data_size) override {
+        return detail::cpu::decompress_where<Profile>(
+                stream, may_match, data, data_size, options, thread_cubes, thread_scratch);
+    }
+
+    index_type decompress_region(
+            const bits_type *stream, const box &region, value_type *data, const extent &data_size) override {
+        return detail::cpu::decompress_region<Profile>(stream, region, data, data_size, options, thread_cubes,
+                thread_scratch, [&](value_type *full) { return decompress(stream, full, data_size); });
+    }
+
+    index_type decompress_fields(const bits_type *stream, value_type *const *fields, index_type num_fields,
+            const extent &data_size) override {
+        return detail::cpu::decompress_fields<Profile>(stream, fields, num_fields, data_size, options, thread_cubes,
+                thread_reference_cubes, thread_scratch);
+    }
+
+    verification_result decompress_verified(
+            const bits_type *stream, value_type *data, const extent &data_size) override {
+        if (!options.hypercube_checksums) {
+            throw std::invalid_argument{"verified decompression requires a decompressor for streams with checksums"};
+        }
+        verification_result result;
+        result.stream_length = decode(stream, nullptr, data, data_size, nullptr, &result);
+        return result;
+    }
 
-    index_type decompress(const bits_type *stream, value_type *data, const extent &data_size) override;
+  private:
+    index_type decode(const bits_type *stream, const value_type *reference, value_type *data,
+            const extent &data_size, array_statistics *statistics, verification_result *verification);
 };
 
 
 template<typename Profile>
-index_type
-openmp_compressor<Profile>::compress(const value_type *data, const extent &data_size, bits_type *raw_stream) {
+index_type openmp_compressor<Profile>::compress(
+        const value_type *data, const value_type *reference, const extent &data_size, bits_type *raw_stream) {
     if (data_size.dimensions() != dimensions) {
         throw std::runtime_error{"data dimensionality does not match compressor dimensionality"};
     }
@@ -789,12 +4347,37 @@ openmp_compressor<Profile>::compress(const value_type *data, const extent &data_
     const auto static_size = detail::static_extent<dimensions>{data_size};
     const auto num_hypercubes = detail::num_hypercubes(static_size);
 
-    detail::stream<Profile> stream{num_hypercubes, raw_stream};
+    auto preamble = make_preamble(options, reference != nullptr);
+    if (preamble.flags & preamble::progressive) {
+        return compress_progressive<Profile>(data, static_size, preamble, raw_stream, thread_cubes);
+    }
+    if (preamble.flags & preamble::fixed_rate) {
+        return compress_fixed_rate<Profile>(data, static_size, preamble, raw_stream, thread_cubes, thread_scratch);
+    }
+    if (preamble.flags & preamble::shaped_hypercubes) {
+        return compress_shaped<Profile>(
+                data, static_size, preamble, options.level, raw_stream, thread_cubes, thread_scratch);
+    }
+    clear_hypercube_tables(preamble, raw_stream, num_hypercubes);
+    const auto means = means_table(preamble, raw_stream, num_hypercubes);
+    const auto bounds = bounds_table(preamble, raw_stream, num_hypercubes);
+    const auto selectors = predictor_table(preamble, raw_stream);
+    const auto dropped_bits = dropped_mantissa_bits<value_type>(preamble);
+    const auto quantizer = stream_quantizer<value_type>(preamble);
+    const auto verbatim = verbatim_table(preamble, raw_stream, num_hypercubes);
+    const auto checksums = checksum_table(preamble, raw_stream, num_hypercubes);
+    detail::stream<Profile> stream{num_hypercubes,
+            raw_stream + stream_prefix_length<bits_type>(preamble, num_hypercubes), header_marker_bits(preamble)};
+    std::vector<uint64_t> thread_fingerprints(num_threads);
+    const auto sources = preamble.flags & preamble::deduplicated
+            ? find_duplicate_hypercubes<Profile>(data, static_size, static_cast<int>(num_threads))
+            : std::vector<index_type>{};
+    const auto is_duplicate = [&](size_t hc_index) { return !sources.empty() && sources[hc_index] != hc_index; };
 
     std::atomic<size_t> next_hc_index_to_read = 0;
     std::atomic<size_t> next_hc_index_to_write = 0;
     std::atomic<size_t> next_available_write_task_hc_index = SIZE_MAX;
-    index_type stream_offset = 0;
+    uint64_t stream_offset = 0;  // checked after the parallel region, which exceptions cannot leave
 
 #pragma omp parallel num_threads(num_threads)
 #pragma omp single nowait
@@ -802,6 +4385,7 @@ openmp_compressor<Profile>::compress(const value_type *data, const extent &data_
 #pragma omp task firstprivate(tid)
     {
         auto &cube = thread_cubes[tid];
+        auto &reference_cube = thread_reference_cubes[tid];
 
         // memory_order_relaxed: we only depend on next_hc_index_to_write for correctness and modify
         // it inside a critical section; outside, we can tolerate missed updates (the loop can
@@ -834,7 +4418,9 @@ openmp_compressor<Profile>::compress(const value_type *data, const extent &data_
                 for (size_t task_hc_index = 0; task_hc_index < write_task->num_hypercubes(); ++task_hc_index) {
                     auto hc_index = write_task->first_hc_index + task_hc_index;
                     task_file_offset = task_stream_offset + write_task->offsets_after_hcs[task_hc_index];
-                    stream.set_offset_after(hc_index, task_file_offset);
+                    stream.set_offset_after(hc_index, static_cast<index_type>(task_file_offset));
+                    if (is_duplicate(hc_index)) { stream.set_back_reference(hc_index); }
+                    if (write_task->raw_hcs[task_hc_index]) { stream.set_raw(hc_index); }
                 }
                 memcpy(stream.hypercube(write_task->first_hc_index), write_task->stream.data(),
                         write_task->compressed_size() * sizeof(bits_type));
@@ -851,21 +4437,47 @@ openmp_compressor<Profile>::compress(const value_type *data, const extent &data_
                     if (first_hc_index < num_hypercubes) {
                         write_task->first_hc_index = first_hc_index;
                         write_task->offsets_after_hcs.clear();
+                        write_task->raw_hcs.reset();
                         for (size_t task_hc_index = 0;
                                 task_hc_index + first_hc_index < num_hypercubes && task_hc_index < num_hcs_per_chunk;
                                 ++task_hc_index) {
                             auto hc_index = first_hc_index + task_hc_index;
+                            if (is_duplicate(hc_index)) {
+                                write_task->stream[task_stream_offset] = sources[hc_index];
+                                if (checksums) {
+                                    checksums[hc_index] = hypercube_checksum<Profile>(
+                                            write_task->stream.data() + task_stream_offset, 1, hc_index, false, true);
+                                }
+                                write_task->offsets_after_hcs.push_back(++task_stream_offset);
+                                continue;
+                            }
                             auto hc_offset
                                     = detail::extent_from_linear_id(hc_index, static_size / side_length) * side_length;
-                            detail::cpu::load_hypercube<Profile>(hc_offset, data, static_size, cube.data());
-                            detail::cpu::block_transform<Profile>(cube.data());
-
-                            task_stream_offset += detail::cpu::zero_bit_encode<bits_type>(cube.data(),
-                                                          reinterpret_cast<std::byte *>(write_task->stream.data())
-                                                                  + task_stream_offset * sizeof(bits_type),
-                                                          hc_size)
-                                    / sizeof(bits_type);
+                            hypercube_summary<value_type> summary;
+                            load_stream_hypercube<Profile>(hc_offset, hc_index, data, static_size, cube.data(),
+                                    dropped_bits, quantizer, verbatim, means || bounds ? &summary : nullptr);
+                            write_hypercube_index_entry<Profile>(hc_index, summary, means, bounds);
+                            if (reference) {
+                                thread_fingerprints[tid] ^= detail::cpu::subtract_reference<Profile>(hc_offset,
+                                        hc_index, reference, static_size, cube.data(), reference_cube.data());
+                            }
+                            forward_transform<Profile>(cube.data(), hc_index, selectors);
+                            if (predicts_leading_face<Profile>(hc_offset, preamble)) {
+                                subtract_leading_face<Profile>(hc_offset, data, static_size, cube.data());
+                            }
+
+                            bool raw;
+                            const auto encoding = write_task->stream.data() + task_stream_offset;
+                            const auto length = encode_or_write_raw_hypercube<Profile>(hc_offset, data, static_size,
+                                    cube.data(), encoding, options.level, thread_scratch[tid].data(),
+                                    options.raw_fallback, raw);
+                            if (checksums) {
+                                checksums[hc_index]
+                                        = hypercube_checksum<Profile>(encoding, length, hc_index, raw, false);
+                            }
+                            task_stream_offset += length;
                             write_task->offsets_after_hcs.push_back(task_stream_offset);
+                            write_task->raw_hcs[task_hc_index] = raw;
                         }
 
 #pragma omp critical(queue)
@@ -881,15 +4493,42 @@ openmp_compressor<Profile>::compress(const value_type *data, const extent &data_
             }
         }
     }
+    check_stream_offset(stream_offset, stream.max_offset());
+    copy_duplicate_index_entries(sources, means, bounds);
+
+    index_type border_length;
+    if (reference) {
+        uint64_t fingerprint = 0;
+        for (auto f : thread_fingerprints) {
+            fingerprint ^= f;
+        }
+        border_length = pack_border_parallel<Profile>(
+                stream.border(), data, reference, static_size, static_cast<int>(num_threads), fingerprint);
+        preamble.reference_fingerprint = fingerprint;
+    } else {
+        border_length = pack_stream_border<Profile>(
+                preamble, stream.border(), data, static_size, options.level, thread_cubes, thread_scratch);
+    }
+    if (checksums) { checksums[num_hypercubes] = border_checksum(stream.border(), border_length, num_hypercubes); }
+    write_preamble(preamble, raw_stream);
+    return (stream.border() - raw_stream) + border_length;
+}
+
+template<typename Profile>
+index_type openmp_compressor<Profile>::update(
+        const value_type *data, const extent &data_size, const std::vector<box> &dirty, bits_type *raw_stream) {
+    if (data_size.dimensions() != dimensions) {
+        throw std::runtime_error{"data dimensionality does not match compressor dimensionality"};
+    }
 
-    const auto border_length = detail::pack_border(stream.border(), data, static_size, side_length);
-    return (stream.border() - stream.buffer) + border_length;
+    return update_stream<Profile>(data, detail::static_extent<dimensions>{data_size}, dirty, options, raw_stream,
+            thread_cubes, thread_scratch);
 }
 
 
 template<typename Profile>
-index_type
-openmp_decompressor<Profile>::decompress(const bits_type *raw_stream, value_type *data, const extent &data_size) {
+index_type openmp_decompressor<Profile>::decode(const bits_type *raw_stream, const value_type *reference,
+        value_type *data, const extent &data_size, array_statistics *statistics, verification_result *verification) {
     if (data_size.dimensions() != dimensions) {
         throw std::runtime_error{"data dimensionality does not match decompressor dimensionality"};
     }
@@ -898,28 +4537,131 @@ openmp_decompressor<Profile>::decompress(const bits_type *raw_stream, value_type
 
     const auto static_size = detail::static_extent<dimensions>{data_size};
     const auto num_hypercubes = detail::num_hypercubes(static_size);
-
-    detail::stream<const Profile> stream{num_hypercubes, raw_stream};
-
+    std::vector<statistics_accumulator> thread_statistics(statistics ? num_threads : 0);
+    const auto statistics_sink = statistics ? &thread_statistics : nullptr;
+
+    const auto preamble = read_stream_preamble(raw_stream, preamble_flags(options, reference != nullptr));
+    if (preamble.flags & (preamble::progressive | preamble::fixed_rate)) {
+        const auto length = preamble.flags & preamble::progressive
+                ? decompress_progressive<Profile>(
+                        raw_stream, preamble, bits_of<bits_type>, data, static_size, thread_cubes, statistics_sink)
+                : decompress_fixed_rate<Profile>(
+                        raw_stream, preamble, data, static_size, thread_cubes, statistics_sink);
+        finish_statistics<Profile>(data, static_size, statistics_sink, statistics);
+        return length;
+    }
+    if (preamble.flags & preamble::shaped_hypercubes) {
+        return decompress_shaped<Profile>(
+                raw_stream, preamble, options, data, static_size, thread_cubes, thread_scratch, statistics);
+    }
+    const auto selectors = predictor_table(preamble, raw_stream);
+    validate_predictor_table(selectors, num_hypercubes, dimensions);
+    const auto dropped_bits = dropped_mantissa_bits<value_type>(preamble);
+    const auto quantizer = stream_quantizer<value_type>(preamble);
+    const auto verbatim = verbatim_table(preamble, raw_stream, num_hypercubes);
+    detail::stream<const Profile> stream{num_hypercubes,
+            raw_stream + stream_prefix_length<bits_type>(preamble, num_hypercubes), header_marker_bits(preamble)};
+
+    const bool entropy_coded = preamble.flags & preamble::entropy_coded;
+    const auto checksums = verification ? checksum_table(preamble, raw_stream, num_hypercubes) : nullptr;
+    std::vector<uint8_t> corrupt(checksums ? num_hypercubes : 0);
+    const bool corrupt_border = checksums && !border_intact(preamble, stream, checksums, static_size);
+
+    // The header locates a raw border up front, so threads expand it once they run out of hypercubes. A padded border
+    // is decoded by a second parallel pass.
+    const auto border = stream.border();
+    const bool padded_border = preamble.flags & preamble::padded_border;
+    const bool overlap_border = !corrupt_border && (!padded_border || border[0] == raw_border);
+    const auto raw_border_values = padded_border ? border + 1 : border;
+    const auto chunks
+            = overlap_border ? make_border_chunks<Profile>(static_size, reference == nullptr) : border_chunks{};
+    uint64_t border_hash = 0;
+
+    uint64_t fingerprint = 0;
+    std::exception_ptr exception;
 #pragma omp parallel num_threads(num_threads)
     {
         auto tid = omp_get_thread_num();
         auto &cube = thread_cubes[tid];
+        auto &reference_cube = thread_reference_cubes[tid];
+        const auto hc_statistics = statistics ? &thread_statistics[tid] : nullptr;
+
+        // A chain of cross-predicted hypercubes is decoded in order by the thread owning its first hypercube
+#pragma omp for schedule(static) nowait reduction(^ : fingerprint)
+        for (size_t head = 0; head < num_hypercubes; ++head) {
+            const auto head_offset = detail::extent_from_linear_id(head, static_size / side_length) * side_length;
+            if (predicts_leading_face<Profile>(head_offset, preamble)) { continue; }
+            const auto chain_end = head + 1 + chain_successors<Profile>(head, static_size, preamble);
+
+            for (auto hc_index = static_cast<index_type>(head); hc_index < chain_end; ++hc_index) {
+                auto hc_offset = detail::extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+
+                // Hypercubes predicted from a corrupt predecessor cannot be restored either
+                if (checksums
+                        && ((hc_index != head && corrupt[hc_index - 1])
+                                || !hypercube_intact(stream, checksums, hc_index))) {
+                    corrupt[hc_index] = 1;
+                    continue;
+                }
 
-#pragma omp for schedule(static) nowait
-        for (size_t hc_index = 0; hc_index < num_hypercubes; ++hc_index) {
-            auto hc_offset = detail::extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+                // exceptions must not escape the parallel region. Duplicates decode the encoding of their source,
+                // which may not have been decoded yet by another thread.
+                index_type source;
+                bool raw;
+                try {
+                    source = encoding_source(stream, hc_index);
+                    raw = stream.is_raw(source);
+                    if (raw) {
+                        read_raw_hypercube<Profile>(hc_offset, stream.hypercube(source),
+                                stream.hypercube_size(source), data, static_size, hc_statistics);
+                    } else {
+                        decode_hypercube<Profile>(stream.hypercube(source), stream.hypercube_size(source),
+                                cube.data(), entropy_coded, thread_scratch[tid]);
+                    }
+                } catch (...) {
+#pragma omp critical(exception)
+                    if (!exception) { exception = std::current_exception(); }
+                    break;
+                }
+                if (!raw) {
+                    if (hc_index != head) { add_leading_face<Profile>(hc_offset, data, static_size, cube.data()); }
+                    inverse_transform<Profile>(cube.data(), source, selectors);
+                    if (reference) {
+                        fingerprint ^= detail::cpu::add_reference<Profile>(
+                                hc_offset, hc_index, reference, static_size, cube.data(), reference_cube.data());
+                    }
+                    store_stream_hypercube<Profile>(hc_offset, source, cube.data(), data, static_size, dropped_bits,
+                            quantizer, verbatim, hc_statistics);
+                }
+            }
+        }
 
-            detail::cpu::zero_bit_decode<bits_type>(
-                    reinterpret_cast<const std::byte *>(stream.hypercube(hc_index)), cube.data(), hc_size);
-            detail::cpu::inverse_block_transform<Profile>(cube.data());
-            detail::cpu::store_hypercube<Profile>(hc_offset, cube.data(), data, static_size);
+#pragma omp for schedule(dynamic) nowait reduction(^ : border_hash)
+        for (size_t c = 0; c < chunks.num_chunks(); ++c) {
+            border_hash ^= unpack_border_chunk<Profile>(chunks, c, data, raw_border_values, reference);
         }
     }
+    if (exception) { std::rethrow_exception(exception); }
+
+    if (checksums) {
+        verification->corrupt_hypercubes = corrupt_hypercube_indices(corrupt);
+        verification->corrupt_border = corrupt_border;
+        if (corrupt_border) { return 0; }
+    }
 
-    const auto border_length
-            = detail::unpack_border(data, static_size, stream.border(), Profile::hypercube_side_length);
-    return (stream.border() - stream.buffer) + border_length;
+    index_type border_length;
+    if (overlap_border) {
+        border_length = static_cast<index_type>(raw_border_values - border) + chunks.length;
+    } else {
+        border_length = unpack_padded_border<Profile>(data, static_size, border, entropy_coded, thread_cubes,
+                thread_scratch);
+    }
+    if (reference) {
+        fingerprint ^= border_hash;
+        check_reference_fingerprint(preamble, fingerprint);
+    }
+    finish_statistics<Profile>(data, static_size, statistics_sink, statistics);
+    return (stream.border() - raw_stream) + border_length;
 }
 
 extern template class openmp_compressor<profile<float, 1>>;
@@ -1,5 +1,8 @@
 #include "cpu_codec.inl"
 
+#include <chrono>
+#include <random>
+
 
 namespace ndzip::detail::cpu {
 
@@ -18,18 +21,14 @@ inline unsigned get_final_num_threads(const unsigned user_preference) {
 #endif
 }
 
-}  // namespace ndzip::detail::cpu
-
-namespace ndzip {
-
 template<typename T>
-std::unique_ptr<compressor<T>> make_compressor(dim_type dims, unsigned num_threads) {
-    num_threads = detail::cpu::get_final_num_threads(num_threads);
+std::unique_ptr<compressor<T>>
+make_codec_compressor(dim_type dims, unsigned num_threads, const stream_options &options) {
     if (num_threads == 1) {
-        return detail::make_with_profile<compressor, detail::cpu::serial_compressor, T>(dims);
+        return make_with_profile<compressor, serial_compressor, T>(dims, options);
     } else {
 #if NDZIP_OPENMP_SUPPORT
-        return detail::make_with_profile<compressor, detail::cpu::openmp_compressor, T>(dims, num_threads);
+        return make_with_profile<compressor, openmp_compressor, T>(dims, num_threads, options);
 #else
         abort();  // unreachable
 #endif
@@ -37,19 +36,285 @@ std::unique_ptr<compressor<T>> make_compressor(dim_type dims, unsigned num_threa
 }
 
 template<typename T>
-std::unique_ptr<decompressor<T>> make_decompressor(dim_type dims, unsigned num_threads) {
-    num_threads = detail::cpu::get_final_num_threads(num_threads);
+std::unique_ptr<decompressor<T>>
+make_codec_decompressor(dim_type dims, unsigned num_threads, const stream_options &options) {
     if (num_threads == 1) {
-        return detail::make_with_profile<decompressor, detail::cpu::serial_decompressor, T>(dims);
+        return make_with_profile<decompressor, serial_decompressor, T>(dims, options);
     } else {
 #if NDZIP_OPENMP_SUPPORT
-        return detail::make_with_profile<decompressor, detail::cpu::openmp_decompressor, T>(dims, num_threads);
+        return make_with_profile<decompressor, openmp_decompressor, T>(dims, num_threads, options);
 #else
         abort();  // unreachable
 #endif
     }
 }
 
+// Codecs of every dimensionality an array can be folded to, created on first use
+template<template<typename> typename Codec, typename T>
+class folded_codecs {
+  public:
+    using make_function = std::unique_ptr<Codec<T>> (*)(dim_type, unsigned, const stream_options &);
+
+    folded_codecs(make_function make, dim_type dims, unsigned num_threads, const stream_options &options)
+        : _make{make}, _dims{dims}, _num_threads{num_threads}, _options{options} {
+        auto codec = make(dims, num_threads, options);
+        _codecs[dims - 1] = std::move(codec);
+    }
+
+    // Codec for arrays of the dimensionality passed on construction
+    Codec<T> &get() { return *_codecs[_dims - 1]; }
+
+    Codec<T> &get(dim_type dims) {
+        auto &codec = _codecs[dims - 1];
+        if (!codec) { codec = _make(dims, _num_threads, _options); }
+        return *codec;
+    }
+
+  private:
+    make_function _make;
+    dim_type _dims;
+    unsigned _num_threads;
+    stream_options _options;
+    std::array<std::unique_ptr<Codec<T>>, max_dimensionality> _codecs;
+};
+
+template<typename T>
+class folding_compressor final : public compressor<T> {
+  public:
+    using value_type = T;
+    using compressed_type = detail::bits_type<T>;
+
+    explicit folding_compressor(dim_type dims, unsigned num_threads, const stream_options &options)
+        : _codecs{make_codec_compressor<T>, dims, num_threads, options} {}
+
+    index_type compress(const value_type *data, const extent &data_size, compressed_type *stream) override {
+        return compress(data, nullptr, data_size, stream);
+    }
+
+    index_type compress(const value_type *data, const value_type *reference, const extent &data_size,
+            compressed_type *stream) override {
+        const auto folding = fold_dimensions(data_size);
+        if (!folding) { return _codecs.get().compress(data, reference, data_size, stream); }
+        const auto length = write_preamble(make_folded_preamble(folding->folded_size), stream);
+        return length
+                + _codecs.get(folding->folded_size.dimensions())
+                          .compress(data, reference, folding->folded_size, stream + length);
+    }
+
+    index_type update(const value_type *data, const extent &data_size, const std::vector<box> &dirty,
+            compressed_type *stream) override {
+        const auto folding = fold_dimensions(data_size);
+        if (!folding) { return _codecs.get().update(data, data_size, dirty, stream); }
+        const auto length = read_folded_preamble(stream, *folding);
+        return length
+                + _codecs.get(folding->folded_size.dimensions())
+                          .update(data, folding->folded_size, fold_dirty_boxes(*folding, data_size, dirty),
+                                  stream + length);
+    }
+
+    index_type compress_fields(const value_type *const *fields, index_type num_fields, const extent &data_size,
+            compressed_type *stream) override {
+        const auto folding = fold_dimensions(data_size);
+        if (!folding) {
+            return _codecs.get().compress_fields(fields, num_fields, data_size, stream);
+        }
+        const auto length = write_preamble(make_folded_preamble(folding->folded_size), stream);
+        return length
+                + _codecs.get(folding->folded_size.dimensions())
+                          .compress_fields(fields, num_fields, folding->folded_size, stream + length);
+    }
+
+    static index_type read_folded_preamble(const compressed_type *stream, const dimension_folding &folding) {
+        const auto preamble = read_preamble(stream);
+        if (preamble.flags != preamble::folded) {
+            throw std::runtime_error{"stream was not compressed with folded dimensions"};
+        }
+        if (stream_folded_extent(preamble) != folding.folded_size) {
+            throw std::runtime_error{"stream was folded to a different extent"};
+        }
+        return preamble_length<compressed_type>(preamble);
+    }
+
+  private:
+    folded_codecs<compressor, T> _codecs;
+};
+
+template<typename T>
+class folding_decompressor final : public decompressor<T> {
+  public:
+    using value_type = T;
+    using compressed_type = detail::bits_type<T>;
+    using typename decompressor<T>::bounds_predicate;
+
+    explicit folding_decompressor(dim_type dims, unsigned num_threads, const stream_options &options)
+        : _codecs{make_codec_decompressor<T>, dims, num_threads, options} {}
+
+    index_type decompress(const compressed_type *stream, value_type *data, const extent &data_size) override {
+        return with_folding(stream, data_size, [&](auto &de, const compressed_type *s, const extent &size) {
+            return de.decompress(s, data, size);
+        });
+    }
+
+    index_type decompress(const compressed_type *stream, value_type *data, const extent &data_size,
+            array_statistics &statistics) override {
+        return with_folding(stream, data_size, [&](auto &de, const compressed_type *s, const extent &size) {
+            return de.decompress(s, data, size, statistics);
+        });
+    }
+
+    index_type decompress(const compressed_type *stream, const value_type *reference, value_type *data,
+            const extent &data_size) override {
+        return with_folding(stream, data_size, [&](auto &de, const compressed_type *s, const extent &size) {
+            return de.decompress(s, reference, data, size);
+        });
+    }
+
+    index_type decompress_planes(const compressed_type *stream, unsigned num_planes, value_type *data,
+            const extent &data_size) override {
+        return _codecs.get().decompress_planes(stream, num_planes, data, data_size);
+    }
+
+    index_type decompress_preview(const compressed_type *stream, unsigned factor, value_type *preview,
+            const extent &data_size) override {
+        if (fold_dimensions(data_size)) {
+            throw std::invalid_argument{"previews are not supported for streams with folded dimensions"};
+        }
+        return _codecs.get().decompress_preview(stream, factor, preview, data_size);
+    }
+
+    index_type decompress_where(const compressed_type *stream, const bounds_predicate &may_match,
+            value_type *data, const extent &data_size) override {
+        // Returns the number of decoded hypercubes, not a stream length
+        const auto folding = fold_dimensions(data_size);
+        if (!folding) { return _codecs.get().decompress_where(stream, may_match, data, data_size); }
+        const auto length = folding_compressor<T>::read_folded_preamble(stream, *folding);
+        return _codecs.get(folding->folded_size.dimensions())
+                .decompress_where(stream + length, may_match, data, folding->folded_size);
+    }
+
+    index_type decompress_region(const compressed_type *stream, const box &region, value_type *data,
+            const extent &data_size) override {
+        if (!fold_dimensions(data_size)) { return _codecs.get().decompress_region(stream, region, data, data_size); }
+        // The region is not a box in the folded array, which is decompressed in full instead
+        validate_region(region, data_size);
+        std::vector<value_type> full(num_elements(data_size));
+        const auto stream_length = decompress(stream, full.data(), data_size);
+        copy_block_to_region(full.data(), extent(data_size.dimensions()), data_size, region, data);
+        return stream_length;
+    }
+
+    index_type decompress_fields(const compressed_type *stream, value_type *const *fields, index_type num_fields,
+            const extent &data_size) override {
+        return with_folding(stream, data_size, [&](auto &de, const compressed_type *s, const extent &size) {
+            return de.decompress_fields(s, fields, num_fields, size);
+        });
+    }
+
+    verification_result decompress_verified(
+            const compressed_type *stream, value_type *data, const extent &data_size) override {
+        const auto folding = fold_dimensions(data_size);
+        if (!folding) { return _codecs.get().decompress_verified(stream, data, data_size); }
+        const auto length = folding_compressor<T>::read_folded_preamble(stream, *folding);
+        auto result = _codecs.get(folding->folded_size.dimensions())
+                              .decompress_verified(stream + length, data, folding->folded_size);
+        if (!result.corrupt_border) { result.stream_length += length; }
+        return result;
+    }
+
+  private:
+    folded_codecs<decompressor, T> _codecs;
+
+    template<typename F>
+    index_type with_folding(const compressed_type *stream, const extent &data_size, const F &decode) {
+        const auto folding = fold_dimensions(data_size);
+        if (!folding) { return decode(_codecs.get(), stream, data_size); }
+        const auto length = folding_compressor<T>::read_folded_preamble(stream, *folding);
+        return length + decode(_codecs.get(folding->folded_size.dimensions()), stream + length, folding->folded_size);
+    }
+};
+
+// Locates the stream of an archive variable after checking its frame header against the directory entry
+template<typename T>
+const compressed_type<T> *variable_stream(const void *archive, const archive_variable &variable) {
+    const auto &header = variable.header;
+    if (header.type != element_type_of<T>) {
+        throw std::invalid_argument{"archive variable " + variable.name + " is not of this element type"};
+    }
+    const auto frame = static_cast<const std::byte *>(archive) + variable.offset;
+    const auto stored = read_frame_header(frame, frame_header_size);
+    if (stored.type != header.type || stored.data_size != header.data_size
+            || stored.stream_length != header.stream_length) {
+        throw std::runtime_error{"archive variable " + variable.name + " does not match its directory entry"};
+    }
+    return reinterpret_cast<const compressed_type<T> *>(frame + frame_header_size);
+}
+
+template<typename T>
+void check_variable_stream_length(const archive_variable &variable, index_type stream_length) {
+    if (stream_length * sizeof(compressed_type<T>) != variable.header.stream_length) {
+        throw std::runtime_error{"archive variable " + variable.name + " has an invalid stream length"};
+    }
+}
+
+}  // namespace ndzip::detail::cpu
+
+namespace ndzip {
+
+template<typename T>
+std::unique_ptr<compressor<T>> make_compressor(dim_type dims, unsigned num_threads, const stream_options &options) {
+    num_threads = detail::cpu::get_final_num_threads(num_threads);
+    if (options.fold_dimensions) {
+        return std::make_unique<detail::cpu::folding_compressor<T>>(dims, num_threads, options);
+    }
+    return detail::cpu::make_codec_compressor<T>(dims, num_threads, options);
+}
+
+template<typename T>
+std::unique_ptr<decompressor<T>>
+make_decompressor(dim_type dims, unsigned num_threads, const stream_options &options) {
+    num_threads = detail::cpu::get_final_num_threads(num_threads);
+    if (options.fold_dimensions) {
+        return std::make_unique<detail::cpu::folding_decompressor<T>>(dims, num_threads, options);
+    }
+    return detail::cpu::make_codec_decompressor<T>(dims, num_threads, options);
+}
+
+template<typename T>
+std::unique_ptr<decompressor<T>> make_decompressor(const frame_header &header, unsigned num_threads) {
+    if (header.type != element_type_of<T>) {
+        throw std::invalid_argument{"frame header does not describe a stream of this element type"};
+    }
+    return make_decompressor<T>(header.data_size.dimensions(), num_threads, header.options);
+}
+
+template<typename T>
+void extract_variable(const void *archive, const archive_variable &variable, T *data, unsigned num_threads) {
+    const auto stream = detail::cpu::variable_stream<T>(archive, variable);
+    const auto &header = variable.header;
+    detail::cpu::check_variable_stream_length<T>(
+            variable, make_decompressor<T>(header, num_threads)->decompress(stream, data, header.data_size));
+}
+
+template<typename T>
+void extract_region(
+        const void *archive, const archive_variable &variable, const box &region, T *data, unsigned num_threads) {
+    const auto stream = detail::cpu::variable_stream<T>(archive, variable);
+    const auto &header = variable.header;
+    detail::cpu::check_variable_stream_length<T>(variable,
+            make_decompressor<T>(header, num_threads)->decompress_region(stream, region, data, header.data_size));
+}
+
+template std::unique_ptr<compressor<float>> make_compressor<float>(dim_type, unsigned, const stream_options &);
+template std::unique_ptr<compressor<double>> make_compressor<double>(dim_type, unsigned, const stream_options &);
+template std::unique_ptr<decompressor<float>> make_decompressor<float>(dim_type, unsigned, const stream_options &);
+template std::unique_ptr<decompressor<double>> make_decompressor<double>(dim_type, unsigned, const stream_options &);
+template std::unique_ptr<decompressor<float>> make_decompressor<float>(const frame_header &, unsigned);
+template std::unique_ptr<decompressor<double>> make_decompressor<double>(const frame_header &, unsigned);
+template void extract_variable<float>(const void *, const archive_variable &, float *, unsigned);
+template void extract_variable<double>(const void *, const archive_variable &, double *, unsigned);
+template void extract_region<float>(const void *, const archive_variable &, const box &, float *, unsigned);
+template void extract_region<double>(const void *, const archive_variable &, const box &, double *, unsigned);
+
 }  // namespace ndzip
 namespace ndzip::detail::cpu {
 
@@ -61,37 +326,219 @@ class cpu_offloader final : public offloader<T> {
 
     cpu_offloader() = default;
 
-    explicit cpu_offloader(dim_type dims, unsigned num_threads)
-        : _co{make_compressor<T>(dims, num_threads)}, _de{make_decompressor<T>(dims, num_threads)} {}
+    explicit cpu_offloader(dim_type dims, unsigned num_threads, const stream_options &options)
+        : _co{make_compressor<T>(dims, num_threads, options)}
+        , _de{make_decompressor<T>(dims, num_threads, options)} {}
 
   protected:
     index_type do_compress(const value_type *data, const extent &data_size, compressed_type *stream,
             kernel_duration *duration) override {
-        // TODO duration
-        return _co->compress(data, data_size, stream);
+        return timed(duration, [&] { return _co->compress(data, data_size, stream); });
     }
 
     index_type do_decompress(const compressed_type *stream, [[maybe_unused]] index_type stream_length, value_type *data,
             const extent &data_size, kernel_duration *duration) override {
-        // TODO duration
-        return _de->decompress(stream, data, data_size);
+        return timed(duration, [&] { return _de->decompress(stream, data, data_size); });
     }
 
   private:
     std::unique_ptr<compressor<T>> _co;
     std::unique_ptr<decompressor<T>> _de;
+
+    template<typename F>
+    static index_type timed(kernel_duration *duration, const F &f) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = f();
+        if (duration) {
+            *duration = std::chrono::duration_cast<kernel_duration>(std::chrono::steady_clock::now() - start);
+        }
+        return result;
+    }
+};
+
+}  // namespace ndzip::detail::cpu
+
+namespace ndzip {
+
+template<typename T>
+std::unique_ptr<offloader<T>> make_cpu_offloader(dim_type dims, unsigned num_threads, const stream_options &options) {
+    return std::make_unique<detail::cpu::cpu_offloader<T>>(dims, num_threads, options);
+}
+
+template std::unique_ptr<offloader<float>> make_cpu_offloader<float>(dim_type, unsigned, const stream_options &);
+template std::unique_ptr<offloader<double>> make_cpu_offloader<double>(dim_type, unsigned, const stream_options &);
+
+}  // namespace ndzip
+
+namespace ndzip::detail::cpu {
+
+// Hypercubes drawn from an array for tuning, stacked along the outermost dimension so that they are compressed as the
+// hypercubes of a smaller array
+template<typename T>
+struct tuning_sample {
+    std::vector<T> values;
+    extent size;
+    index_type covered_values = 0;  // number of values of the array that lie in hypercubes
 };
 
+// Draws one hypercube of shape hc_shape from each of an equal number of strata of the hypercube index range
+template<typename T>
+tuning_sample<T> sample_hypercubes(
+        const T *data, const extent &data_size, const extent &hc_shape, double sample_fraction, std::mt19937 &rng) {
+    constexpr index_type min_samples = 16;
+
+    const auto dims = data_size.dimensions();
+    extent grid(dims);
+    index_type num_hypercubes = 1;
+    for (dim_type d = 0; d < dims; ++d) {
+        grid[d] = data_size[d] / hc_shape[d];
+        num_hypercubes *= grid[d];
+    }
+    const auto hc_size = num_elements(hc_shape);
+    const auto row_length = hc_shape[dims - 1];
+    const auto num_samples = std::min(num_hypercubes,
+            std::max(min_samples, static_cast<index_type>(std::ceil(sample_fraction * num_hypercubes))));
+
+    tuning_sample<T> sample;
+    sample.covered_values = num_hypercubes * hc_size;
+    sample.size = hc_shape;
+    sample.size[0] *= num_samples;
+    sample.values.resize(size_t{num_samples} * hc_size);
+    for (index_type s = 0; s < num_samples; ++s) {
+        const auto first_in_stratum = static_cast<index_type>(uint64_t{s} * num_hypercubes / num_samples);
+        const auto end_of_stratum = static_cast<index_type>(uint64_t{s + 1} * num_hypercubes / num_samples);
+        auto hc_index = std::uniform_int_distribution<index_type>{first_in_stratum, end_of_stratum - 1}(rng);
+        extent hc_offset(dims);
+        for (dim_type d = dims; d-- > 0;) {
+            hc_offset[d] = hc_index % grid[d] * hc_shape[d];
+            hc_index /= grid[d];
+        }
+        for (index_type i = 0; i < hc_size; i += row_length) {
+            index_type source = 0;
+            auto position_in_hc = i;
+            index_type stride = 1;
+            for (dim_type d = dims; d-- > 0;) {
+                source += (hc_offset[d] + position_in_hc % hc_shape[d]) * stride;
+                position_in_hc /= hc_shape[d];
+                stride *= data_size[d];
+            }
+            memcpy(sample.values.data() + size_t{s} * hc_size + i, data + source, row_length * sizeof(T));
+        }
+    }
+    return sample;
+}
+
+// Compresses a sample under one configuration, timing the fastest of a few repetitions
+template<typename T>
+tuning_result
+evaluate_configuration(const tuning_sample<T> &sample, index_type num_values, const stream_options &options) {
+    constexpr int repetitions = 2;
+
+    tuning_result result{options, 1.0, std::numeric_limits<double>::infinity()};
+    if (sample.values.empty()) { return result; }
+
+    const auto compressor = make_compressor<T>(sample.size.dimensions(), 1, options);
+    std::vector<compressed_type<T>> stream(options.hypercube_shape
+                    ? compressed_length_bound<T>(sample.size, *options.hypercube_shape)
+                    : compressed_length_bound<T>(sample.size));
+    const auto sample_bytes = static_cast<double>(sample.values.size() * sizeof(T));
+    auto fastest = std::chrono::duration<double>::max();
+    index_type length = 0;
+    for (int r = 0; r < repetitions; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        length = compressor->compress(sample.values.data(), sample.size, stream.data());
+        fastest = std::min<std::chrono::duration<double>>(fastest, std::chrono::steady_clock::now() - start);
+    }
+
+    // The border is stored verbatim
+    const auto sample_ratio = static_cast<double>(length) * sizeof(compressed_type<T>) / sample_bytes;
+    const auto border_values = num_values - sample.covered_values;
+    result.estimated_ratio = (sample_ratio * sample.covered_values + border_values) / num_values;
+    result.estimated_throughput = sample_bytes / std::max(fastest.count(), 1e-9);
+    return result;
+}
+
 }  // namespace ndzip::detail::cpu
 
 namespace ndzip {
 
 template<typename T>
-std::unique_ptr<offloader<T>> make_cpu_offloader(dim_type dims, unsigned num_threads) {
-    return std::make_unique<detail::cpu::cpu_offloader<T>>(dims, num_threads);
+tuning_result tune(const T *data, const extent &data_size, tuning_objective objective, double sample_fraction) {
+    if (!(sample_fraction > 0 && sample_fraction <= 1)) {
+        throw std::invalid_argument{"sample fraction must be in (0, 1]"};
+    }
+
+    const auto dims = data_size.dimensions();
+    if (dims < 1 || dims > 3) { throw std::runtime_error{"Invalid dimensionality"}; }
+    const auto num_values = num_elements(data_size);
+    const auto side_length = dims == 1 ? detail::hypercube_side_length<1>
+            : dims == 2                ? detail::hypercube_side_length<2>
+                                       : detail::hypercube_side_length<3>;
+    const auto cube = extent::broadcast(dims, side_length);
+    std::mt19937 rng;  // default seed, tuning the same array twice yields the same sample
+
+    std::vector<tuning_result> candidates;
+    const auto evaluate = [&](const detail::cpu::tuning_sample<T> &sample, stream_options options) {
+        for (int level = 0; level <= max_compression_level; ++level) {
+            options.level = level;
+            candidates.push_back(detail::cpu::evaluate_configuration(sample, num_values, options));
+        }
+    };
+
+    const auto cube_sample = detail::cpu::sample_hypercubes(data, data_size, cube, sample_fraction, rng);
+    evaluate(cube_sample, stream_options{});
+    stream_options adaptive;
+    adaptive.adaptive_prediction = true;
+    evaluate(cube_sample, adaptive);
+    for (const auto &shape : detail::cpu::list_hypercube_shapes(dims)) {
+        if (shape == cube) { continue; }
+        stream_options shaped;
+        shaped.hypercube_shape = shape;
+        evaluate(detail::cpu::sample_hypercubes(data, data_size, shape, sample_fraction, rng), shaped);
+    }
+
+    double max_throughput = 0;
+    for (const auto &candidate : candidates) {
+        max_throughput = std::max(max_throughput, candidate.estimated_throughput);
+    }
+    const auto better = [&](const tuning_result &left, const tuning_result &right) {
+        if (objective == tuning_objective::throughput) {
+            return left.estimated_throughput > right.estimated_throughput;
+        }
+        if (objective == tuning_objective::balanced) {
+            const bool left_fast = left.estimated_throughput >= max_throughput / 2;
+            const bool right_fast = right.estimated_throughput >= max_throughput / 2;
+            if (left_fast != right_fast) { return left_fast; }
+        }
+        return left.estimated_ratio < right.estimated_ratio;
+    };
+    auto best = candidates.front();
+    for (const auto &candidate : candidates) {
+        if (better(candidate, best)) { best = candidate; }
+    }
+    return best;
+}
+
+template tuning_result tune<float>(const float *, const extent &, tuning_objective, double);
+template tuning_result tune<double>(const double *, const extent &, tuning_objective, double);
+
+template<typename T>
+compressed_length_estimate estimate_compressed_length(const T *data, const extent &data_size, double sample_fraction) {
+    if (!(sample_fraction > 0 && sample_fraction <= 1)) {
+        throw std::invalid_argument{"sample fraction must be in (0, 1]"};
+    }
+    switch (data_size.dimensions()) {
+        case 1:
+            return detail::cpu::estimate_compressed_length<detail::profile<T, 1>>(data, data_size, sample_fraction);
+        case 2:
+            return detail::cpu::estimate_compressed_length<detail::profile<T, 2>>(data, data_size, sample_fraction);
+        case 3:
+            return detail::cpu::estimate_compressed_length<detail::profile<T, 3>>(data, data_size, sample_fraction);
+        default: throw std::runtime_error{"Invalid dimensionality"};
+    }
 }
 
-template std::unique_ptr<offloader<float>> make_cpu_offloader<float>(dim_type, unsigned);
-template std::unique_ptr<offloader<double>> make_cpu_offloader<double>(dim_type, unsigned);
+template compressed_length_estimate estimate_compressed_length<float>(const float *, const extent &, double);
+template compressed_length_estimate estimate_compressed_length<double>(const double *, const extent &, double);
 
 }  // namespace ndzip
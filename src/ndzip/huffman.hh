@@ -0,0 +1,225 @@
+#pragma once
+
+#include "common.hh"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+
+namespace ndzip::detail {
+
+// Canonical, length-limited Huffman coding of byte strings, used by the entropy coding stage of compression levels
+// above 0. Byte i of the input is coded with the table of context i % num_contexts. The encoded form is one table
+// of 4-bit code lengths per context followed by the codes, packed LSB-first.
+
+constexpr inline unsigned huffman_max_code_length = 12;
+constexpr inline size_t huffman_table_size = 256 / 2;
+constexpr inline unsigned huffman_max_contexts = 8;
+
+using huffman_code_lengths = std::array<uint8_t, 256>;
+
+// Lookup tables of huffman_decode, one per context. Each entry holds the symbol in the low byte and the code length
+// above it, a length of zero marks unused codes. Decoders keep one set per thread, huffman_decode initializes only the
+// entries it reads.
+using huffman_decode_tables = std::array<uint16_t, huffman_max_contexts << huffman_max_code_length>;
+
+// Lengths of a Huffman code for the given symbol frequencies, limited to huffman_max_code_length by repeatedly
+// halving the frequencies until the tree is shallow enough.
+inline huffman_code_lengths huffman_build_code_lengths(const uint32_t *frequencies) {
+    huffman_code_lengths lengths{};
+    std::vector<std::pair<uint64_t, int>> leaves;
+    for (int s = 0; s < 256; ++s) {
+        if (frequencies[s] > 0) { leaves.emplace_back(frequencies[s], s); }
+    }
+    if (leaves.empty()) { return lengths; }
+    if (leaves.size() == 1) {
+        lengths[leaves[0].second] = 1;
+        return lengths;
+    }
+
+    const auto num_leaves = static_cast<int>(leaves.size());
+    std::vector<uint64_t> weight(2 * num_leaves - 1);
+    std::vector<int> parent(2 * num_leaves - 1);
+    std::vector<unsigned> depth(2 * num_leaves - 1);
+    for (;;) {
+        std::sort(leaves.begin(), leaves.end());
+        for (int i = 0; i < num_leaves; ++i) {
+            weight[i] = leaves[i].first;
+        }
+
+        // Two-queue construction: leaves and internal nodes are both produced in ascending weight order
+        int next_leaf = 0, next_internal = num_leaves;
+        const auto pop_min = [&](int end_internal) {
+            if (next_leaf < num_leaves
+                    && (next_internal == end_internal || weight[next_leaf] <= weight[next_internal])) {
+                return next_leaf++;
+            }
+            return next_internal++;
+        };
+        for (int node = num_leaves; node < 2 * num_leaves - 1; ++node) {
+            const auto a = pop_min(node);
+            const auto b = pop_min(node);
+            weight[node] = weight[a] + weight[b];
+            parent[a] = parent[b] = node;
+        }
+
+        unsigned max_depth = 0;
+        depth[2 * num_leaves - 2] = 0;
+        for (int node = 2 * num_leaves - 3; node >= 0; --node) {
+            depth[node] = depth[parent[node]] + 1;
+            if (node < num_leaves) { max_depth = std::max(max_depth, depth[node]); }
+        }
+        if (max_depth <= huffman_max_code_length) { break; }
+
+        for (auto &leaf : leaves) {
+            leaf.first = (leaf.first >> 1u) | 1u;
+        }
+    }
+
+    for (int i = 0; i < num_leaves; ++i) {
+        lengths[leaves[i].second] = static_cast<uint8_t>(depth[i]);
+    }
+    return lengths;
+}
+
+// Canonical codes for the given lengths, bit-reversed for LSB-first emission
+inline std::array<uint16_t, 256> huffman_canonical_codes(const huffman_code_lengths &lengths) {
+    std::array<uint16_t, 256> codes{};
+    unsigned code = 0;
+    for (unsigned length = 1; length <= huffman_max_code_length; ++length) {
+        for (int s = 0; s < 256; ++s) {
+            if (lengths[s] != length) { continue; }
+            unsigned reversed = 0;
+            for (unsigned b = 0; b < length; ++b) {
+                reversed |= ((code >> b) & 1u) << (length - 1 - b);
+            }
+            codes[s] = static_cast<uint16_t>(reversed);
+            ++code;
+        }
+        code <<= 1u;
+    }
+    return codes;
+}
+
+// Encodes n bytes from in to out. Returns the encoded size, or 0 if it would exceed capacity bytes.
+inline size_t huffman_encode(const std::byte *in, size_t n, unsigned num_contexts, std::byte *out, size_t capacity) {
+    assert(num_contexts > 0 && num_contexts <= huffman_max_contexts);
+
+    uint32_t frequencies[huffman_max_contexts][256] = {};
+    for (size_t i = 0; i < n; ++i) {
+        ++frequencies[i % num_contexts][static_cast<uint8_t>(in[i])];
+    }
+
+    const auto tables_size = num_contexts * huffman_table_size;
+    if (tables_size >= capacity) { return 0; }
+
+    huffman_code_lengths lengths[huffman_max_contexts];
+    std::array<uint16_t, 256> codes[huffman_max_contexts];
+    uint64_t num_bits = 0;
+    for (unsigned c = 0; c < num_contexts; ++c) {
+        lengths[c] = huffman_build_code_lengths(frequencies[c]);
+        codes[c] = huffman_canonical_codes(lengths[c]);
+        for (int s = 0; s < 256; ++s) {
+            num_bits += uint64_t{frequencies[c][s]} * lengths[c][s];
+        }
+        for (size_t s = 0; s < 256; s += 2) {
+            out[c * huffman_table_size + s / 2] = static_cast<std::byte>(lengths[c][s] | lengths[c][s + 1] << 4u);
+        }
+    }
+
+    const auto encoded_size = tables_size + div_ceil<uint64_t>(num_bits, 8);
+    if (encoded_size >= capacity) { return 0; }
+
+    auto bits_out = out + tables_size;
+    uint64_t buffer = 0;
+    unsigned buffered = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const auto c = i % num_contexts;
+        const auto s = static_cast<uint8_t>(in[i]);
+        buffer |= uint64_t{codes[c][s]} << buffered;
+        buffered += lengths[c][s];
+        if (buffered >= 32) {
+            store_unaligned(bits_out, static_cast<uint32_t>(buffer));
+            bits_out += 4;
+            buffer >>= 32u;
+            buffered -= 32;
+        }
+    }
+    for (; buffered > 0; buffered -= std::min(buffered, 8u)) {
+        *bits_out++ = static_cast<std::byte>(buffer);
+        buffer >>= 8u;
+    }
+    return encoded_size;
+}
+
+// Decodes n bytes to out from the in_size bytes at in. Throws if the input is not a valid encoding.
+inline void huffman_decode(const std::byte *in, size_t in_size, std::byte *out, size_t n, unsigned num_contexts,
+        huffman_decode_tables &tables) {
+    constexpr auto table_length = size_t{1} << huffman_max_code_length;
+    constexpr auto corrupt = "corrupt entropy-coded hypercube";
+
+    const auto tables_size = num_contexts * huffman_table_size;
+    if (num_contexts == 0 || num_contexts > huffman_max_contexts || tables_size > in_size) {
+        throw std::runtime_error{corrupt};
+    }
+
+    // A context whose longest code has max_length bits is looked up by the next max_length bits of input only, so
+    // its table is filled up to 2^max_length entries. Only an incomplete code leaves some of them unused.
+    uint64_t index_masks[huffman_max_contexts];
+    for (unsigned c = 0; c < num_contexts; ++c) {
+        huffman_code_lengths lengths;
+        for (size_t s = 0; s < 256; s += 2) {
+            const auto packed = static_cast<uint8_t>(in[c * huffman_table_size + s / 2]);
+            lengths[s] = packed & 0xfu;
+            lengths[s + 1] = packed >> 4u;
+        }
+        size_t kraft_sum = 0;
+        unsigned max_length = 0;
+        for (int s = 0; s < 256; ++s) {
+            if (lengths[s] > huffman_max_code_length) { throw std::runtime_error{corrupt}; }
+            if (lengths[s] > 0) { kraft_sum += table_length >> lengths[s]; }
+            max_length = std::max<unsigned>(max_length, lengths[s]);
+        }
+        if (kraft_sum > table_length) { throw std::runtime_error{corrupt}; }
+
+        const auto used_length = size_t{1} << max_length;
+        const auto table = tables.data() + c * table_length;
+        if (kraft_sum < table_length) { std::fill_n(table, used_length, uint16_t{0}); }
+        const auto codes = huffman_canonical_codes(lengths);
+        for (int s = 0; s < 256; ++s) {
+            for (size_t k = codes[s]; lengths[s] > 0 && k < used_length; k += size_t{1} << lengths[s]) {
+                table[k] = static_cast<uint16_t>(s | lengths[s] << 8u);
+            }
+        }
+        index_masks[c] = used_length - 1;
+    }
+
+    auto bits_in = in + tables_size;
+    const auto bits_end = in + in_size;
+    uint64_t buffer = 0;
+    unsigned buffered = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (buffered < huffman_max_code_length) {
+            if (bits_end - bits_in >= 4) {
+                buffer |= uint64_t{load_unaligned<uint32_t>(bits_in)} << buffered;
+                bits_in += 4;
+                buffered += 32;
+            } else {
+                for (; bits_in < bits_end && buffered <= 56; ++bits_in, buffered += 8) {
+                    buffer |= uint64_t{static_cast<uint8_t>(*bits_in)} << buffered;
+                }
+            }
+        }
+        const auto c = i % num_contexts;
+        const auto entry = tables[c * table_length + (buffer & index_masks[c])];
+        const auto length = static_cast<unsigned>(entry >> 8u);
+        if (length == 0 || length > buffered) { throw std::runtime_error{corrupt}; }
+        out[i] = static_cast<std::byte>(entry & 0xffu);
+        buffer >>= length;
+        buffered -= length;
+    }
+}
+
+}  // namespace ndzip::detail
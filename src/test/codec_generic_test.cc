@@ -155,3 +155,253 @@ TEMPLATE_TEST_CASE("file produces a sane hypercube / header layout", "[file]", (
     // CHECK(f.file_header_length() == f.num_hypercubes() * sizeof(index_type));
     CHECK(num_hypercubes(size) == ipow(n_hypercubes_per_dim, dims));
 }
+
+
+TEST_CASE("offset header markers only restrict streams that use them", "[file]") {
+    using profile = detail::profile<float, 1>;
+    std::vector<uint32_t> buffer(2);
+    const auto header_entry = [&](preamble p, uint32_t entry) {
+        buffer[0] = entry;
+        return detail::stream<const profile>{1, buffer.data(), header_marker_bits(p)};
+    };
+
+    preamble plain;
+    auto stream = header_entry(plain, 0x80000001u);
+    CHECK(stream.max_offset() == UINT32_MAX);
+    CHECK(stream.offset_after(0) == 0x80000001u);
+    CHECK(!stream.is_back_reference(0));
+    CHECK(!stream.is_raw(0));
+
+    preamble deduplicated;
+    deduplicated.flags = preamble::deduplicated;
+    stream = header_entry(deduplicated, 0x80000001u);
+    CHECK(stream.max_offset() == 0x7fffffffu);
+    CHECK(stream.offset_after(0) == 1);
+    CHECK(stream.is_back_reference(0));
+
+    preamble raw_fallback;
+    raw_fallback.flags = preamble::deduplicated | preamble::raw_fallback;
+    stream = header_entry(raw_fallback, 0x40000001u);
+    CHECK(stream.max_offset() == 0x3fffffffu);
+    CHECK(stream.offset_after(0) == 1);
+    CHECK(stream.is_raw(0));
+    CHECK(!stream.is_back_reference(0));
+
+    CHECK_NOTHROW(detail::cpu::check_stream_offset(0x3fffffffu, 0x3fffffffu));
+    CHECK_THROWS_AS(detail::cpu::check_stream_offset(0x40000000u, 0x3fffffffu), std::length_error);
+}
+
+
+TEST_CASE("container indices locate framed chunks", "[container]") {
+    const extent size{70, 90};
+    const auto compressor = make_compressor<float>(2, 1);
+    const auto bound = frame_header_size + compressed_length_bound<float>(size) * sizeof(compressed_type<float>);
+
+    // Chunks of different lengths, each a frame header followed by its stream
+    std::vector<std::vector<float>> arrays;
+    std::vector<std::byte> container;
+    std::vector<container_chunk> chunks;
+    for (int step = 0; step < 3; ++step) {
+        std::vector<float> array(num_elements(size));
+        for (size_t i = 0; i < array.size(); ++i) {
+            array[i] = static_cast<float>(i % (17 * (step + 1))) * 0.5f;
+        }
+        const auto offset = container.size();
+        container.resize(offset + bound);
+        const auto stream = reinterpret_cast<compressed_type<float> *>(container.data() + offset + frame_header_size);
+        const auto stream_length = compressor->compress(array.data(), size, stream) * sizeof(compressed_type<float>);
+        write_frame_header(frame_header{element_type::float32, size, {}, stream_length}, container.data() + offset);
+        container.resize(offset + frame_header_size + stream_length);
+        chunks.push_back(container_chunk{offset, frame_header_size + stream_length});
+        arrays.push_back(std::move(array));
+    }
+    const auto chunks_end = container.size();
+    container.resize(chunks_end + container_index_size(chunks.size()));
+    write_container_index(chunks, container.data() + chunks_end);
+    CHECK(is_container_footer(container.data() + container.size() - container_footer_size));
+
+    const auto index = read_container_index(container.data(), container.size());
+    REQUIRE(index.size() == chunks.size());
+    // Decode in reverse to show that no chunk depends on its predecessors
+    for (size_t i = index.size(); i-- > 0;) {
+        CHECK(index[i].offset == chunks[i].offset);
+        CHECK(index[i].length == chunks[i].length);
+        const auto header = read_frame_header(container.data() + index[i].offset, index[i].length);
+        std::vector<float> output(num_elements(header.data_size));
+        const auto stream = reinterpret_cast<const compressed_type<float> *>(
+                container.data() + index[i].offset + frame_header_size);
+        make_decompressor<float>(header, 1)->decompress(stream, output.data(), header.data_size);
+        CHECK_FOR_VECTOR_EQUALITY(output, arrays[i]);
+    }
+
+    SECTION("empty containers have an empty index") {
+        std::vector<std::byte> empty(container_index_size(0));
+        write_container_index({}, empty.data());
+        CHECK(read_container_index(empty.data(), empty.size()).empty());
+    }
+
+    SECTION("truncated and corrupt containers are rejected") {
+        CHECK_THROWS_AS(read_container_index(container.data(), container.size() - 1), std::runtime_error);
+        CHECK_THROWS_AS(read_container_index(container.data(), container_footer_size - 1), std::runtime_error);
+        auto corrupt = container;
+        corrupt[chunks_end + 3] ^= std::byte{1};
+        CHECK_THROWS_AS(read_container_index(corrupt.data(), corrupt.size()), std::runtime_error);
+    }
+}
+
+
+TEST_CASE("archives store named variables at aligned offsets", "[archive]") {
+    const extent temperature_size{20, 30, 40};
+    const extent pressure_size{300, 50};
+    std::vector<double> temperature(num_elements(temperature_size));
+    for (size_t i = 0; i < temperature.size(); ++i) {
+        temperature[i] = 273.15 + static_cast<double>(i % 97) * 0.25;
+    }
+    std::vector<float> pressure(num_elements(pressure_size));
+    for (size_t i = 0; i < pressure.size(); ++i) {
+        pressure[i] = 1000.f - static_cast<float>(i % 31);
+    }
+
+    std::vector<std::byte> archive;
+    std::vector<archive_variable> variables;
+    const auto add_variable = [&](const std::string &name, const auto *data, const extent &size) {
+        using T = std::remove_cv_t<std::remove_pointer_t<decltype(data)>>;
+        const auto offset = (archive.size() + archive_alignment - 1) / archive_alignment * archive_alignment;
+        archive.resize(offset + frame_header_size + compressed_length_bound<T>(size) * sizeof(compressed_type<T>));
+        const auto stream_length = make_compressor<T>(size.dimensions(), 1)->compress(
+                data, size, reinterpret_cast<compressed_type<T> *>(archive.data() + offset + frame_header_size));
+        const frame_header header{element_type_of<T>, size, {}, stream_length * sizeof(compressed_type<T>)};
+        write_frame_header(header, archive.data() + offset);
+        archive.resize(offset + frame_header_size + header.stream_length);
+        variables.push_back(archive_variable{name, header, offset});
+    };
+    add_variable("temperature", temperature.data(), temperature_size);
+    add_variable("pressure", pressure.data(), pressure_size);
+    const auto directory_offset = archive.size();
+    archive.resize(directory_offset + archive_directory_size(variables));
+    write_archive_directory(variables, directory_offset, archive.data() + directory_offset);
+    CHECK(is_archive_footer(archive.data() + archive.size() - archive_footer_size));
+
+    const auto directory = read_archive_directory(archive.data(), archive.size());
+    REQUIRE(directory.size() == 2);
+    CHECK(directory[0].name == "temperature");
+    CHECK(directory[0].header.type == element_type::float64);
+    CHECK(directory[0].header.data_size == temperature_size);
+    CHECK(directory[1].name == "pressure");
+    CHECK(directory[1].header.data_size == pressure_size);
+    CHECK(directory[1].offset % archive_alignment == 0);
+
+    SECTION("variables are extracted independently") {
+        std::vector<float> pressure_output(pressure.size());
+        extract_variable(archive.data(), directory[1], pressure_output.data(), 1);
+        CHECK_FOR_VECTOR_EQUALITY(pressure_output, pressure);
+        std::vector<double> temperature_output(temperature.size());
+        extract_variable(archive.data(), directory[0], temperature_output.data(), 1);
+        CHECK_FOR_VECTOR_EQUALITY(temperature_output, temperature);
+    }
+
+    SECTION("regions are extracted as dense arrays") {
+        const box region{extent{3, 5, 7}, extent{4, 6, 8}};
+        std::vector<double> output(num_elements(region.size));
+        extract_region(archive.data(), directory[0], region, output.data(), 1);
+        std::vector<double> expected;
+        for (index_type i = 0; i < region.size[0]; ++i) {
+            for (index_type j = 0; j < region.size[1]; ++j) {
+                for (index_type k = 0; k < region.size[2]; ++k) {
+                    expected.push_back(temperature[((i + 3) * 30 + j + 5) * 40 + k + 7]);
+                }
+            }
+        }
+        CHECK_FOR_VECTOR_EQUALITY(output, expected);
+        CHECK_THROWS_AS(extract_region(archive.data(), directory[0], box{extent{18, 0, 0}, extent{4, 1, 1}},
+                                output.data(), 1),
+                std::invalid_argument);
+    }
+
+    SECTION("mismatched types, duplicate names and corrupt directories are rejected") {
+        std::vector<float> output(temperature.size());
+        CHECK_THROWS_AS(extract_variable(archive.data(), directory[0], output.data(), 1), std::invalid_argument);
+        std::vector<std::byte> duplicate(archive_directory_size({variables[0], variables[0]}));
+        CHECK_THROWS_AS(write_archive_directory({variables[0], variables[0]}, directory_offset, duplicate.data()),
+                std::invalid_argument);
+        auto corrupt = archive;
+        corrupt[directory_offset + 5] ^= std::byte{1};
+        CHECK_THROWS_AS(read_archive_directory(corrupt.data(), corrupt.size()), std::runtime_error);
+        CHECK_THROWS_AS(read_archive_directory(archive.data(), archive.size() - 1), std::runtime_error);
+    }
+}
+
+
+TEST_CASE("crc32c and hypercube regions work as advertised", "[checksum]") {
+    const char check[] = "123456789";
+    CHECK(cpu::crc32c(check, 9, 0) == 0xe3069283u);
+    CHECK(cpu::crc32c(check, 0, 0) == 0);
+
+    const extent size{130, 200};
+    const auto region = hypercube_region(size, 4);
+    CHECK(region.offset == extent{64, 64});
+    CHECK(region.size == extent{64, 64});
+    CHECK(hypercube_region(size, 5).offset == extent{64, 128});
+    CHECK_THROWS_AS(hypercube_region(size, 6), std::invalid_argument);
+}
+
+TEST_CASE("xxhash64 hashes pieces of stripes like their concatenation", "[hash]") {
+    CHECK(xxhash64(nullptr, 0, 0) == 0xef46db3751d8e999ull);
+    CHECK(xxhash64("abc", 3, 0) == 0x44bc2cf5ad770999ull);
+
+    const auto data = make_random_vector<uint32_t>(100);
+    const auto stripe_words = xxhash64_state::stripe_size / sizeof(uint32_t);
+    for (size_t size = 0; size <= data.size() * sizeof(uint32_t); size += 13) {
+        xxhash64_state state{42};
+        const auto num_stripes = size / xxhash64_state::stripe_size;
+        for (size_t stripe = 0; stripe < num_stripes; ++stripe) {
+            state.add_stripes(data.data() + stripe * stripe_words, xxhash64_state::stripe_size);
+        }
+        const auto tail = data.data() + num_stripes * stripe_words;
+        CHECK(state.finish(tail, size - num_stripes * xxhash64_state::stripe_size) == xxhash64(data.data(), size, 42));
+    }
+
+    // Hypercubes hash like their gathered rows
+    using profile = detail::profile<float, 3>;
+    const auto size = static_extent<3>{20, 33, 17};
+    const auto array = make_random_vector<float>(num_elements(size));
+    const auto hc_offset = static_extent<3>{2, 15, 1};
+    const auto hc_size = ipow(profile::hypercube_side_length, 3);
+    cpu::simd_aligned_buffer<uint32_t> cube(hc_size);
+    cpu::load_hypercube<profile>(hc_offset, array.data(), size, cube.data());
+    CHECK(cpu::hash_hypercube<profile>(hc_offset, array.data(), size)
+            == xxhash64(cube.data(), hc_size * sizeof(uint32_t), 0));
+}
+
+TEST_CASE("huffman_decode reuses its tables across codes", "[huffman]") {
+    const auto random_bytes = make_random_vector<uint8_t>(4000);
+    std::vector<uint8_t> skewed_bytes(4000);
+    for (size_t i = 0; i < skewed_bytes.size(); ++i) {
+        skewed_bytes[i] = static_cast<uint8_t>(random_bytes[i] % 5 == 0 ? random_bytes[i] : i % 3);
+    }
+    const std::vector<uint8_t> constant_bytes(4000, 7);
+
+    huffman_decode_tables tables;
+    std::fill(tables.begin(), tables.end(), uint16_t{0xffff});
+    std::vector<std::byte> encoded(8000);
+    std::vector<uint8_t> decoded(4000);
+    const std::vector<uint8_t> *inputs[] = {&random_bytes, &constant_bytes, &skewed_bytes, &constant_bytes};
+    for (unsigned num_contexts : {1u, 4u}) {
+        for (const auto *input : inputs) {
+            const auto in = reinterpret_cast<const std::byte *>(input->data());
+            const auto encoded_size = huffman_encode(in, input->size(), num_contexts, encoded.data(), encoded.size());
+            REQUIRE(encoded_size > 0);
+            huffman_decode(encoded.data(), encoded_size, reinterpret_cast<std::byte *>(decoded.data()),
+                    decoded.size(), num_contexts, tables);
+            CHECK(decoded == *input);
+        }
+    }
+
+    // A constant context has a single one-bit code, the entry of the other bit must not be left over from earlier codes
+    const auto encoded_size = huffman_encode(reinterpret_cast<const std::byte *>(constant_bytes.data()),
+            constant_bytes.size(), 1, encoded.data(), encoded.size());
+    encoded[huffman_table_size] |= std::byte{1};
+    CHECK_THROWS_AS(huffman_decode(encoded.data(), encoded_size, reinterpret_cast<std::byte *>(decoded.data()),
+                            decoded.size(), 1, tables),
+            std::runtime_error);
+}
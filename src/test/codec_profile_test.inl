@@ -34,6 +34,33 @@ TEMPLATE_TEST_CASE("block transform is reversible", "[profile]", ALL_PROFILES) {
 }
 
 
+TEMPLATE_TEST_CASE("CPU predictors match the generic implementation and are reversible", "[profile]", ALL_PROFILES) {
+    using bits_type = typename TestType::bits_type;
+    constexpr auto dims = TestType::dimensions;
+    constexpr auto side_length = TestType::hypercube_side_length;
+    constexpr auto hc_size = ipow(side_length, dims);
+
+    const auto input = make_random_vector<bits_type>(hc_size);
+
+    for (uint8_t selector = 0; selector <= static_cast<uint8_t>(predictor::xor_delta); ++selector) {
+        if (!is_valid_predictor(selector, dims)) { continue; }
+        const auto p = static_cast<predictor>(selector);
+        CAPTURE(selector);
+
+        auto generic = input;
+        detail::predict(generic.data(), dims, side_length, p);
+
+        cpu::simd_aligned_buffer<bits_type> cube(hc_size);
+        std::copy(input.begin(), input.end(), cube.data());
+        cpu::predict<TestType>(cube.data(), p);
+        CHECK(std::equal(generic.begin(), generic.end(), cube.data()));
+
+        cpu::inverse_predict<TestType>(cube.data(), p);
+        CHECK(std::equal(input.begin(), input.end(), cube.data()));
+    }
+}
+
+
 TEMPLATE_TEST_CASE("decode(encode(input)) reproduces the input", "[encoder][de]", ALL_PROFILES) {
     using profile = TestType;
     using value_type = typename profile::value_type;
@@ -96,6 +123,2082 @@ TEMPLATE_TEST_CASE("decode(encode(input)) reproduces the input", "[encoder][de]"
 }
 
 
+TEMPLATE_TEST_CASE("partial update produces the same stream as full compression", "[encoder][update]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 - 1;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    // One region turns from zeroes into noise (stream grows) and one from noise into zeroes (stream shrinks), the
+    // latter also touching the border
+    const box growing{extent::broadcast(dims, side_length / 2), extent::broadcast(dims, side_length)};
+    const box shrinking{extent::broadcast(dims, 2 * side_length + 1), extent::broadcast(dims, n - 2 * side_length - 1)};
+
+    auto fill_box = [&](std::vector<value_type> &data, const box &b, const std::vector<value_type> &values) {
+        for (index_type i = 0; i < data.size(); ++i) {
+            const auto pos = extent_from_linear_id(i, static_size);
+            bool inside = true;
+            for (dim_type d = 0; d < dims; ++d) {
+                inside &= pos[d] >= b.offset[d] && pos[d] < b.offset[d] + b.size[d];
+            }
+            if (inside) { data[i] = values[i]; }
+        }
+    };
+
+    const auto noise = make_random_vector<value_type>(ipow(n, dims));
+    const std::vector<value_type> zeroes(noise.size());
+    auto old_data = noise;
+    fill_box(old_data, growing, zeroes);
+    auto new_data = noise;
+    fill_box(new_data, shrinking, zeroes);
+
+    auto test_update = [&](unsigned num_threads, const stream_options &options = {}) {
+        const auto compressor = make_compressor<value_type>(dims, num_threads, options);
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        compressor->compress(old_data.data(), size, stream.data());
+        stream.resize(compressor->update(new_data.data(), size, {growing, shrinking}, stream.data()));
+
+        std::vector<bits_type> reference(ndzip::compressed_length_bound<value_type>(size));
+        reference.resize(compressor->compress(new_data.data(), size, reference.data()));
+        CHECK_FOR_VECTOR_EQUALITY(reference, stream);
+    };
+
+    stream_options fixed_rate;
+    fixed_rate.fixed_rate = 8;
+
+    SECTION("serial CPU") { test_update(1); }
+    SECTION("serial CPU, fixed rate") { test_update(1, fixed_rate); }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") { test_update(4); }
+    SECTION("OpenMP CPU, fixed rate", "[omp]") { test_update(4, fixed_rate); }
+#endif
+}
+
+
+TEMPLATE_TEST_CASE("temporal-delta streams reproduce the input given the reference", "[encoder][delta]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 1;
+    const auto size = extent::broadcast(dims, n);
+
+    // A slowly evolving field: the next time step differs from the keyframe in a small region and the border only
+    const auto keyframe = make_random_vector<value_type>(ipow(n, dims));
+    auto input_data = keyframe;
+    for (index_type i = 0; i < input_data.size() / 64; ++i) {
+        input_data[i] = input_data[i] * value_type{2};
+    }
+    input_data.back() = value_type{};
+
+    auto test_delta = [&](unsigned compressor_threads, unsigned decompressor_threads) {
+        const auto compressor = make_compressor<value_type>(dims, compressor_threads);
+        const auto decompressor = make_decompressor<value_type>(dims, decompressor_threads);
+
+        std::vector<bits_type> plain_stream(ndzip::compressed_length_bound<value_type>(size));
+        plain_stream.resize(compressor->compress(input_data.data(), size, plain_stream.data()));
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), keyframe.data(), size, stream.data()));
+        CHECK(stream.size() < plain_stream.size() / 2);
+
+        std::vector<value_type> output_data(input_data.size());
+        CHECK(decompressor->decompress(stream.data(), keyframe.data(), output_data.data(), size) == stream.size());
+        CHECK_FOR_VECTOR_EQUALITY(input_data, output_data);
+
+        CHECK_THROWS(decompressor->decompress(stream.data(), input_data.data(), output_data.data(), size));
+        CHECK_THROWS(decompressor->decompress(plain_stream.data(), keyframe.data(), output_data.data(), size));
+    };
+
+    SECTION("serial CPU") { test_delta(1, 1); }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU compress => serial CPU decompress", "[omp]") { test_delta(4, 1); }
+    SECTION("serial CPU compress => OpenMP CPU decompress", "[omp]") { test_delta(1, 4); }
+#endif
+}
+
+
+TEMPLATE_TEST_CASE("adaptive prediction reproduces the input", "[encoder][adaptive]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 - 1;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    // Noise, for which Lorenzo prediction is counter-productive, next to data that is smooth along one axis only
+    auto input_data = make_random_vector<value_type>(ipow(n, dims));
+    for (index_type i = input_data.size() / 2; i < input_data.size(); ++i) {
+        input_data[i] = input_data[i - extent_from_linear_id(i, static_size)[dims - 1]];
+    }
+
+    stream_options options;
+    options.adaptive_prediction = true;
+
+    auto test_adaptive = [&](unsigned compressor_threads, unsigned decompressor_threads) {
+        const auto compressor = make_compressor<value_type>(dims, compressor_threads, options);
+        const auto decompressor = make_decompressor<value_type>(dims, decompressor_threads, options);
+
+        std::vector<bits_type> plain_stream(ndzip::compressed_length_bound<value_type>(size));
+        plain_stream.resize(
+                make_compressor<value_type>(dims, 1)->compress(input_data.data(), size, plain_stream.data()));
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+        CHECK(stream.size() < plain_stream.size());
+
+        std::vector<value_type> output_data(input_data.size());
+        CHECK(decompressor->decompress(stream.data(), output_data.data(), size) == stream.size());
+        CHECK_FOR_VECTOR_EQUALITY(input_data, output_data);
+
+        CHECK_THROWS(decompressor->decompress(plain_stream.data(), output_data.data(), size));
+    };
+
+    SECTION("serial CPU") { test_adaptive(1, 1); }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU compress => serial CPU decompress", "[omp]") { test_adaptive(4, 1); }
+    SECTION("serial CPU compress => OpenMP CPU decompress", "[omp]") { test_adaptive(1, 4); }
+#endif
+}
+
+
+TEMPLATE_TEST_CASE("entropy-coded compression levels reproduce the input", "[encoder][level]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 - 1;
+    const auto size = extent::broadcast(dims, n);
+
+    // Few distinct values leave residuals whose bytes are far from uniformly distributed
+    auto input_data = make_random_vector<value_type>(ipow(n, dims));
+    for (index_type i = 0; i < input_data.size(); ++i) {
+        input_data[i] = static_cast<value_type>(static_cast<int>(input_data[i] * 8) % 4) * value_type{0.375};
+    }
+
+    std::vector<bits_type> plain_stream(ndzip::compressed_length_bound<value_type>(size));
+    plain_stream.resize(make_compressor<value_type>(dims, 1)->compress(input_data.data(), size, plain_stream.data()));
+
+    auto test_level = [&](int level, unsigned compressor_threads, unsigned decompressor_threads) {
+        stream_options options;
+        options.level = level;
+        const auto compressor = make_compressor<value_type>(dims, compressor_threads, options);
+        const auto decompressor = make_decompressor<value_type>(dims, decompressor_threads, options);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+        CHECK(stream.size() < plain_stream.size());
+
+        std::vector<value_type> output_data(input_data.size());
+        CHECK(decompressor->decompress(stream.data(), output_data.data(), size) == stream.size());
+        CHECK_FOR_VECTOR_EQUALITY(input_data, output_data);
+
+        CHECK_THROWS(decompressor->decompress(plain_stream.data(), output_data.data(), size));
+    };
+
+    SECTION("serial CPU, level 1") { test_level(1, 1, 1); }
+    SECTION("serial CPU, level 2") { test_level(2, 1, 1); }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU compress => serial CPU decompress", "[omp]") { test_level(2, 4, 1); }
+    SECTION("serial CPU compress => OpenMP CPU decompress", "[omp]") { test_level(1, 1, 4); }
+#endif
+
+    SECTION("invalid levels are rejected") {
+        stream_options options;
+        options.level = max_compression_level + 1;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options), std::invalid_argument);
+        options.level = -1;
+        CHECK_THROWS_AS(make_decompressor<value_type>(dims, 1, options), std::invalid_argument);
+    }
+}
+
+
+TEMPLATE_TEST_CASE("error-bounded streams reconstruct values within the bound", "[encoder][lossy]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 1;
+    const auto size = extent::broadcast(dims, n);
+
+    auto input_data = make_random_vector<value_type>(ipow(n, dims));
+    for (index_type i = 0; i < input_data.size(); ++i) {
+        input_data[i] = static_cast<value_type>(std::sin(i * 0.001)) + input_data[i] * value_type{1e-3};
+    }
+    // Hypercubes with non-finite values are stored verbatim
+    input_data[1] = std::numeric_limits<value_type>::infinity();
+    input_data[2] = std::numeric_limits<value_type>::quiet_NaN();
+
+    stream_options options;
+    options.error_bound = 1e-2;
+
+    std::vector<bits_type> lossless_stream(ndzip::compressed_length_bound<value_type>(size));
+    lossless_stream.resize(
+            make_compressor<value_type>(dims, 1)->compress(input_data.data(), size, lossless_stream.data()));
+
+    auto test_lossy = [&](unsigned compressor_threads, unsigned decompressor_threads) {
+        const auto compressor = make_compressor<value_type>(dims, compressor_threads, options);
+        const auto decompressor = make_decompressor<value_type>(dims, decompressor_threads, options);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+        CHECK(stream.size() < lossless_stream.size() / 2);
+
+        std::vector<value_type> output_data(input_data.size());
+        CHECK(decompressor->decompress(stream.data(), output_data.data(), size) == stream.size());
+        size_t num_violations = 0;
+        for (size_t i = 0; i < input_data.size(); ++i) {
+            if (std::isnan(input_data[i])) {
+                num_violations += !std::isnan(output_data[i]);
+            } else if (output_data[i] != input_data[i]) {
+                num_violations += !(std::abs(output_data[i] - input_data[i]) <= options.error_bound);
+            }
+        }
+        CHECK(num_violations == 0);
+        CHECK(output_data[1] == input_data[1]);
+
+        CHECK_THROWS(decompressor->decompress(lossless_stream.data(), output_data.data(), size));
+    };
+
+    SECTION("serial CPU") { test_lossy(1, 1); }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU compress => serial CPU decompress", "[omp]") { test_lossy(4, 1); }
+    SECTION("serial CPU compress => OpenMP CPU decompress", "[omp]") { test_lossy(1, 4); }
+#endif
+
+    SECTION("error-bounded compression against a reference is rejected") {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options)
+                                ->compress(input_data.data(), input_data.data(), size, stream.data()),
+                std::invalid_argument);
+    }
+}
+
+
+TEMPLATE_TEST_CASE("mantissa rounding is vectorized correctly", "[encoder][truncation]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+    using limits = std::numeric_limits<value_type>;
+
+    auto values = make_random_vector<value_type>(64);
+    values[0] = limits::max();
+    values[1] = -limits::infinity();
+    values[2] = limits::quiet_NaN();
+    values[3] = limits::denorm_min();
+    values[4] = value_type{1} + limits::epsilon();
+    values[5] = limits::signaling_NaN();
+
+    for (unsigned drop = 1; drop < mantissa_bits<value_type>; drop += 5) {
+        CAPTURE(drop);
+        std::vector<bits_type> rounded(values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            const auto bits = bit_cast<bits_type>(values[i]);
+            rounded[i] = round_mantissa<value_type>(bits, drop);
+            const auto result = bit_cast<value_type>(rounded[i]);
+            if (std::isfinite(values[i])) {
+                CHECK(std::isfinite(result));
+                CHECK((rounded[i] & ~(~bits_type{0} << drop)) == 0);
+                const auto magnitude = std::max(std::abs(values[i]), limits::min());
+                const auto precision = static_cast<int>(drop) - static_cast<int>(mantissa_bits<value_type>);
+                CHECK(std::abs(result - values[i]) <= std::ldexp(magnitude, precision));
+            } else {
+                CHECK(std::isnan(result) == std::isnan(values[i]));
+                CHECK(std::isinf(result) == std::isinf(values[i]));
+            }
+        }
+
+#ifdef __AVX2__
+        constexpr size_t words_per_vector = detail::cpu::simd_width_bytes / sizeof(bits_type);
+        for (size_t i = 0; i < values.size(); i += words_per_vector) {
+            bits_type vectorized[words_per_vector];
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(vectorized),
+                    detail::cpu::round_mantissa_avx2<value_type>(
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values.data() + i)), drop));
+            for (size_t j = 0; j < words_per_vector; ++j) {
+                CHECK(vectorized[j] == rounded[i + j]);
+            }
+        }
+#endif
+    }
+}
+
+
+TEMPLATE_TEST_CASE("streams with truncated mantissas reproduce the rounded input", "[encoder][truncation]",
+        ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 1;
+    const auto size = extent::broadcast(dims, n);
+
+    const auto input_data = make_random_vector<value_type>(ipow(n, dims));
+
+    stream_options options;
+    options.mantissa_bits = 10;
+
+    std::vector<bits_type> lossless_stream(ndzip::compressed_length_bound<value_type>(size));
+    lossless_stream.resize(
+            make_compressor<value_type>(dims, 1)->compress(input_data.data(), size, lossless_stream.data()));
+
+    auto test_truncation = [&](unsigned compressor_threads, unsigned decompressor_threads) {
+        const auto compressor = make_compressor<value_type>(dims, compressor_threads, options);
+        const auto decompressor = make_decompressor<value_type>(dims, decompressor_threads, options);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+        CHECK(stream.size() < lossless_stream.size() * 3 / 4);
+
+        std::vector<value_type> output_data(input_data.size());
+        CHECK(decompressor->decompress(stream.data(), output_data.data(), size) == stream.size());
+        const auto drop = mantissa_bits<value_type> - options.mantissa_bits;
+        size_t num_mismatches = 0;
+        for (size_t i = 0; i < input_data.size(); ++i) {
+            const auto bits = bit_cast<bits_type>(input_data[i]);
+            const auto output_bits = bit_cast<bits_type>(output_data[i]);
+            num_mismatches += output_bits != bits && output_bits != round_mantissa<value_type>(bits, drop);
+        }
+        CHECK(num_mismatches == 0);
+    };
+
+    SECTION("serial CPU") { test_truncation(1, 1); }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU compress => serial CPU decompress", "[omp]") { test_truncation(4, 1); }
+    SECTION("serial CPU compress => OpenMP CPU decompress", "[omp]") { test_truncation(1, 4); }
+#endif
+
+    SECTION("invalid bit counts are rejected") {
+        options.mantissa_bits = mantissa_bits<value_type> + 1;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options), std::invalid_argument);
+        options.mantissa_bits = 10;
+        options.error_bound = 0.1;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options), std::invalid_argument);
+    }
+}
+
+
+TEMPLATE_TEST_CASE("fixed-rate streams have constant-size hypercube slots", "[encoder][fixed-rate]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 1;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    const auto noise = make_random_vector<value_type>(ipow(n, dims));
+    const auto smooth = [&] {
+        std::vector<value_type> data(noise.size());
+        for (index_type i = 0; i < data.size(); ++i) {
+            const auto pos = extent_from_linear_id(i, static_size);
+            double phase = 0;
+            for (dim_type d = 0; d < dims; ++d) {
+                phase += 0.05 * pos[d];
+            }
+            data[i] = static_cast<value_type>(1.5 + 0.25 * std::sin(phase));
+        }
+        return data;
+    }();
+
+    stream_options options;
+    auto test_fixed_rate = [&](const std::vector<value_type> &input_data, unsigned compressor_threads,
+                                   unsigned decompressor_threads) {
+        const auto compressor = make_compressor<value_type>(dims, compressor_threads, options);
+        const auto decompressor = make_decompressor<value_type>(dims, decompressor_threads, options);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+
+        const auto num_hypercubes = detail::num_hypercubes(static_size);
+        const auto preamble = detail::make_preamble(options, false);
+        CHECK(stream.size()
+                == detail::stream_prefix_length<bits_type>(preamble, num_hypercubes)
+                        + num_hypercubes * detail::fixed_rate_slot_length<profile>(preamble)
+                        + border_element_count(static_size, side_length));
+
+        std::vector<value_type> output_data(input_data.size());
+        CHECK(decompressor->decompress(stream.data(), output_data.data(), size) == stream.size());
+        return output_data;
+    };
+
+    auto test_roundtrip = [&](unsigned compressor_threads, unsigned decompressor_threads) {
+        options.fixed_rate = bits_of<bits_type> + 1;
+        for (const auto *input_data : {&noise, &smooth}) {
+            const auto output_data = test_fixed_rate(*input_data, compressor_threads, decompressor_threads);
+            CHECK_FOR_VECTOR_EQUALITY(*input_data, output_data);
+        }
+
+        options.fixed_rate = 12;
+        const auto output_data = test_fixed_rate(smooth, compressor_threads, decompressor_threads);
+        double max_error = 0;
+        for (size_t i = 0; i < smooth.size(); ++i) {
+            max_error = std::max(max_error, std::abs(static_cast<double>(output_data[i]) - smooth[i]));
+        }
+        CHECK(max_error < 1e-2);
+        test_fixed_rate(noise, compressor_threads, decompressor_threads);
+    };
+
+    SECTION("serial CPU") { test_roundtrip(1, 1); }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU compress => serial CPU decompress", "[omp]") { test_roundtrip(4, 1); }
+    SECTION("serial CPU compress => OpenMP CPU decompress", "[omp]") { test_roundtrip(1, 4); }
+#endif
+
+    SECTION("invalid rates are rejected") {
+        options.fixed_rate = 1;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options), std::invalid_argument);
+        options.fixed_rate = bits_of<bits_type> + 2;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options), std::invalid_argument);
+        options.fixed_rate = 8;
+        options.level = 1;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options), std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("stream prefixes of progressive streams decode to the leading bits of each value",
+        "[encoder][progressive]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 1;
+    const auto size = extent::broadcast(dims, n);
+
+    const auto input_data = make_random_vector<value_type>(ipow(n, dims));
+
+    stream_options options;
+    options.progressive = true;
+
+    auto test_progressive = [&](unsigned compressor_threads, unsigned decompressor_threads) {
+        const auto compressor = make_compressor<value_type>(dims, compressor_threads, options);
+        const auto decompressor = make_decompressor<value_type>(dims, decompressor_threads, options);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+
+        std::vector<value_type> output_data(input_data.size());
+        CHECK(decompressor->decompress(stream.data(), output_data.data(), size) == stream.size());
+        CHECK_FOR_VECTOR_EQUALITY(input_data, output_data);
+
+        for (unsigned num_planes : {0u, 1u, 12u, static_cast<unsigned>(bits_of<bits_type>)}) {
+            const auto prefix_length = progressive_prefix_length<value_type>(stream.data(), size, num_planes);
+            REQUIRE(prefix_length <= stream.size());
+            const std::vector<bits_type> prefix(stream.begin(), stream.begin() + prefix_length);
+
+            CHECK(decompressor->decompress_planes(prefix.data(), num_planes, output_data.data(), size)
+                    == prefix_length);
+            const auto mask = num_planes > 0 ? ~bits_type{} << (bits_of<bits_type> - num_planes) : bits_type{};
+            size_t num_mismatches = 0;
+            for (size_t i = 0; i < input_data.size(); ++i) {
+                const auto bits = bit_cast<bits_type>(input_data[i]);
+                const auto output_bits = bit_cast<bits_type>(output_data[i]);
+                // Values in the border are always reproduced exactly
+                num_mismatches += output_bits != bits && output_bits != (bits & mask);
+            }
+            CHECK(num_mismatches == 0);
+        }
+    };
+
+    SECTION("serial CPU") { test_progressive(1, 1); }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU compress => serial CPU decompress", "[omp]") { test_progressive(4, 1); }
+    SECTION("serial CPU compress => OpenMP CPU decompress", "[omp]") { test_progressive(1, 4); }
+#endif
+
+    SECTION("invalid configurations are rejected") {
+        options.level = 1;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options), std::invalid_argument);
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        std::vector<value_type> output_data(input_data.size());
+        CHECK_THROWS_AS(make_decompressor<value_type>(dims, 1)->decompress_planes(
+                                stream.data(), 1, output_data.data(), size),
+                std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("previews are block averages of the decompressed array", "[encoder][preview]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 3;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    const auto input_data = make_random_vector<value_type>(ipow(n, dims));
+
+    auto test_preview = [&](const stream_options &options, unsigned num_threads) {
+        const auto compressor = make_compressor<value_type>(dims, num_threads, options);
+        const auto decompressor = make_decompressor<value_type>(dims, num_threads, options);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+        std::vector<value_type> full(input_data.size());
+        decompressor->decompress(stream.data(), full.data(), size);
+
+        for (unsigned factor : {1u, 2u, static_cast<unsigned>(side_length)}) {
+            const auto preview_size = static_extent<dims>{preview_extent(size, factor)};
+            std::vector<double> sums(num_elements(preview_size));
+            std::vector<index_type> counts(sums.size());
+            for (index_type i = 0; i < full.size(); ++i) {
+                const auto block = linear_index(preview_size, extent_from_linear_id(i, static_size) / factor);
+                sums[block] += full[i];
+                ++counts[block];
+            }
+
+            std::vector<value_type> preview(sums.size());
+            CHECK(decompressor->decompress_preview(stream.data(), factor, preview.data(), size) == stream.size());
+            size_t num_mismatches = 0;
+            for (size_t i = 0; i < preview.size(); ++i) {
+                const auto expected = sums[i] / counts[i];
+                const auto tolerance = 4 * std::numeric_limits<value_type>::epsilon() * std::max(1.0, expected);
+                num_mismatches += !(std::abs(preview[i] - expected) <= tolerance);
+            }
+            CHECK(num_mismatches == 0);
+        }
+    };
+
+    stream_options options;
+    SECTION("serial CPU") { test_preview(options, 1); }
+    SECTION("serial CPU with hypercube means") {
+        options.hypercube_means = true;
+        test_preview(options, 1);
+    }
+    SECTION("serial CPU, entropy-coded and truncated") {
+        options.level = 1;
+        options.mantissa_bits = 10;
+        test_preview(options, 1);
+    }
+    SECTION("serial CPU, fixed rate") {
+        options.fixed_rate = 8;
+        test_preview(options, 1);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") { test_preview(options, 4); }
+    SECTION("OpenMP CPU with hypercube means", "[omp]") {
+        options.hypercube_means = true;
+        test_preview(options, 4);
+    }
+#endif
+
+    SECTION("invalid factors are rejected") {
+        std::vector<value_type> preview(input_data.size());
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        const auto decompressor = make_decompressor<value_type>(dims, 1);
+        CHECK_THROWS_AS(decompressor->decompress_preview(stream.data(), 3, preview.data(), size),
+                std::invalid_argument);
+        CHECK_THROWS_AS(decompressor->decompress_preview(stream.data(), 2 * side_length, preview.data(), size),
+                std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("selective decompression only decodes hypercubes whose bounds match", "[encoder][bounds]",
+        ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 1;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    // Values are in [0, 1) except for one outlier in hypercube 2, and a NaN that does not affect the bounds
+    auto input_data = make_random_vector<value_type>(ipow(n, dims));
+    const auto outlier_hc_offset = extent_from_linear_id(2, static_size / side_length) * side_length;
+    input_data[linear_index(static_size, outlier_hc_offset)] = 10;
+    input_data[linear_index(static_size, outlier_hc_offset) + 1] = std::numeric_limits<value_type>::quiet_NaN();
+
+    stream_options options;
+    options.hypercube_bounds = true;
+
+    auto test_where = [&](unsigned num_threads) {
+        const auto compressor = make_compressor<value_type>(dims, num_threads, options);
+        const auto decompressor = make_decompressor<value_type>(dims, num_threads, options);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+
+        std::vector<value_type> output_data(input_data.size(), -1);
+        const auto exceeds_threshold = [](value_type, value_type max) { return max > 5; };
+        CHECK(decompressor->decompress_where(stream.data(), exceeds_threshold, output_data.data(), size) == 1);
+        size_t num_decoded = 0;
+        size_t num_mismatches = 0;
+        for (size_t i = 0; i < input_data.size(); ++i) {
+            const auto input_bits = bit_cast<bits_type>(input_data[i]);
+            num_decoded += bit_cast<bits_type>(output_data[i]) == input_bits;
+            num_mismatches += bit_cast<bits_type>(output_data[i]) != input_bits && output_data[i] != -1;
+        }
+        CHECK(num_decoded == ipow(side_length, dims) + border_element_count(static_size, side_length));
+        CHECK(num_mismatches == 0);
+        CHECK(output_data[linear_index(static_size, outlier_hc_offset)] == 10);
+
+        const auto everything = [](value_type, value_type) { return true; };
+        CHECK(decompressor->decompress_where(stream.data(), everything, output_data.data(), size)
+                == num_hypercubes(static_size));
+        CHECK(memcmp(input_data.data(), output_data.data(), input_data.size() * sizeof(value_type)) == 0);
+    };
+
+    SECTION("serial CPU") { test_where(1); }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") { test_where(4); }
+#endif
+
+    SECTION("duplicates share the bounds of the hypercube they refer to") {
+        const auto duplicate_hc_offset = extent_from_linear_id(3, static_size / side_length) * side_length;
+        cpu::copy_hypercube<profile>(outlier_hc_offset, duplicate_hc_offset, input_data.data(), static_size);
+        options.deduplicate = true;
+        for (unsigned num_threads : {1u, 4u}) {
+            const auto compressor = make_compressor<value_type>(dims, num_threads, options);
+            const auto decompressor = make_decompressor<value_type>(dims, num_threads, options);
+            std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+            stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+
+            std::vector<value_type> output_data(input_data.size());
+            const auto exceeds_threshold = [](value_type, value_type max) { return max > 5; };
+            CHECK(decompressor->decompress_where(stream.data(), exceeds_threshold, output_data.data(), size) == 2);
+            CHECK(output_data[linear_index(static_size, duplicate_hc_offset)] == 10);
+        }
+    }
+
+    SECTION("streams without bounds are rejected") {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        std::vector<value_type> output_data(input_data.size());
+        CHECK_THROWS_AS(make_decompressor<value_type>(dims, 1)->decompress_where(
+                                stream.data(), [](value_type, value_type) { return true; }, output_data.data(), size),
+                std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("region decompression matches the decompressed array", "[encoder][region]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 2 + 5;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    // Smooth in the first half to exercise deduplication and compression, random in the second for raw fallback
+    auto input_data = make_random_vector<value_type>(ipow(n, dims));
+    std::fill_n(input_data.begin(), input_data.size() / 2, value_type{1});
+
+    const auto test_regions = [&](unsigned num_threads, const stream_options &options) {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size, options));
+        const auto stream_length = make_compressor<value_type>(dims, num_threads, options)
+                                           ->compress(input_data.data(), size, stream.data());
+        const auto decompressor = make_decompressor<value_type>(dims, num_threads, options);
+        std::vector<value_type> full(input_data.size());
+        CHECK(decompressor->decompress(stream.data(), full.data(), size) == stream_length);
+
+        std::vector<box> regions;
+        regions.push_back(box{extent(dims), size});
+        regions.push_back(box{extent::broadcast(dims, side_length - 3), extent::broadcast(dims, side_length + 6)});
+        regions.push_back(box{extent::broadcast(dims, 2 * side_length + 1), extent::broadcast(dims, 4)});
+        regions.push_back(box{extent::broadcast(dims, 7), extent::broadcast(dims, 1)});
+        auto slab = box{extent(dims), size};
+        slab.offset[0] = n - 2;
+        slab.size[0] = 2;
+        regions.push_back(slab);
+        regions.push_back(box{extent::broadcast(dims, 5), extent(dims)});
+
+        for (const auto &region : regions) {
+            const auto region_size = static_extent<dims>{region.size};
+            std::vector<value_type> expected(num_elements(region.size));
+            for (index_type i = 0; i < expected.size(); ++i) {
+                const auto pos = static_extent<dims>{region.offset} + extent_from_linear_id(i, region_size);
+                expected[i] = full[linear_index(static_size, pos)];
+            }
+            std::vector<value_type> output(expected.size());
+            CHECK(decompressor->decompress_region(stream.data(), region, output.data(), size) == stream_length);
+            CHECK(memcmp(output.data(), expected.data(), output.size() * sizeof(value_type)) == 0);
+        }
+
+        auto out_of_bounds = box{extent(dims), size};
+        out_of_bounds.offset[0] = 1;
+        std::vector<value_type> output(input_data.size());
+        CHECK_THROWS_AS(decompressor->decompress_region(stream.data(), out_of_bounds, output.data(), size),
+                std::invalid_argument);
+    };
+
+    stream_options options;
+    SECTION("default") { test_regions(1, options); }
+
+    SECTION("compressed border, deduplication, raw fallback and entropy coding") {
+        options.compressed_border = true;
+        options.deduplicate = true;
+        options.raw_fallback = true;
+        options.level = 1;
+        test_regions(1, options);
+    }
+
+    SECTION("fixed rate") {
+        options.fixed_rate = 12;
+        test_regions(1, options);
+    }
+
+    SECTION("cross-predicted streams are decompressed in full") {
+        options.prediction_chain_length = 4;
+        test_regions(1, options);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") {
+        options.compressed_border = true;
+        options.deduplicate = true;
+        test_regions(4, options);
+    }
+#endif
+}
+
+TEMPLATE_TEST_CASE("statistics gathered during decompression match the decompressed array", "[encoder][statistics]",
+        ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 1;
+    const auto size = extent::broadcast(dims, n);
+
+    auto input_data = make_random_vector<value_type>(ipow(n, dims));
+    input_data[1] = std::numeric_limits<value_type>::quiet_NaN();
+    input_data[input_data.size() - 1] = std::numeric_limits<value_type>::quiet_NaN();
+
+    stream_options options;
+
+    auto test_statistics = [&](unsigned num_threads) {
+        const auto compressor = make_compressor<value_type>(dims, num_threads, options);
+        const auto decompressor = make_decompressor<value_type>(dims, num_threads, options);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(compressor->compress(input_data.data(), size, stream.data()));
+
+        std::vector<value_type> output_data(input_data.size());
+        array_statistics statistics;
+        CHECK(decompressor->decompress(stream.data(), output_data.data(), size, statistics) == stream.size());
+
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        double sum = 0;
+        double sum_of_squares = 0;
+        index_type nan_count = 0;
+        for (const auto value : output_data) {
+            if (std::isnan(value)) {
+                ++nan_count;
+                continue;
+            }
+            min = std::min<double>(min, value);
+            max = std::max<double>(max, value);
+            sum += value;
+            sum_of_squares += double{value} * value;
+        }
+        CHECK(statistics.nan_count == nan_count);
+        CHECK(statistics.min == min);
+        CHECK(statistics.max == max);
+        CHECK(statistics.mean == Approx(sum / static_cast<double>(output_data.size() - nan_count)));
+        CHECK(statistics.l2_norm == Approx(std::sqrt(sum_of_squares)));
+    };
+
+    SECTION("serial CPU") { test_statistics(1); }
+    SECTION("serial CPU, lossy") {
+        options.error_bound = 0.01;
+        test_statistics(1);
+    }
+    SECTION("serial CPU, fixed rate") {
+        options.fixed_rate = 8;
+        test_statistics(1);
+    }
+    SECTION("serial CPU, progressive") {
+        options.progressive = true;
+        test_statistics(1);
+    }
+    SECTION("serial CPU, truncated mantissa") {
+        options.mantissa_bits = 10;
+        test_statistics(1);
+    }
+    SECTION("serial CPU, duplicates") {
+        const auto static_size = static_extent<dims>{size};
+        const auto duplicate_hc_offset = extent_from_linear_id(2, static_size / side_length) * side_length;
+        cpu::copy_hypercube<profile>(static_extent<dims>{}, duplicate_hc_offset, input_data.data(), static_size);
+        options.deduplicate = true;
+        test_statistics(1);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") { test_statistics(4); }
+    SECTION("OpenMP CPU, lossy", "[omp]") {
+        options.error_bound = 0.01;
+        test_statistics(4);
+    }
+    SECTION("OpenMP CPU, fixed rate", "[omp]") {
+        options.fixed_rate = 8;
+        test_statistics(4);
+    }
+#endif
+}
+
+TEMPLATE_TEST_CASE("deduplicated streams reproduce arrays with repeated hypercubes", "[encoder][dedup]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 1;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+    const auto tile_size = static_extent<dims>::broadcast(side_length);
+    const auto hc_offset = [&](index_type hc_index) {
+        return extent_from_linear_id(hc_index, static_size / side_length) * side_length;
+    };
+
+    // Hypercubes 1 and 3 repeat the noise of hypercube 0
+    auto input_data = make_random_vector<value_type>(ipow(n, dims));
+    for (index_type i = 0; i < ipow(side_length, dims); ++i) {
+        const auto value = input_data[linear_index(static_size, hc_offset(0) + extent_from_linear_id(i, tile_size))];
+        for (const index_type hc_index : {1, 3}) {
+            input_data[linear_index(static_size, hc_offset(hc_index) + extent_from_linear_id(i, tile_size))] = value;
+        }
+    }
+
+    auto compress = [&](const std::vector<value_type> &data, unsigned num_threads, const stream_options &options) {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(make_compressor<value_type>(dims, num_threads, options)
+                              ->compress(data.data(), size, stream.data()));
+        return stream;
+    };
+    auto decompress = [&](const std::vector<bits_type> &stream, unsigned num_threads, const stream_options &options) {
+        std::vector<value_type> data(input_data.size());
+        CHECK(make_decompressor<value_type>(dims, num_threads, options)->decompress(stream.data(), data.data(), size)
+                == stream.size());
+        return data;
+    };
+
+    stream_options options;
+    options.deduplicate = true;
+
+    auto test_dedup = [&](unsigned num_threads) {
+        auto plain_options = options;
+        plain_options.deduplicate = false;
+        const auto plain_stream = compress(input_data, num_threads, plain_options);
+        const auto stream = compress(input_data, num_threads, options);
+        CHECK(stream.size() < plain_stream.size() - ipow(side_length, dims) / 4);
+
+        // Lossy duplicates reconstruct exactly like their source
+        const auto expected = decompress(plain_stream, num_threads, plain_options);
+        for (const unsigned decompress_threads : {1u, num_threads}) {
+            const auto output = decompress(stream, decompress_threads, options);
+            CHECK(memcmp(expected.data(), output.data(), expected.size() * sizeof(value_type)) == 0);
+        }
+    };
+
+    SECTION("serial CPU") { test_dedup(1); }
+    SECTION("serial CPU, adaptive prediction with level 1") {
+        options.adaptive_prediction = true;
+        options.level = 1;
+        test_dedup(1);
+    }
+    SECTION("serial CPU, error-bounded") {
+        options.error_bound = 0.01;
+        test_dedup(1);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") {
+        test_dedup(4);
+        CHECK_FOR_VECTOR_EQUALITY(compress(input_data, 1, options), compress(input_data, 4, options));
+    }
+#endif
+
+    SECTION("updating a source hypercube re-encodes its duplicates") {
+        const auto compressor = make_compressor<value_type>(dims, 1, options);
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        compressor->compress(input_data.data(), size, stream.data());
+
+        auto new_data = input_data;
+        new_data[linear_index(static_size, hc_offset(0))] = 42;
+        const box first_hc{extent::broadcast(dims, 0), extent::broadcast(dims, 1)};
+        stream.resize(compressor->update(new_data.data(), size, {first_hc}, stream.data()));
+        const auto output = decompress(stream, 1, options);
+        CHECK(memcmp(new_data.data(), output.data(), new_data.size() * sizeof(value_type)) == 0);
+    }
+
+    SECTION("invalid combinations are rejected") {
+        auto fixed_rate = options;
+        fixed_rate.fixed_rate = 8;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, fixed_rate), std::invalid_argument);
+        auto progressive = options;
+        progressive.progressive = true;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, progressive), std::invalid_argument);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options)
+                                ->compress(input_data.data(), input_data.data(), size, stream.data()),
+                std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("cross-hypercube prediction reproduces the input", "[encoder][cross]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 5 + 3;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    // A smooth field, where restarting the prediction at hypercube boundaries is most expensive
+    std::vector<value_type> input_data(ipow(n, dims));
+    for (index_type i = 0; i < input_data.size(); ++i) {
+        const auto pos = extent_from_linear_id(i, static_size);
+        value_type value = 1;
+        for (dim_type d = 0; d < dims; ++d) {
+            value += std::sin(static_cast<value_type>(pos[d]) / 7);
+        }
+        input_data[i] = value;
+    }
+
+    auto compress = [&](const std::vector<value_type> &data, unsigned num_threads, const stream_options &options) {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(make_compressor<value_type>(dims, num_threads, options)
+                              ->compress(data.data(), size, stream.data()));
+        return stream;
+    };
+    auto check_decompress = [&](const std::vector<bits_type> &stream, const std::vector<value_type> &expected,
+                                    unsigned num_threads, const stream_options &options) {
+        std::vector<value_type> output(expected.size());
+        CHECK(make_decompressor<value_type>(dims, num_threads, options)->decompress(stream.data(), output.data(), size)
+                == stream.size());
+        CHECK(memcmp(expected.data(), output.data(), expected.size() * sizeof(value_type)) == 0);
+    };
+
+    stream_options options;
+    options.prediction_chain_length = 2;
+
+    auto test_cross = [&](unsigned num_threads) {
+        const auto stream = compress(input_data, num_threads, options);
+        auto independent_options = options;
+        independent_options.prediction_chain_length = 0;
+        CHECK(stream.size() < compress(input_data, num_threads, independent_options).size());
+        for (const unsigned decompress_threads : {1u, num_threads}) {
+            check_decompress(stream, input_data, decompress_threads, options);
+        }
+    };
+
+    SECTION("serial CPU") { test_cross(1); }
+    SECTION("serial CPU, unbounded chains at level 1") {
+        options.prediction_chain_length = 1000;
+        options.level = 1;
+        test_cross(1);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") {
+        test_cross(4);
+        CHECK_FOR_VECTOR_EQUALITY(compress(input_data, 1, options), compress(input_data, 4, options));
+    }
+#endif
+
+    SECTION("updating a hypercube re-encodes its successors in the chain") {
+        const auto compressor = make_compressor<value_type>(dims, 1, options);
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        compressor->compress(input_data.data(), size, stream.data());
+
+        // The last value of the first row of hypercube 0 predicts the first value of that row in hypercube 1
+        auto new_data = input_data;
+        new_data[side_length - 1] = 42;
+        const box last_value{extent::broadcast(dims, 0), extent::broadcast(dims, 1)};
+        auto dirty = last_value;
+        dirty.offset[dims - 1] = side_length - 1;
+        stream.resize(compressor->update(new_data.data(), size, {dirty}, stream.data()));
+        CHECK_FOR_VECTOR_EQUALITY(compress(new_data, 1, options), stream);
+        check_decompress(stream, new_data, 1, options);
+    }
+
+    SECTION("invalid combinations are rejected") {
+        auto invalid_length = options;
+        invalid_length.prediction_chain_length = 1;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, invalid_length), std::invalid_argument);
+        auto adaptive = options;
+        adaptive.adaptive_prediction = true;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, adaptive), std::invalid_argument);
+        auto lossy = options;
+        lossy.error_bound = 0.01;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, lossy), std::invalid_argument);
+        auto deduplicated = options;
+        deduplicated.deduplicate = true;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, deduplicated), std::invalid_argument);
+        std::vector<value_type> preview(input_data.size());
+        CHECK_THROWS_AS(make_decompressor<value_type>(dims, 1, options)
+                                ->decompress_preview(nullptr, 1, preview.data(), size),
+                std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("jointly compressed fields reproduce their inputs", "[encoder][fields]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 3 + 5;
+    const auto size = extent::broadcast(dims, n);
+    const auto num_elements = ipow(n, dims);
+
+    // The second field is strongly correlated with the first, the third is independent noise
+    const auto noise = make_random_vector<value_type>(2 * num_elements);
+    std::vector<std::vector<value_type>> input_fields(3);
+    input_fields[0].assign(noise.begin(), noise.begin() + num_elements);
+    input_fields[2].assign(noise.begin() + num_elements, noise.end());
+    for (const auto value : input_fields[0]) {
+        input_fields[1].push_back(value * static_cast<value_type>(1.001));
+    }
+    std::vector<const value_type *> inputs;
+    for (const auto &field : input_fields) {
+        inputs.push_back(field.data());
+    }
+    const auto num_fields = static_cast<index_type>(inputs.size());
+
+    auto compress_fields = [&](unsigned num_threads, const stream_options &options) {
+        std::vector<bits_type> stream(num_fields * ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(make_compressor<value_type>(dims, num_threads, options)
+                              ->compress_fields(inputs.data(), num_fields, size, stream.data()));
+        return stream;
+    };
+    auto check_decompress_fields
+            = [&](const std::vector<bits_type> &stream, unsigned num_threads, const stream_options &options) {
+                  std::vector<std::vector<value_type>> output_fields(num_fields, std::vector<value_type>(num_elements));
+                  std::vector<value_type *> outputs;
+                  for (auto &field : output_fields) {
+                      outputs.push_back(field.data());
+                  }
+                  CHECK(make_decompressor<value_type>(dims, num_threads, options)
+                                  ->decompress_fields(stream.data(), outputs.data(), num_fields, size)
+                          == stream.size());
+                  for (index_type field = 0; field < num_fields; ++field) {
+                      CHECK(memcmp(input_fields[field].data(), output_fields[field].data(),
+                                    num_elements * sizeof(value_type))
+                              == 0);
+                  }
+              };
+
+    stream_options options;
+
+    auto test_fields = [&](unsigned num_threads) {
+        const auto stream = compress_fields(num_threads, options);
+        index_type separate_length = 0;
+        for (const auto &field : input_fields) {
+            std::vector<bits_type> separate_stream(ndzip::compressed_length_bound<value_type>(size));
+            separate_length += make_compressor<value_type>(dims, num_threads, options)
+                                       ->compress(field.data(), size, separate_stream.data());
+        }
+        CHECK(stream.size() < separate_length);
+        for (const unsigned decompress_threads : {1u, num_threads}) {
+            check_decompress_fields(stream, decompress_threads, options);
+        }
+    };
+
+    SECTION("serial CPU") { test_fields(1); }
+    SECTION("serial CPU, level 2") {
+        options.level = 2;
+        test_fields(1);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") {
+        test_fields(4);
+        CHECK_FOR_VECTOR_EQUALITY(compress_fields(1, options), compress_fields(4, options));
+    }
+#endif
+
+    SECTION("mismatching fields and options are rejected") {
+        const auto stream = compress_fields(1, options);
+        std::vector<value_type> output(num_elements);
+        value_type *const outputs[] = {output.data(), output.data()};
+        CHECK_THROWS_AS(make_decompressor<value_type>(dims, 1, options)
+                                ->decompress_fields(stream.data(), outputs, 2, size),
+                std::runtime_error);
+        auto lossy = options;
+        lossy.error_bound = 0.01;
+        std::vector<bits_type> lossy_stream(num_fields * ndzip::compressed_length_bound<value_type>(size));
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, lossy)
+                                ->compress_fields(inputs.data(), num_fields, size, lossy_stream.data()),
+                std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("custom hypercube shapes reproduce their inputs", "[encoder][shape]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+
+    // Thin along the outermost dimension, where cubic hypercubes leave most of the array to the border
+    extent size(dims);
+    for (dim_type d = 0; d < dims; ++d) {
+        size[d] = dims == 1 ? 5000 : d == 0 ? 20 / (dims - 1) : 300 / (dims - 1) + d;
+    }
+    const auto static_size = static_extent<dims>{size};
+    const auto num_elements = ndzip::num_elements(size);
+    std::vector<value_type> input_data(num_elements);
+    for (index_type i = 0; i < num_elements; ++i) {
+        const auto pos = extent_from_linear_id(i, static_size);
+        value_type value = 1;
+        for (dim_type d = 0; d < dims; ++d) {
+            value += std::sin(static_cast<value_type>(pos[d]) / 7);
+        }
+        input_data[i] = value;
+    }
+
+    const auto make_shape = [](std::initializer_list<index_type> extents) {
+        extent shape(static_cast<dim_type>(extents.size()));
+        std::copy(extents.begin(), extents.end(), shape.begin());
+        return shape;
+    };
+    // The second shape is thin along the outermost dimension
+    std::vector<extent> shapes;
+    if constexpr (dims == 1) {
+        shapes = {make_shape({4096})};
+    } else if constexpr (dims == 2) {
+        shapes = {make_shape({64, 64}), make_shape({16, 256}), make_shape({256, 16})};
+    } else {
+        shapes = {make_shape({16, 16, 16}), make_shape({4, 32, 32}), make_shape({8, 16, 32}),
+                make_shape({32, 16, 8})};
+    }
+
+    auto compress = [&](unsigned num_threads, const stream_options &options) {
+        const auto bound = options.hypercube_shape
+                ? ndzip::compressed_length_bound<value_type>(size, *options.hypercube_shape)
+                : ndzip::compressed_length_bound<value_type>(size);
+        std::vector<bits_type> stream(bound);
+        stream.resize(make_compressor<value_type>(dims, num_threads, options)
+                              ->compress(input_data.data(), size, stream.data()));
+        CHECK(stream.size() <= bound);
+        return stream;
+    };
+    auto check_decompress = [&](const std::vector<bits_type> &stream, unsigned num_threads,
+                                    const stream_options &options) {
+        std::vector<value_type> output(num_elements);
+        array_statistics statistics;
+        CHECK(make_decompressor<value_type>(dims, num_threads, options)
+                        ->decompress(stream.data(), output.data(), size, statistics)
+                == stream.size());
+        CHECK(memcmp(input_data.data(), output.data(), num_elements * sizeof(value_type)) == 0);
+        CHECK(statistics.nan_count == 0);
+        CHECK(statistics.max == *std::max_element(input_data.begin(), input_data.end()));
+    };
+
+    stream_options options;
+
+    SECTION("serial CPU") {
+        for (const auto level : {0, 1}) {
+            options.level = level;
+            for (const auto &shape : shapes) {
+                options.hypercube_shape = shape;
+                check_decompress(compress(1, options), 1, options);
+            }
+        }
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") {
+        for (const auto &shape : shapes) {
+            options.hypercube_shape = shape;
+            const auto stream = compress(4, options);
+            CHECK_FOR_VECTOR_EQUALITY(compress(1, options), stream);
+            check_decompress(stream, 4, options);
+        }
+    }
+#endif
+
+    SECTION("cubic shapes encode like the default profile") {
+        const auto default_stream = compress(1, options);
+        options.hypercube_shape = extent::broadcast(dims, side_length);
+        const auto stream = compress(1, options);
+        REQUIRE(stream.size() > default_stream.size());
+        CHECK(std::equal(default_stream.begin(), default_stream.end(), stream.end() - default_stream.size()));
+    }
+
+    if constexpr (dims > 1) {
+        SECTION("thin shapes shrink the border of thin arrays") {
+            const auto default_length = compress(1, options).size();
+            options.hypercube_shape = shapes[1];
+            CHECK(compress(1, options).size() < default_length);
+        }
+    }
+
+    SECTION("unsupported shapes and combinations are rejected") {
+        auto unsupported = options;
+        unsupported.hypercube_shape = extent::broadcast(dims, side_length * 2);
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, unsupported), std::invalid_argument);
+        unsupported.hypercube_shape = extent::broadcast(dims == 1 ? 2 : 1, side_length);
+        CHECK_THROWS_AS(make_decompressor<value_type>(dims, 1, unsupported), std::invalid_argument);
+        unsupported.hypercube_shape = shapes[0];
+        unsupported.deduplicate = true;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, unsupported), std::invalid_argument);
+
+        options.hypercube_shape = shapes.back();
+        const auto stream = compress(1, options);
+        std::vector<value_type> output(num_elements);
+        if (shapes.size() > 1) {
+            auto other_shape = options;
+            other_shape.hypercube_shape = shapes.front();
+            CHECK_THROWS_AS(make_decompressor<value_type>(dims, 1, other_shape)
+                                    ->decompress(stream.data(), output.data(), size),
+                    std::runtime_error);
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("tuning picks options that reproduce the input", "[encoder][tune]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+
+    // A smooth array that is thin along the outermost dimension
+    extent size(dims);
+    for (dim_type d = 0; d < dims; ++d) {
+        size[d] = dims == 1 ? side_length * 6 + 100 : d == 0 ? side_length / 2 + 1 : side_length * 4 + 3;
+    }
+    const auto static_size = static_extent<dims>{size};
+    const auto num_elements = ndzip::num_elements(size);
+    std::vector<value_type> input_data(num_elements);
+    for (index_type i = 0; i < num_elements; ++i) {
+        const auto pos = extent_from_linear_id(i, static_size);
+        value_type value = 1;
+        for (dim_type d = 0; d < dims; ++d) {
+            value += std::sin(static_cast<value_type>(pos[d]) / 7);
+        }
+        input_data[i] = value;
+    }
+
+    auto compress = [&](const stream_options &options) {
+        std::vector<bits_type> stream(options.hypercube_shape
+                        ? ndzip::compressed_length_bound<value_type>(size, *options.hypercube_shape)
+                        : ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(make_compressor<value_type>(dims, 1, options)->compress(input_data.data(), size, stream.data()));
+        std::vector<value_type> output(num_elements);
+        CHECK(make_decompressor<value_type>(dims, 1, options)->decompress(stream.data(), output.data(), size)
+                == stream.size());
+        CHECK(memcmp(input_data.data(), output.data(), num_elements * sizeof(value_type)) == 0);
+        return stream.size();
+    };
+    const auto default_length = compress(stream_options{});
+
+    SECTION("for the best ratio") {
+        const auto result = tune(input_data.data(), size, tuning_objective::ratio, 1.0);
+        const auto length = compress(result.options);
+        CHECK(length <= default_length);
+        const auto ratio = static_cast<double>(length * sizeof(bits_type)) / (num_elements * sizeof(value_type));
+        CHECK(result.estimated_ratio == Approx(ratio).epsilon(0.05));
+        if constexpr (dims > 1) { CHECK(result.options.hypercube_shape.has_value()); }
+    }
+
+    SECTION("for throughput") {
+        const auto result = tune(input_data.data(), size, tuning_objective::throughput);
+        CHECK(result.options.level == 0);
+        CHECK(result.estimated_throughput > 0);
+        compress(result.options);
+    }
+
+    SECTION("for a balance of both") { compress(tune(input_data.data(), size, tuning_objective::balanced).options); }
+
+    SECTION("invalid sample fractions are rejected") {
+        CHECK_THROWS_AS(tune(input_data.data(), size, tuning_objective::ratio, 0.0), std::invalid_argument);
+        CHECK_THROWS_AS(tune(input_data.data(), size, tuning_objective::ratio, 1.5), std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("compressed length estimates match the compressed length", "[encoder][estimate]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = dims == 1 ? side_length * 40 + 17 : side_length * (dims == 2 ? 6 : 4) + 3;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    // Smooth with noise whose amplitude varies across the array, so that hypercubes differ in length
+    const auto noise = make_random_vector<value_type>(ipow(n, dims));
+    std::vector<value_type> input_data(noise.size());
+    for (index_type i = 0; i < input_data.size(); ++i) {
+        const auto pos = extent_from_linear_id(i, static_size);
+        value_type value = 1;
+        for (dim_type d = 0; d < dims; ++d) {
+            value += std::sin(static_cast<value_type>(pos[d]) / 7);
+        }
+        input_data[i] = value + noise[i] * static_cast<value_type>(pos[0]) / static_cast<value_type>(n) * 1e-3f;
+    }
+
+    std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+    const auto length = make_compressor<value_type>(dims, 1)->compress(input_data.data(), size, stream.data());
+
+    SECTION("counting all hypercubes is exact") {
+        const auto estimate = estimate_compressed_length(input_data.data(), size, 1.0);
+        CHECK(estimate.exact);
+        CHECK(estimate.length == length);
+        CHECK(estimate.lower_bound == length);
+        CHECK(estimate.upper_bound == length);
+    }
+
+    SECTION("sampling brackets the length") {
+        const auto estimate = estimate_compressed_length(input_data.data(), size, 0.1);
+        CHECK(!estimate.exact);
+        CHECK(estimate.lower_bound <= estimate.length);
+        CHECK(estimate.length <= estimate.upper_bound);
+        CHECK(estimate.lower_bound <= length);
+        CHECK(length <= estimate.upper_bound);
+        CHECK(static_cast<double>(estimate.length) == Approx(length).epsilon(0.1));
+    }
+
+    SECTION("invalid sample fractions are rejected") {
+        CHECK_THROWS_AS(estimate_compressed_length(input_data.data(), size, 0.0), std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("raw fallback stores incompressible hypercubes raw", "[encoder][raw]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + 1;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    // Random bit patterns, which no predictor can compress
+    const auto make_noise = [&] {
+        const auto bits = make_random_vector<bits_type>(ipow(n, dims));
+        std::vector<value_type> noise(bits.size());
+        std::transform(bits.begin(), bits.end(), noise.begin(), [](bits_type b) { return bit_cast<value_type>(b); });
+        return noise;
+    };
+
+    // The first half of the array is noise, the second half is smooth
+    auto input_data = make_noise();
+    for (index_type i = 0; i < input_data.size(); ++i) {
+        const auto pos = extent_from_linear_id(i, static_size);
+        if (pos[0] >= n / 2) { input_data[i] = std::sin(static_cast<value_type>(i) / 100); }
+    }
+
+    auto compress = [&](const std::vector<value_type> &data, unsigned num_threads, const stream_options &options) {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(make_compressor<value_type>(dims, num_threads, options)
+                              ->compress(data.data(), size, stream.data()));
+        return stream;
+    };
+    auto decompress = [&](const std::vector<bits_type> &stream, unsigned num_threads, const stream_options &options) {
+        std::vector<value_type> data(input_data.size());
+        CHECK(make_decompressor<value_type>(dims, num_threads, options)->decompress(stream.data(), data.data(), size)
+                == stream.size());
+        return data;
+    };
+
+    stream_options options;
+    options.raw_fallback = true;
+
+    auto test_raw_fallback = [&](unsigned num_threads) {
+        auto plain_options = options;
+        plain_options.raw_fallback = false;
+        const auto stream = compress(input_data, num_threads, options);
+        CHECK(stream.size() < compress(input_data, num_threads, plain_options).size());
+        CHECK(stream.size() <= ndzip::compressed_length_bound<value_type>(size, options));
+        for (const unsigned decompress_threads : {1u, num_threads}) {
+            const auto output = decompress(stream, decompress_threads, options);
+            CHECK(memcmp(input_data.data(), output.data(), input_data.size() * sizeof(value_type)) == 0);
+        }
+    };
+
+    SECTION("serial CPU") { test_raw_fallback(1); }
+    SECTION("serial CPU, level 2 with adaptive prediction, means and bounds") {
+        options.level = 2;
+        options.adaptive_prediction = true;
+        options.hypercube_means = true;
+        options.hypercube_bounds = true;
+        test_raw_fallback(1);
+    }
+    SECTION("serial CPU, prediction chains") {
+        options.prediction_chain_length = 3;
+        test_raw_fallback(1);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") {
+        test_raw_fallback(4);
+        CHECK_FOR_VECTOR_EQUALITY(compress(input_data, 1, options), compress(input_data, 4, options));
+    }
+#endif
+
+    SECTION("deduplication, updates and selective decoding") {
+        options.deduplicate = true;
+        options.hypercube_bounds = true;
+
+        // Hypercube 1 repeats the noise of hypercube 0
+        auto data = input_data;
+        const auto tile_size = static_extent<dims>::broadcast(side_length);
+        const auto second_hc_offset = extent_from_linear_id(1, static_size / side_length) * side_length;
+        for (index_type i = 0; i < ipow(side_length, dims); ++i) {
+            const auto pos = extent_from_linear_id(i, tile_size);
+            data[linear_index(static_size, second_hc_offset + pos)] = data[linear_index(static_size, pos)];
+        }
+        const auto compressor = make_compressor<value_type>(dims, 1, options);
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        compressor->compress(data.data(), size, stream.data());
+
+        data[data.size() - 1] = 42;
+        const box last_element{extent::broadcast(dims, n - 1), extent::broadcast(dims, 1)};
+        stream.resize(compressor->update(data.data(), size, {last_element}, stream.data()));
+        const auto decompressor = make_decompressor<value_type>(dims, 1, options);
+        std::vector<value_type> output(data.size());
+        CHECK(decompressor->decompress(stream.data(), output.data(), size) == stream.size());
+        CHECK(memcmp(data.data(), output.data(), data.size() * sizeof(value_type)) == 0);
+
+        std::fill(output.begin(), output.end(), value_type{});
+        const auto everything = [](value_type, value_type) { return true; };
+        decompressor->decompress_where(stream.data(), everything, output.data(), size);
+        CHECK(memcmp(data.data(), output.data(), data.size() * sizeof(value_type)) == 0);
+    }
+
+    SECTION("noise is bounded by its raw size") {
+        const auto noise = make_noise();
+        const auto bound = ndzip::compressed_length_bound<value_type>(size, options);
+        CHECK(bound < ndzip::compressed_length_bound<value_type>(size));
+        CHECK(compress(noise, 1, options).size() <= bound);
+    }
+
+    SECTION("invalid combinations are rejected") {
+        for (auto lossy : {&stream_options::fixed_rate, &stream_options::mantissa_bits}) {
+            auto invalid = options;
+            invalid.*lossy = 8;
+            CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, invalid), std::invalid_argument);
+        }
+        auto progressive = options;
+        progressive.progressive = true;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, progressive), std::invalid_argument);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options)
+                                ->compress(input_data.data(), input_data.data(), size, stream.data()),
+                std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("compressed borders reproduce their inputs", "[encoder][border]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 2 + side_length / 2 + 3;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+
+    // A ramp, which compresses well everywhere
+    std::vector<value_type> input_data(ipow(n, dims));
+    for (index_type i = 0; i < input_data.size(); ++i) {
+        const auto pos = extent_from_linear_id(i, static_size);
+        value_type value = 1;
+        for (dim_type d = 0; d < dims; ++d) {
+            value += static_cast<value_type>(pos[d]) / 4;
+        }
+        input_data[i] = value;
+    }
+
+    auto compress = [&](const std::vector<value_type> &data, const extent &data_size, unsigned num_threads,
+                            const stream_options &options) {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(data_size, options));
+        stream.resize(make_compressor<value_type>(dims, num_threads, options)
+                              ->compress(data.data(), data_size, stream.data()));
+        return stream;
+    };
+    auto decompress = [&](const std::vector<bits_type> &stream, const extent &data_size, unsigned num_threads,
+                              const stream_options &options) {
+        std::vector<value_type> data(num_elements(data_size));
+        CHECK(make_decompressor<value_type>(dims, num_threads, options)
+                        ->decompress(stream.data(), data.data(), data_size)
+                == stream.size());
+        return data;
+    };
+
+    stream_options options;
+    options.compressed_border = true;
+
+    auto test_border = [&](unsigned num_threads) {
+        auto plain_options = options;
+        plain_options.compressed_border = false;
+        const auto plain_stream = compress(input_data, size, num_threads, plain_options);
+        const auto stream = compress(input_data, size, num_threads, options);
+        CHECK(stream.size() < plain_stream.size() - border_element_count(static_size, side_length) / 2);
+
+        // Lossy streams decode the border losslessly either way
+        const auto expected = decompress(plain_stream, size, num_threads, plain_options);
+        for (const unsigned decompress_threads : {1u, num_threads}) {
+            const auto output = decompress(stream, size, decompress_threads, options);
+            CHECK(memcmp(expected.data(), output.data(), expected.size() * sizeof(value_type)) == 0);
+        }
+    };
+
+    SECTION("serial CPU") { test_border(1); }
+    SECTION("serial CPU, level 1 with adaptive prediction, deduplication and raw fallback") {
+        options.level = 1;
+        options.adaptive_prediction = true;
+        options.deduplicate = true;
+        options.raw_fallback = true;
+        test_border(1);
+    }
+    SECTION("serial CPU, error-bounded") {
+        options.error_bound = 0.01;
+        test_border(1);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") {
+        test_border(4);
+        CHECK_FOR_VECTOR_EQUALITY(compress(input_data, size, 1, options), compress(input_data, size, 4, options));
+    }
+#endif
+
+    SECTION("tiny arrays and incompressible borders are stored raw") {
+        const auto tiny_size = extent::broadcast(dims, 3);
+        const std::vector<value_type> tiny_data(input_data.begin(), input_data.begin() + num_elements(tiny_size));
+        auto stream = compress(tiny_data, tiny_size, 1, options);
+        CHECK(stream[stream.size() - tiny_data.size() - 1] == 0);  // raw border encoding
+        auto output = decompress(stream, tiny_size, 1, options);
+        CHECK(memcmp(tiny_data.data(), output.data(), tiny_data.size() * sizeof(value_type)) == 0);
+
+        const auto bits = make_random_vector<bits_type>(input_data.size());
+        std::vector<value_type> noise(bits.size());
+        std::transform(bits.begin(), bits.end(), noise.begin(), [](bits_type b) { return bit_cast<value_type>(b); });
+        stream = compress(noise, size, 1, options);
+        CHECK(stream[stream.size() - border_element_count(static_size, side_length) - 1] == 0);
+        output = decompress(stream, size, 1, options);
+        CHECK(memcmp(noise.data(), output.data(), noise.size() * sizeof(value_type)) == 0);
+    }
+
+    SECTION("updates, previews, selective decoding and statistics") {
+        options.hypercube_bounds = true;
+        const auto compressor = make_compressor<value_type>(dims, 1, options);
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size, options));
+        compressor->compress(input_data.data(), size, stream.data());
+
+        auto data = input_data;
+        data[data.size() - 1] = 1e6;
+        const box last_element{extent::broadcast(dims, n - 1), extent::broadcast(dims, 1)};
+        stream.resize(compressor->update(data.data(), size, {last_element}, stream.data()));
+        const auto decompressor = make_decompressor<value_type>(dims, 1, options);
+        std::vector<value_type> output(data.size());
+        array_statistics statistics;
+        CHECK(decompressor->decompress(stream.data(), output.data(), size, statistics) == stream.size());
+        CHECK(memcmp(data.data(), output.data(), data.size() * sizeof(value_type)) == 0);
+        CHECK(statistics.max == 1e6);
+
+        std::fill(output.begin(), output.end(), value_type{});
+        const auto everything = [](value_type, value_type) { return true; };
+        decompressor->decompress_where(stream.data(), everything, output.data(), size);
+        CHECK(memcmp(data.data(), output.data(), data.size() * sizeof(value_type)) == 0);
+
+        auto plain_options = options;
+        plain_options.compressed_border = false;
+        std::vector<bits_type> plain_stream(ndzip::compressed_length_bound<value_type>(size));
+        make_compressor<value_type>(dims, 1, plain_options)->compress(data.data(), size, plain_stream.data());
+        const auto factor = side_length / 4;
+        std::vector<value_type> preview(num_elements(preview_extent(size, factor)));
+        auto expected_preview = preview;
+        CHECK(decompressor->decompress_preview(stream.data(), factor, preview.data(), size) == stream.size());
+        make_decompressor<value_type>(dims, 1, plain_options)
+                ->decompress_preview(plain_stream.data(), factor, expected_preview.data(), size);
+        CHECK_FOR_VECTOR_EQUALITY(preview, expected_preview);
+    }
+
+    SECTION("invalid combinations are rejected") {
+        auto fixed_rate = options;
+        fixed_rate.fixed_rate = 8;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, fixed_rate), std::invalid_argument);
+        auto progressive = options;
+        progressive.progressive = true;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, progressive), std::invalid_argument);
+
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options)
+                                ->compress(input_data.data(), input_data.data(), size, stream.data()),
+                std::invalid_argument);
+    }
+}
+
+#if NDZIP_OPENMP_SUPPORT
+TEMPLATE_TEST_CASE("OpenMP CPU packs and unpacks large borders in parallel", "[omp][border]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 4 + side_length - 1;
+    const auto size = extent::broadcast(dims, n);
+
+    const auto reference = make_random_vector<value_type>(ipow(n, dims));
+    auto input_data = reference;
+    for (index_type i = 0; i < input_data.size(); i += 3) {
+        input_data[i] = input_data[i] * value_type{2};
+    }
+
+    auto compress = [&](unsigned num_threads, const value_type *ref) {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size));
+        stream.resize(make_compressor<value_type>(dims, num_threads)
+                              ->compress(input_data.data(), ref, size, stream.data()));
+        return stream;
+    };
+
+    for (const auto *ref : {static_cast<const value_type *>(nullptr), reference.data()}) {
+        const auto stream = compress(1, ref);
+        CHECK_FOR_VECTOR_EQUALITY(stream, compress(4, ref));
+
+        std::vector<value_type> output_data(input_data.size());
+        CHECK(make_decompressor<value_type>(dims, 4)->decompress(stream.data(), ref, output_data.data(), size)
+                == stream.size());
+        CHECK_FOR_VECTOR_EQUALITY(input_data, output_data);
+    }
+}
+#endif
+
+TEMPLATE_TEST_CASE("folded dimensions store thin arrays as lower-dimensional ones", "[encoder][fold]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    extent size(dims);
+    std::optional<extent> expected_folded_size;
+    if constexpr (dims == 1) {
+        size = extent{4 * 4096 + 5};
+    } else if constexpr (dims == 2) {
+        size = extent{8, 8192};
+        expected_folded_size = extent{65536};
+    } else {
+        size = extent{4, 128, 256};
+        expected_folded_size = extent{512, 256};
+    }
+    const auto folding = fold_dimensions(size);
+    REQUIRE(folding.has_value() == expected_folded_size.has_value());
+    if (folding) { CHECK(folding->folded_size == *expected_folded_size); }
+
+    std::vector<value_type> input_data(num_elements(size));
+    for (index_type i = 0; i < input_data.size(); ++i) {
+        input_data[i] = static_cast<value_type>(i / 7);
+    }
+
+    auto compress = [](const std::vector<value_type> &data, const extent &data_size, unsigned num_threads,
+                            const stream_options &options) {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(data_size, options));
+        stream.resize(make_compressor<value_type>(data_size.dimensions(), num_threads, options)
+                              ->compress(data.data(), data_size, stream.data()));
+        return stream;
+    };
+    auto decompress = [](const std::vector<bits_type> &stream, const extent &data_size, unsigned num_threads,
+                              const stream_options &options) {
+        std::vector<value_type> data(num_elements(data_size));
+        CHECK(make_decompressor<value_type>(data_size.dimensions(), num_threads, options)
+                        ->decompress(stream.data(), data.data(), data_size)
+                == stream.size());
+        return data;
+    };
+
+    stream_options options;
+    options.fold_dimensions = true;
+
+    auto test_folding = [&](unsigned num_threads) {
+        auto plain_options = options;
+        plain_options.fold_dimensions = false;
+        const auto plain_stream = compress(input_data, size, num_threads, plain_options);
+        const auto stream = compress(input_data, size, num_threads, options);
+        if (folding) {
+            CHECK(stream.size() < plain_stream.size() * 3 / 4);
+            // The folded stream is the stream of the folded array behind a preamble
+            const auto folded_stream = compress(input_data, folding->folded_size, num_threads, plain_options);
+            const auto preamble_words = preamble_length<bits_type>(make_folded_preamble(folding->folded_size));
+            REQUIRE(stream.size() == preamble_words + folded_stream.size());
+            CHECK(std::equal(folded_stream.begin(), folded_stream.end(), stream.begin() + preamble_words));
+        } else {
+            CHECK_FOR_VECTOR_EQUALITY(stream, plain_stream);
+        }
+        for (const unsigned decompress_threads : {1u, num_threads}) {
+            CHECK_FOR_VECTOR_EQUALITY(decompress(stream, size, decompress_threads, options), input_data);
+        }
+
+        // Regions of folded streams are cut out of a full decompression
+        const auto region = box{size - extent::broadcast(dims, 1), extent::broadcast(dims, 1)};
+        value_type last_element = -1;
+        CHECK(make_decompressor<value_type>(dims, num_threads, options)
+                        ->decompress_region(stream.data(), region, &last_element, size)
+                == stream.size());
+        CHECK(last_element == input_data.back());
+    };
+
+    SECTION("serial CPU") { test_folding(1); }
+    SECTION("serial CPU, level 1 with adaptive prediction and compressed border") {
+        options.level = 1;
+        options.adaptive_prediction = true;
+        options.compressed_border = true;
+        test_folding(1);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") {
+        test_folding(4);
+        CHECK_FOR_VECTOR_EQUALITY(compress(input_data, size, 1, options), compress(input_data, size, 4, options));
+    }
+#endif
+
+    SECTION("singleton axes are squeezed") {
+        auto squeezed_size = extent::broadcast(dims, 1);
+        squeezed_size[dims - 1] = 3 * 4096;
+        const auto squeezed = fold_dimensions(squeezed_size);
+        REQUIRE(squeezed.has_value() == (dims > 1));
+        if (squeezed) { CHECK(squeezed->folded_size == extent{3 * 4096}); }
+
+        const std::vector<value_type> row(input_data.begin(), input_data.begin() + 3 * 4096);
+        const auto stream = compress(row, squeezed_size, 1, options);
+        CHECK_FOR_VECTOR_EQUALITY(decompress(stream, squeezed_size, 1, options), row);
+    }
+
+    SECTION("updates, selective decoding and multiple fields") {
+        options.hypercube_bounds = true;
+        const auto compressor = make_compressor<value_type>(dims, 1, options);
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size, options));
+        compressor->compress(input_data.data(), size, stream.data());
+
+        auto data = input_data;
+        auto last_index = size;
+        for (auto &component : last_index) {
+            component -= 1;
+        }
+        data[data.size() - 1] = 1e6;
+        const box last_element{last_index, extent::broadcast(dims, 1)};
+        stream.resize(compressor->update(data.data(), size, {last_element}, stream.data()));
+        CHECK_FOR_VECTOR_EQUALITY(decompress(stream, size, 1, options), data);
+
+        const auto decompressor = make_decompressor<value_type>(dims, 1, options);
+        std::vector<value_type> output(data.size());
+        const auto everything = [](value_type, value_type) { return true; };
+        decompressor->decompress_where(stream.data(), everything, output.data(), size);
+        CHECK_FOR_VECTOR_EQUALITY(output, data);
+
+        const value_type *fields[] = {input_data.data(), data.data()};
+        std::vector<bits_type> fields_stream(2 * ndzip::compressed_length_bound<value_type>(size, options));
+        auto fields_options = options;
+        fields_options.hypercube_bounds = false;
+        const auto fields_length = make_compressor<value_type>(dims, 1, fields_options)
+                                           ->compress_fields(fields, 2, size, fields_stream.data());
+        std::vector<value_type> first(data.size()), second(data.size());
+        value_type *outputs[] = {first.data(), second.data()};
+        CHECK(make_decompressor<value_type>(dims, 1, fields_options)
+                        ->decompress_fields(fields_stream.data(), outputs, 2, size)
+                == fields_length);
+        CHECK_FOR_VECTOR_EQUALITY(first, input_data);
+        CHECK_FOR_VECTOR_EQUALITY(second, data);
+    }
+
+    if (folding) {
+        SECTION("mismatched streams and unsupported operations are rejected") {
+            auto plain_options = options;
+            plain_options.fold_dimensions = false;
+            const auto plain_stream = compress(input_data, size, 1, plain_options);
+            std::vector<value_type> output(input_data.size());
+            const auto decompressor = make_decompressor<value_type>(dims, 1, options);
+            CHECK_THROWS_AS(decompressor->decompress(plain_stream.data(), output.data(), size), std::runtime_error);
+            const auto stream = compress(input_data, size, 1, options);
+            CHECK_THROWS_AS(decompressor->decompress_preview(stream.data(), 2, output.data(), size),
+                    std::invalid_argument);
+
+            auto progressive = options;
+            progressive.progressive = true;
+            CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, progressive), std::invalid_argument);
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("frame headers make streams self-describing", "[encoder][frame]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 3 + 5;
+    const auto size = extent::broadcast(dims, n);
+    const auto input_data = make_random_vector<value_type>(num_elements(size));
+
+    stream_options options;
+    options.level = 1;
+    options.adaptive_prediction = true;
+    options.compressed_border = true;
+
+    // The stream follows the header, which is a whole number of stream words long
+    static_assert(frame_header_size % sizeof(bits_type) == 0);
+    constexpr auto frame_length = frame_header_size / sizeof(bits_type);
+    std::vector<bits_type> framed(frame_length + ndzip::compressed_length_bound<value_type>(size, options));
+    const auto stream_length = make_compressor<value_type>(dims, 1, options)
+                                       ->compress(input_data.data(), size, framed.data() + frame_length);
+    frame_header header{element_type_of<value_type>, size, options, stream_length * sizeof(bits_type)};
+    write_frame_header(header, framed.data());
+    framed.resize(frame_length + stream_length);
+
+    const auto bytes = framed.size() * sizeof(bits_type);
+    REQUIRE(is_frame_header(framed.data(), bytes));
+    const auto read = read_frame_header(framed.data(), bytes);
+    CHECK(read.type == element_type_of<value_type>);
+    CHECK(read.data_size == size);
+    CHECK(read.stream_length == stream_length * sizeof(bits_type));
+    CHECK(read.options.level == options.level);
+    CHECK(read.options.adaptive_prediction);
+    CHECK(read.options.compressed_border);
+    CHECK(!read.options.hypercube_shape);
+
+    auto decompress = [&](unsigned num_threads) {
+        std::vector<value_type> output(num_elements(read.data_size));
+        CHECK(make_decompressor<value_type>(read, num_threads)
+                        ->decompress(framed.data() + frame_length, output.data(), read.data_size)
+                == stream_length);
+        CHECK_FOR_VECTOR_EQUALITY(output, input_data);
+    };
+
+    SECTION("serial CPU") { decompress(1); }
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") { decompress(4); }
+#endif
+
+    SECTION("hypercube shapes and lossy options round-trip") {
+        stream_options shaped;
+        shaped.hypercube_shape = cpu::list_hypercube_shapes(dims).back();
+        shaped.error_bound = 0.25;
+        shaped.prediction_chain_length = 3;
+        std::vector<std::byte> buffer(frame_header_size);
+        write_frame_header(frame_header{element_type_of<value_type>, size, shaped, 0}, buffer.data());
+        const auto shaped_header = read_frame_header(buffer.data(), buffer.size());
+        CHECK(shaped_header.options.hypercube_shape == shaped.hypercube_shape);
+        CHECK(shaped_header.options.error_bound == shaped.error_bound);
+        CHECK(shaped_header.options.prediction_chain_length == shaped.prediction_chain_length);
+    }
+
+    SECTION("raw streams, corrupt headers and other element types are rejected") {
+        CHECK(!is_frame_header(framed.data() + frame_length, (framed.size() - frame_length) * sizeof(bits_type)));
+        CHECK(!is_frame_header(framed.data(), frame_header_size - 1));
+        CHECK_THROWS_AS(read_frame_header(framed.data() + frame_length, stream_length * sizeof(bits_type)),
+                std::runtime_error);
+
+        auto corrupt = framed;
+        reinterpret_cast<std::byte *>(corrupt.data())[16] ^= std::byte{1};
+        CHECK(!is_frame_header(corrupt.data(), bytes));
+        CHECK_THROWS_AS(read_frame_header(corrupt.data(), bytes), std::runtime_error);
+
+        using other_type = std::conditional_t<std::is_same_v<value_type, float>, double, float>;
+        CHECK_THROWS_AS(make_decompressor<other_type>(read), std::invalid_argument);
+    }
+}
+
+TEMPLATE_TEST_CASE("hypercube checksums locate corrupt hypercubes", "[encoder][checksum]", ALL_PROFILES) {
+    using profile = TestType;
+    using value_type = typename profile::value_type;
+    using bits_type = typename profile::bits_type;
+
+    constexpr auto dims = profile::dimensions;
+    constexpr auto side_length = profile::hypercube_side_length;
+    const index_type n = side_length * 3 + 5;
+    const auto size = extent::broadcast(dims, n);
+    const auto static_size = static_extent<dims>{size};
+    const auto num_hcs = num_hypercubes(static_size);
+
+    // A ramp whose slopes are powers of three, so that no two of the three hypercubes along each axis are identical
+    std::vector<value_type> input_data(num_elements(size));
+    for (index_type i = 0; i < input_data.size(); ++i) {
+        const auto pos = extent_from_linear_id(i, static_size);
+        value_type value = 1;
+        for (dim_type d = 0; d < dims; ++d) {
+            value += static_cast<value_type>(pos[d] * ipow(index_type{3}, d)) / 4;
+        }
+        input_data[i] = value;
+    }
+
+    auto compress = [&](unsigned num_threads, const stream_options &options) {
+        std::vector<bits_type> stream(ndzip::compressed_length_bound<value_type>(size, options));
+        stream.resize(make_compressor<value_type>(dims, num_threads, options)
+                              ->compress(input_data.data(), size, stream.data()));
+        return stream;
+    };
+
+    // Elements of corrupt hypercubes keep this value
+    const auto sentinel = static_cast<value_type>(-12345);
+
+    stream_options options;
+    options.hypercube_checksums = true;
+
+    auto test_checksums = [&](unsigned num_threads) {
+        const auto stream = compress(num_threads, options);
+        std::vector<value_type> expected(input_data.size());
+        CHECK(make_decompressor<value_type>(dims, num_threads, options)
+                        ->decompress(stream.data(), expected.data(), size)
+                == stream.size());
+
+        const auto decompressor = make_decompressor<value_type>(dims, num_threads, options);
+        std::vector<value_type> output(input_data.size(), sentinel);
+        const auto intact = decompressor->decompress_verified(stream.data(), output.data(), size);
+        CHECK(intact.stream_length == stream.size());
+        CHECK(intact.corrupt_hypercubes.empty());
+        CHECK(!intact.corrupt_border);
+        CHECK(memcmp(expected.data(), output.data(), expected.size() * sizeof(value_type)) == 0);
+
+        // Flip a bit in the encoding of the second hypercube
+        const auto preamble = read_preamble(stream.data());
+        detail::stream<const profile> view{num_hcs, stream.data() + stream_prefix_length<bits_type>(preamble, num_hcs),
+                header_marker_bits(preamble)};
+        auto corrupted = stream;
+        corrupted[static_cast<size_t>(view.hypercube(1) - stream.data())] ^= bits_type{1} << 3u;
+        std::fill(output.begin(), output.end(), sentinel);
+        const auto result = decompressor->decompress_verified(corrupted.data(), output.data(), size);
+        CHECK(result.stream_length == stream.size());
+        CHECK(!result.corrupt_border);
+        REQUIRE(!result.corrupt_hypercubes.empty());
+        CHECK(result.corrupt_hypercubes.front() == 1);
+        if (options.prediction_chain_length == 0) { CHECK(result.corrupt_hypercubes.size() == 1); }
+
+        std::vector<bool> in_corrupt_hypercube(input_data.size());
+        for (const auto hc_index : result.corrupt_hypercubes) {
+            const auto region = hypercube_region(size, hc_index);
+            for (index_type i = 0; i < input_data.size(); ++i) {
+                const auto pos = extent_from_linear_id(i, static_size);
+                bool inside = true;
+                for (dim_type d = 0; d < dims; ++d) {
+                    inside &= pos[d] >= region.offset[d] && pos[d] < region.offset[d] + region.size[d];
+                }
+                if (inside) { in_corrupt_hypercube[i] = true; }
+            }
+        }
+        index_type num_mismatches = 0;
+        for (index_type i = 0; i < input_data.size(); ++i) {
+            const auto expected_value = in_corrupt_hypercube[i] ? sentinel : expected[i];
+            num_mismatches += memcmp(&output[i], &expected_value, sizeof(value_type)) != 0;
+        }
+        CHECK(num_mismatches == 0);
+
+        // The border is skipped as a whole
+        auto corrupted_border = stream;
+        corrupted_border.back() ^= bits_type{1};
+        const auto border_result = decompressor->decompress_verified(corrupted_border.data(), output.data(), size);
+        CHECK(border_result.corrupt_border);
+        CHECK(border_result.stream_length == 0);
+        CHECK(border_result.corrupt_hypercubes.empty());
+
+        // Updates keep the checksums of moved and re-encoded hypercubes valid
+        if (options.prediction_chain_length == 0) {
+            const auto original = input_data;
+            const auto dirty = hypercube_region(size, num_hcs / 2);
+            for (index_type i = 0; i < input_data.size(); ++i) {
+                const auto pos = extent_from_linear_id(i, static_size);
+                bool inside = true;
+                for (dim_type d = 0; d < dims; ++d) {
+                    inside &= pos[d] >= dirty.offset[d] && pos[d] < dirty.offset[d] + dirty.size[d];
+                }
+                if (inside) { input_data[i] = static_cast<value_type>(i % 3); }
+            }
+            auto updated = stream;
+            updated.resize(ndzip::compressed_length_bound<value_type>(size, options));
+            updated.resize(make_compressor<value_type>(dims, num_threads, options)
+                                   ->update(input_data.data(), size, {dirty}, updated.data()));
+            const auto update_result = decompressor->decompress_verified(updated.data(), output.data(), size);
+            CHECK(update_result.stream_length == updated.size());
+            CHECK(update_result.corrupt_hypercubes.empty());
+            CHECK(!update_result.corrupt_border);
+            CHECK(memcmp(input_data.data(), output.data(), input_data.size() * sizeof(value_type)) == 0);
+            input_data = original;
+        }
+    };
+
+    SECTION("serial CPU") { test_checksums(1); }
+    SECTION("serial CPU, level 1 with adaptive prediction, deduplication, raw fallback and compressed border") {
+        options.level = 1;
+        options.adaptive_prediction = true;
+        options.deduplicate = true;
+        options.raw_fallback = true;
+        options.compressed_border = true;
+        test_checksums(1);
+    }
+    SECTION("serial CPU, cross-predicted") {
+        options.prediction_chain_length = 4;
+        test_checksums(1);
+    }
+
+#if NDZIP_OPENMP_SUPPORT
+    SECTION("OpenMP CPU", "[omp]") {
+        test_checksums(4);
+        CHECK_FOR_VECTOR_EQUALITY(compress(1, options), compress(4, options));
+    }
+    SECTION("OpenMP CPU, cross-predicted", "[omp]") {
+        options.prediction_chain_length = 4;
+        test_checksums(4);
+    }
+#endif
+
+    SECTION("checksums require a stream layout with an offset header") {
+        options.progressive = true;
+        CHECK_THROWS_AS(make_compressor<value_type>(dims, 1, options), std::invalid_argument);
+        std::vector<value_type> output(input_data.size());
+        const auto stream = compress(1, stream_options{});
+        CHECK_THROWS_AS(make_decompressor<value_type>(dims, 1)->decompress_verified(stream.data(), output.data(), size),
+                std::invalid_argument);
+    }
+}
+
+
 #if NDZIP_OPENMP_SUPPORT || NDZIP_HIPSYCL_SUPPORT || NDZIP_CUDA_SUPPORT
 TEMPLATE_TEST_CASE("file headers from different encoders are identical", "[header]", ALL_PROFILES) {
     using value_type = typename TestType::value_type;